@@ -347,6 +347,9 @@ index_opts_create(struct index_opts *opts, const char *map)
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS, INDEX_OPTS,
 			  "run_size_ratio must be > 1");
+	if (opts->bloom_prefix_parts < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "bloom_prefix_parts must be >= 0");
 	return map;
 }
 
@@ -1474,6 +1477,128 @@ on_replace_dd_index(struct trigger * /* trigger */, void *event)
 	scoped_guard.is_active = false;
 }
 
+/**
+ * A truncated space and the empty copy replacing it.
+ */
+struct truncate_space {
+	/** The space being truncated. */
+	struct space *old_space;
+	/** The empty space, put in the space cache instead. */
+	struct space *new_space;
+};
+
+/**
+ * Move triggers from one space to another, as alter does.
+ */
+static void
+truncate_space_swap(struct truncate_space *truncate)
+{
+	rlist_swap(&truncate->new_space->on_replace,
+		   &truncate->old_space->on_replace);
+}
+
+/**
+ * The truncation is written to WAL: hand the data of the old
+ * space over to the engine and delete the old space.
+ */
+static void
+truncate_space_commit(struct trigger *trigger, void * /* event */)
+{
+	struct truncate_space *truncate =
+		(struct truncate_space *) trigger->data;
+	truncate->old_space->handler->commitTruncateSpace(truncate->old_space,
+							  truncate->new_space);
+	space_delete(truncate->old_space);
+}
+
+/**
+ * Failed to write the truncation to WAL: put the old space back
+ * to the space cache. Changes made in the empty space meanwhile
+ * are rolled back by now, since they were written to WAL after
+ * the truncation.
+ */
+static void
+truncate_space_rollback(struct trigger *trigger, void * /* event */)
+{
+	struct truncate_space *truncate =
+		(struct truncate_space *) trigger->data;
+	truncate_space_swap(truncate);
+	struct space *new_space = space_cache_replace(truncate->old_space);
+	assert(new_space == truncate->new_space);
+	space_delete(new_space);
+}
+
+/**
+ * A record in _truncate space is {space_id, count}, where
+ * count is the number of times the space was truncated.
+ * A new record or a change of an existing one truncates
+ * the space: the space is replaced with an empty copy having
+ * the same definition, and the old data is freed by the engine
+ * after the record is written to WAL. Unlike index drop and
+ * re-creation, this doesn't need to run the alter machinery
+ * for each index or to free all tuples before returning.
+ *
+ * Deletion of a record (on space drop) is a no-op.
+ */
+static void
+on_replace_dd_truncate(struct trigger * /* trigger */, void *event)
+{
+	latch_lock(&schema_lock);
+	auto lock_guard = make_scoped_guard([&]{ latch_unlock(&schema_lock); });
+
+	struct txn *txn = (struct txn *) event;
+	txn_check_autocommit(txn, "Space _truncate");
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	struct tuple *new_tuple = stmt->new_tuple;
+	if (new_tuple == NULL)
+		return;
+
+	uint32_t space_id = tuple_field_u32_xc(new_tuple, ID);
+	struct space *old_space = space_cache_find(space_id);
+	access_check_ddl(old_space->def.uid, SC_SPACE);
+	/*
+	 * System spaces keep their records in sync with internal
+	 * objects by triggers, which aren't run on truncation.
+	 */
+	if (space_is_system(old_space)) {
+		tnt_raise(ClientError, ER_ALTER_SPACE, space_name(old_space),
+			  "system space can not be truncated");
+	}
+	Engine *engine = old_space->handler->engine;
+	if (!(engine->flags & ENGINE_CAN_TRUNCATE))
+		tnt_raise(ClientError, ER_UNSUPPORTED, engine->name, "truncate");
+	if (old_space->index_count == 0)
+		return; /* Nothing to truncate. */
+
+	struct truncate_space *truncate =
+		region_calloc_object_xc(&fiber()->gc, struct truncate_space);
+	/* Create an empty copy of the old space. */
+	struct rlist key_list;
+	space_dump_def(old_space, &key_list);
+	struct space *new_space = space_new(&old_space->def, &key_list);
+	auto space_guard = make_scoped_guard([=] { space_delete(new_space); });
+	new_space->handler->prepareTruncateSpace(old_space, new_space);
+	memcpy(new_space->access, old_space->access,
+	       sizeof(old_space->access));
+	truncate->old_space = old_space;
+	truncate->new_space = new_space;
+
+	struct trigger *on_commit =
+		txn_alter_trigger_new(truncate_space_commit, truncate);
+	struct trigger *on_rollback =
+		txn_alter_trigger_new(truncate_space_rollback, truncate);
+	txn_on_commit(txn, on_commit);
+	txn_on_rollback(txn, on_rollback);
+	/*
+	 * Put the empty space in the cache right away: changes
+	 * made while the truncation is being written to WAL
+	 * follow it in WAL and must survive it.
+	 */
+	space_guard.is_active = false;
+	truncate_space_swap(truncate);
+	(void) space_cache_replace(new_space);
+}
+
 /* {{{ access control */
 
 /** True if the space has records identified by key 'uid'
@@ -2152,4 +2277,8 @@ struct trigger on_replace_cluster = {
 	RLIST_LINK_INITIALIZER, on_replace_dd_cluster, NULL, NULL
 };
 
+struct trigger on_replace_truncate = {
+	RLIST_LINK_INITIALIZER, on_replace_dd_truncate, NULL, NULL
+};
+
 /* vim: set foldmethod=marker */
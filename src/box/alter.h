@@ -39,5 +39,6 @@ extern struct trigger on_replace_user;
 extern struct trigger on_replace_func;
 extern struct trigger on_replace_priv;
 extern struct trigger on_replace_cluster;
+extern struct trigger on_replace_truncate;
 
 #endif /* INCLUDES_TARANTOOL_BOX_ALTER_H */
@@ -46,9 +46,40 @@
 #include "trigger.h"
 #include "xrow_io.h"
 #include "error.h"
+#include "txn.h"
+#include "schema.h"
+#include "space.h"
+#include "index.h"
+#include "tuple.h"
 
 /* TODO: add configuration options */
 static const int RECONNECT_DELAY = 1;
+/** Acknowledge rows to the master at least this often. */
+static const ev_tstamp ACK_INTERVAL = 1;
+
+int applier_batch_size = 1;
+int applier_fiber_count = 1;
+
+/** A key read by an applier worker, see applier_worker_f(). */
+struct applier_job {
+	/** Link in applier_worker::queue. */
+	struct stailq_entry in_queue;
+	/** The space the row modifies. */
+	uint32_t space_id;
+	/** Primary key the row modifies, without the array header. */
+	const char *key;
+	uint32_t part_count;
+};
+
+/** A fiber reading keys of a batch, see applier_worker_f(). */
+struct applier_worker {
+	struct applier *applier;
+	struct fiber *fiber;
+	/** Jobs dispatched to the worker. */
+	struct stailq queue;
+	/** Signaled when a job is added to the queue. */
+	struct ipc_cond cond;
+};
 
 STRS(applier_state, applier_STATE);
 
@@ -295,6 +326,365 @@ finish:
 	applier_set_state(applier, APPLIER_READY);
 }
 
+static inline bool
+applier_row_is_valid(struct xrow_header *row)
+{
+	return !iproto_type_is_error(row->type) &&
+	       row->replica_id != REPLICA_ID_NIL &&
+	       row->replica_id < VCLOCK_MAX;
+}
+
+/**
+ * Raise an error if a row received from the master
+ * is an error message or is broken.
+ */
+static void
+applier_check_row(struct xrow_header *row)
+{
+	if (iproto_type_is_error(row->type))
+		xrow_decode_error(row);  /* error */
+	/* Replication request. */
+	if (row->replica_id == REPLICA_ID_NIL ||
+	    row->replica_id >= VCLOCK_MAX) {
+		/*
+		 * A safety net, this can only occur
+		 * if we're fed a strangely broken xlog.
+		 */
+		tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
+			  int2str(row->replica_id),
+			  tt_uuid_str(&REPLICASET_UUID));
+	}
+}
+
+/** Apply a single row received from the master. */
+static void
+applier_apply_row(struct applier *applier, struct xrow_header *row)
+{
+	if (vclock_get(&replicaset_vclock, row->replica_id) < row->lsn) {
+		/**
+		 * Promote the replica set vclock before
+		 * applying the row. If there is an
+		 * exception (conflict) applying the row,
+		 * the row is skipped when the replication
+		 * is resumed.
+		 */
+		vclock_follow(&replicaset_vclock, row->replica_id,
+			      row->lsn);
+		xstream_write_xc(applier->subscribe_stream, row);
+	}
+}
+
+/**
+ * Apply rows received from the master in a single
+ * multi-statement transaction, so that the whole batch
+ * takes one WAL write on the replica.
+ *
+ * The batch may fail as a whole for reasons a single row
+ * would not: it may mix engines, contain DDL, which is not
+ * allowed in a multi-statement transaction, or hit a
+ * conflict. In this case the transaction is rolled back,
+ * the vclock is restored and the rows are applied one by
+ * one, exactly as if batching was off.
+ */
+static void
+applier_apply_batch(struct applier *applier, struct xrow_header *rows,
+		    int count)
+{
+	if (count == 1)
+		return applier_apply_row(applier, &rows[0]);
+
+	/* -1 means the vclock wasn't promoted by the row. */
+	int64_t *prev_lsn = applier->batch_prev_lsn;
+	for (int i = 0; i < count; i++)
+		prev_lsn[i] = -1;
+	int applied = 0;
+	bool is_failed = false;
+	try {
+		txn_begin(false);
+		for (; applied < count; applied++) {
+			struct xrow_header *row = &rows[applied];
+			if (vclock_get(&replicaset_vclock,
+				       row->replica_id) >= row->lsn) {
+				/* Already applied. */
+				continue;
+			}
+			/* See the comment in applier_apply_row(). */
+			prev_lsn[applied] = vclock_follow(&replicaset_vclock,
+							  row->replica_id,
+							  row->lsn);
+			xstream_write_xc(applier->subscribe_stream, row);
+		}
+		txn_commit(in_txn());
+	} catch (Exception *e) {
+		txn_rollback();
+		/*
+		 * Undo vclock promotion of the rows which
+		 * haven't made it to WAL, unless another applier
+		 * has moved the vclock further since.
+		 */
+		if (applied == count)
+			applied--;
+		for (int i = applied; i >= 0; i--) {
+			struct xrow_header *row = &rows[i];
+			if (prev_lsn[i] >= 0 &&
+			    vclock_get(&replicaset_vclock,
+				       row->replica_id) == row->lsn)
+				vclock_unfollow(&replicaset_vclock,
+						row->replica_id, prev_lsn[i]);
+		}
+		if (type_cast(FiberIsCancelled, e))
+			throw;
+		is_failed = true;
+	}
+	/* Don't yield in the catch block, see applier_f(). */
+	if (is_failed) {
+		for (int i = 0; i < count; i++)
+			applier_apply_row(applier, &rows[i]);
+	}
+}
+
+/**
+ * Find the primary key a row modifies in a vinyl space.
+ * Return false if the row doesn't modify a vinyl space by
+ * primary key. Memtx rows are never read ahead: memtx
+ * doesn't read disk.
+ */
+static bool
+applier_row_key(struct xrow_header *row, struct applier_job *job)
+{
+	if (!iproto_type_is_dml(row->type) || row->bodycnt != 1)
+		return false;
+	struct request request;
+	request_create(&request, row->type);
+	if (request_decode(&request, (const char *) row->body[0].iov_base,
+			   row->body[0].iov_len,
+			   request_key_map(row->type)) != 0)
+		goto invalid;
+	struct space *space;
+	space = space_by_id(request.space_id);
+	if (space == NULL || !space_is_vinyl(space))
+		return false;
+	struct Index *pk;
+	pk = space_index(space, 0);
+	if (pk == NULL)
+		return false;
+	const char *key;
+	switch (request.type) {
+	case IPROTO_INSERT:
+	case IPROTO_REPLACE:
+		if (tuple_validate_raw(space->format, request.tuple) != 0)
+			goto invalid;
+		key = tuple_extract_key_raw(request.tuple, request.tuple_end,
+					    &pk->index_def->key_def, NULL);
+		if (key == NULL)
+			goto invalid;
+		break;
+	case IPROTO_DELETE:
+	case IPROTO_UPDATE:
+		if (request.index_id != 0)
+			return false;
+		key = request.key;
+		break;
+	default:
+		/* UPSERT doesn't read the old tuple. */
+		return false;
+	}
+	uint32_t part_count;
+	part_count = mp_decode_array(&key);
+	if (primary_key_validate(pk->index_def, key, part_count) != 0)
+		goto invalid;
+	job->space_id = request.space_id;
+	job->key = key;
+	job->part_count = part_count;
+	return true;
+invalid:
+	/* Let the row fail when applied, with a proper error. */
+	diag_clear(diag_get());
+	return false;
+}
+
+/**
+ * Read the tuple a row is going to modify, so that the row
+ * finds it in the vinyl cache when applied. A failure is
+ * ignored: the row itself will hit it, if it's persistent.
+ */
+static void
+applier_worker_read(struct applier_job *job)
+{
+	struct space *space = space_by_id(job->space_id);
+	if (space == NULL)
+		return;
+	struct Index *pk = space_index(space, 0);
+	if (pk == NULL || pk->index_def->key_def.part_count != job->part_count)
+		return;
+	try {
+		(void) pk->findByKey(job->key, job->part_count);
+	} catch (Exception *) {
+		diag_clear(diag_get());
+	}
+}
+
+static int
+applier_worker_f(va_list ap)
+{
+	struct applier_worker *worker = va_arg(ap, struct applier_worker *);
+	struct applier *applier = worker->applier;
+	while (!fiber_is_cancelled()) {
+		if (stailq_empty(&worker->queue)) {
+			ipc_cond_wait(&worker->cond);
+			continue;
+		}
+		struct applier_job *job =
+			stailq_shift_entry(&worker->queue, struct applier_job,
+					   in_queue);
+		/*
+		 * The reader waits for all the jobs of a batch
+		 * to complete, so the worker is never cancelled
+		 * while reading a key.
+		 */
+		bool cancellable = fiber_set_cancellable(false);
+		applier_worker_read(job);
+		fiber_set_cancellable(cancellable);
+		fiber_gc();
+		if (--applier->read_pending == 0)
+			ipc_cond_signal(&applier->read_cond);
+	}
+	return 0;
+}
+
+/** Stop the worker fibers of an applier. */
+static void
+applier_stop_workers(struct applier *applier)
+{
+	for (int i = 0; i < applier->worker_count; i++) {
+		struct applier_worker *worker = &applier->workers[i];
+		assert(stailq_empty(&worker->queue));
+		fiber_cancel(worker->fiber);
+		fiber_join(worker->fiber);
+		ipc_cond_destroy(&worker->cond);
+	}
+	applier->worker_count = 0;
+}
+
+/**
+ * Make the number of running worker fibers match
+ * box.cfg.replication_apply_fibers: none if the rows are
+ * applied serially. Must not be called while a batch is
+ * in progress.
+ */
+static void
+applier_start_workers(struct applier *applier)
+{
+	int count = applier_fiber_count > 1 ? applier_fiber_count : 0;
+	if (applier->worker_count == count)
+		return;
+	applier_stop_workers(applier);
+	char name[FIBER_NAME_MAX];
+	for (int i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "%s/%d",
+			 fiber_name(applier->reader), i);
+		struct applier_worker *worker = &applier->workers[i];
+		worker->applier = applier;
+		worker->fiber = fiber_new_xc(name, applier_worker_f);
+		stailq_create(&worker->queue);
+		ipc_cond_create(&worker->cond);
+		fiber_set_joinable(worker->fiber, true);
+		applier->worker_count++;
+		fiber_start(worker->fiber, worker);
+	}
+}
+
+/**
+ * Apply rows received from the master using a pool of
+ * worker fibers. Before the batch is applied, the workers
+ * read the tuples the rows of vinyl spaces modify, so that
+ * the disk reads of different keys overlap, while the apply
+ * itself finds the tuples in the cache. The batch is then
+ * applied and committed by applier_apply_batch(), in a single
+ * transaction, exactly as if there were no workers.
+ */
+static void
+applier_apply_parallel(struct applier *applier, struct xrow_header *rows,
+		       int count)
+{
+	assert(applier->worker_count > 0);
+	assert(applier->read_pending == 0);
+	int job_count = 0;
+	for (int i = 0; i < count; i++) {
+		struct applier_job *job = &applier->jobs[job_count];
+		if (!applier_row_key(&rows[i], job))
+			continue;
+		struct applier_worker *worker =
+			&applier->workers[job_count % applier->worker_count];
+		stailq_add_tail_entry(&worker->queue, job, in_queue);
+		ipc_cond_signal(&worker->cond);
+		applier->read_pending++;
+		job_count++;
+	}
+	/*
+	 * The keys reside in the input buffer, so wait even
+	 * if the fiber is cancelled.
+	 */
+	while (applier->read_pending > 0)
+		ipc_cond_wait(&applier->read_cond);
+	applier_apply_batch(applier, rows, count);
+}
+
+/**
+ * Acknowledge the rows written to WAL to the master, so that
+ * it can report the transactions waiting for a quorum of
+ * replicas committed, see replicaset_sync_wait(). An ack is
+ * sent after each batch of rows is applied, and once per
+ * ACK_INTERVAL otherwise. Relays which don't wait for acks
+ * read and discard them.
+ */
+static int
+applier_writer_f(va_list ap)
+{
+	struct applier *applier = va_arg(ap, struct applier *);
+	struct ev_io io;
+	coio_init(&io, applier->io.fd);
+	/* The vclock sent in the last ack. */
+	struct vclock vclock;
+	vclock_create(&vclock);
+
+	while (!fiber_is_cancelled()) {
+		/*
+		 * Don't wait if rows were written while the
+		 * previous ack was being sent.
+		 */
+		if (vclock_compare(&vclock, wal_written_vclock()) == 0)
+			ipc_cond_wait_timeout(&applier->writer_cond,
+					      ACK_INTERVAL);
+		if (fiber_is_cancelled())
+			break;
+		try {
+			struct xrow_header xrow;
+			vclock_copy(&vclock, wal_written_vclock());
+			xrow_encode_vclock(&xrow, &vclock);
+			coio_write_xrow(&io, &xrow);
+		} catch (FiberIsCancelled *e) {
+			break;
+		} catch (Exception *e) {
+			/* The reader notices the broken connection. */
+			e->log();
+			break;
+		}
+		fiber_gc();
+	}
+	return 0;
+}
+
+static void
+applier_stop_writer(struct applier *applier)
+{
+	if (applier->writer == NULL)
+		return;
+	fiber_cancel(applier->writer);
+	fiber_join(applier->writer);
+	applier->writer = NULL;
+}
+
 /**
  * Execute and process SUBSCRIBE request (follow updates from a master).
  */
@@ -343,39 +733,51 @@ applier_subscribe(struct applier *applier)
 	/* Re-enable warnings after successful execution of SUBSCRIBE */
 	applier->last_logged_errcode = 0;
 
+	if (applier->version_id >= version_id(1, 7, 0)) {
+		assert(applier->writer == NULL);
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "%s/writer",
+			 fiber_name(applier->reader));
+		applier->writer = fiber_new_xc(name, applier_writer_f);
+		fiber_set_joinable(applier->writer, true);
+		fiber_start(applier->writer, applier);
+	}
+
 	/*
 	 * Process a stream of rows from the binary log.
 	 */
+	struct xrow_header *batch = applier->batch;
 	while (true) {
-		coio_read_xrow(coio, &iobuf->in, &row);
-		applier->lag = ev_now(loop()) - row.tm;
+		coio_read_xrow(coio, &iobuf->in, &batch[0]);
+		applier_check_row(&batch[0]);
+		/*
+		 * Grab the rows which have already arrived
+		 * along with the first one to apply them in
+		 * a single transaction. Never read the socket
+		 * here: it could move the input buffer and
+		 * invalidate the rows decoded so far.
+		 */
+		int count = 1;
+		struct xrow_header *bad_row = NULL;
+		while (count < applier_batch_size &&
+		       ibuf_read_xrow(&iobuf->in, &batch[count])) {
+			if (!applier_row_is_valid(&batch[count])) {
+				bad_row = &batch[count];
+				break;
+			}
+			count++;
+		}
+		applier->lag = ev_now(loop()) - batch[count - 1].tm;
 		applier->last_row_time = ev_now(loop());
 
-		if (iproto_type_is_error(row.type))
-			xrow_decode_error(&row);  /* error */
-		/* Replication request. */
-		if (row.replica_id == REPLICA_ID_NIL ||
-		    row.replica_id >= VCLOCK_MAX) {
-			/*
-			 * A safety net, this can only occur
-			 * if we're fed a strangely broken xlog.
-			 */
-			tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
-				  int2str(row.replica_id),
-				  tt_uuid_str(&REPLICASET_UUID));
-		}
-		if (vclock_get(&replicaset_vclock, row.replica_id) < row.lsn) {
-			/**
-			 * Promote the replica set vclock before
-			 * applying the row. If there is an
-			 * exception (conflict) applying the row,
-			 * the row is skipped when the replication
-			 * is resumed.
-			 */
-			vclock_follow(&replicaset_vclock, row.replica_id,
-				      row.lsn);
-			xstream_write_xc(applier->subscribe_stream, &row);
-		}
+		applier_start_workers(applier);
+		if (applier->worker_count > 0)
+			applier_apply_parallel(applier, batch, count);
+		else
+			applier_apply_batch(applier, batch, count);
+		ipc_cond_signal(&applier->writer_cond);
+		if (bad_row != NULL)
+			applier_check_row(bad_row);
 		iobuf_reset(iobuf);
 		fiber_gc();
 	}
@@ -384,6 +786,7 @@ applier_subscribe(struct applier *applier)
 static inline void
 applier_disconnect(struct applier *applier, enum applier_state state)
 {
+	applier_stop_writer(applier);
 	coio_close(loop(), &applier->io);
 	iobuf_reset(applier->iobuf);
 	applier_set_state(applier, state);
@@ -488,6 +891,7 @@ applier_stop(struct applier *applier)
 		return;
 	fiber_cancel(f);
 	fiber_join(f);
+	applier_stop_workers(applier);
 	applier_set_state(applier, APPLIER_OFF);
 	applier->reader = NULL;
 }
@@ -504,6 +908,26 @@ applier_new(const char *uri, struct xstream *join_stream,
 		return NULL;
 	}
 	coio_init(&applier->io, -1);
+	applier->batch = (struct xrow_header *)
+		calloc(APPLIER_BATCH_SIZE_MAX, sizeof(*applier->batch));
+	applier->batch_prev_lsn = (int64_t *)
+		calloc(APPLIER_BATCH_SIZE_MAX, sizeof(*applier->batch_prev_lsn));
+	applier->jobs = (struct applier_job *)
+		calloc(APPLIER_BATCH_SIZE_MAX, sizeof(*applier->jobs));
+	applier->workers = (struct applier_worker *)
+		calloc(APPLIER_FIBERS_MAX, sizeof(*applier->workers));
+	if (applier->batch == NULL || applier->batch_prev_lsn == NULL ||
+	    applier->jobs == NULL || applier->workers == NULL) {
+		free(applier->batch);
+		free(applier->batch_prev_lsn);
+		free(applier->jobs);
+		free(applier->workers);
+		free(applier);
+		diag_set(OutOfMemory, APPLIER_BATCH_SIZE_MAX *
+			 sizeof(struct xrow_header), "malloc",
+			 "applier->batch");
+		return NULL;
+	}
 	applier->iobuf = iobuf_new();
 
 	/* uri_parse() sets pointers to applier->source buffer */
@@ -518,6 +942,8 @@ applier_new(const char *uri, struct xstream *join_stream,
 	applier->last_row_time = ev_now(loop());
 	rlist_create(&applier->on_state);
 	ipc_channel_create(&applier->pause, 0);
+	ipc_cond_create(&applier->read_cond);
+	ipc_cond_create(&applier->writer_cond);
 
 	return applier;
 }
@@ -530,6 +956,14 @@ applier_delete(struct applier *applier)
 	assert(applier->io.fd == -1);
 	ipc_channel_destroy(&applier->pause);
 	trigger_destroy(&applier->on_state);
+	assert(applier->worker_count == 0);
+	assert(applier->writer == NULL);
+	ipc_cond_destroy(&applier->read_cond);
+	ipc_cond_destroy(&applier->writer_cond);
+	free(applier->batch);
+	free(applier->batch_prev_lsn);
+	free(applier->jobs);
+	free(applier->workers);
 	free(applier);
 }
 
@@ -43,9 +43,35 @@
 #include "ipc.h"
 
 struct xstream;
+struct xrow_header;
+struct applier_worker;
+struct applier_job;
 
 enum { APPLIER_SOURCE_MAXLEN = 1024 }; /* enough to fit URI with passwords */
 
+enum {
+	/** Max value of box.cfg.replication_batch_size. */
+	APPLIER_BATCH_SIZE_MAX = 1024,
+	/** Max value of box.cfg.replication_apply_fibers. */
+	APPLIER_FIBERS_MAX = 64,
+};
+
+/**
+ * Max number of rows the applier groups into a single
+ * transaction, box.cfg.replication_batch_size.
+ * 1 means every row is applied in its own transaction.
+ */
+extern int applier_batch_size;
+
+/**
+ * Number of fibers an applier uses to apply rows,
+ * box.cfg.replication_apply_fibers. If greater than 1,
+ * the tuples the rows of a batch modify in vinyl spaces
+ * are read concurrently before the batch is applied, see
+ * applier_apply_parallel().
+ */
+extern int applier_fiber_count;
+
 #define applier_STATE(_)                                             \
 	_(APPLIER_OFF, 0)                                            \
 	_(APPLIER_CONNECT, 1)                                        \
@@ -69,6 +95,13 @@ extern const char *applier_state_strs[];
 struct applier {
 	/** Background fiber */
 	struct fiber *reader;
+	/**
+	 * Background fiber to acknowledge the rows written
+	 * to WAL to the master, see applier_writer_f().
+	 */
+	struct fiber *writer;
+	/** Signaled to make the writer send an ack. */
+	struct ipc_cond writer_cond;
 	/** Finite-state machine */
 	enum applier_state state;
 	/** Local time of this replica when the last row has been received */
@@ -104,6 +137,26 @@ struct applier {
 	struct xstream *join_stream;
 	/** xstream to process rows during final JOIN and SUBSCRIBE */
 	struct xstream *subscribe_stream;
+	/**
+	 * Rows of the batch being applied, APPLIER_BATCH_SIZE_MAX
+	 * entries, see applier_apply_batch().
+	 */
+	struct xrow_header *batch;
+	/** The LSNs replaced by the rows of the batch in vclock. */
+	int64_t *batch_prev_lsn;
+	/**
+	 * Fibers reading the keys of a batch concurrently,
+	 * APPLIER_FIBERS_MAX entries, worker_count of which
+	 * are running.
+	 */
+	struct applier_worker *workers;
+	int worker_count;
+	/** Keys of the batch being read by the workers. */
+	struct applier_job *jobs;
+	/** Number of keys of the batch not read yet. */
+	int read_pending;
+	/** Signaled when all the keys of the batch are read. */
+	struct ipc_cond read_cond;
 };
 
 /**
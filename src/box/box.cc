@@ -42,6 +42,7 @@
 #include "applier.h"
 #include <rmean.h>
 #include "main.h"
+#include "version.h"
 #include "tuple.h"
 #include "session.h"
 #include "func.h"
@@ -51,6 +52,7 @@
 #include "memtx_index.h"
 #include "sysview_engine.h"
 #include "vinyl_engine.h"
+#include "vinyl.h"
 #include "space.h"
 #include "port.h"
 #include "request.h"
@@ -388,6 +390,87 @@ box_check_readahead(int readahead)
 	}
 }
 
+static int
+box_check_replication_batch_size(int batch_size)
+{
+	if (batch_size < 1 || batch_size > APPLIER_BATCH_SIZE_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_batch_size",
+			  "specified value is out of bounds");
+	}
+	return batch_size;
+}
+
+static int
+box_check_replication_apply_fibers(int fiber_count)
+{
+	if (fiber_count < 1 || fiber_count > APPLIER_FIBERS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_apply_fibers",
+			  "specified value is out of bounds");
+	}
+	return fiber_count;
+}
+
+static int
+box_check_replication_sync_quorum(int quorum)
+{
+	if (quorum < 0 || quorum >= VCLOCK_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_sync_quorum",
+			  "specified value is out of bounds");
+	}
+	return quorum;
+}
+
+static double
+box_check_replication_sync_timeout(double timeout)
+{
+	if (timeout <= 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_sync_timeout",
+			  "the value must be greater than zero");
+	}
+	return timeout;
+}
+
+static int
+box_check_snapshot_threads(int thread_count)
+{
+	if (thread_count < 1 || thread_count > MEMTX_SNAPSHOT_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "snapshot_threads",
+			  "specified value is out of bounds");
+	}
+	return thread_count;
+}
+
+static int
+box_check_iproto_threads(int thread_count)
+{
+	if (thread_count < 1 || thread_count > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  "specified value is out of bounds");
+	}
+	return thread_count;
+}
+
+static int
+box_check_net_msg_max(int msg_max)
+{
+	if (msg_max < IPROTO_MSG_MAX_MIN) {
+		tnt_raise(ClientError, ER_CFG, "net_msg_max",
+			  "specified value is out of bounds");
+	}
+	return msg_max;
+}
+
+static int
+box_check_vinyl_dump_threads(int dump_threads)
+{
+	/* At least one worker thread must be left for compaction. */
+	if (dump_threads < 1 || dump_threads >= cfg_geti("vinyl_threads")) {
+		tnt_raise(ClientError, ER_CFG, "vinyl_dump_threads",
+			  "must be >= 1 and < vinyl_threads");
+	}
+	return dump_threads;
+}
+
 static int64_t
 box_check_wal_max_rows(int64_t wal_max_rows)
 {
@@ -417,6 +500,13 @@ box_check_config()
 	box_check_uri(cfg_gets("listen"), "listen");
 	box_check_replication();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_replication_batch_size(cfg_geti("replication_batch_size"));
+	box_check_replication_apply_fibers(cfg_geti("replication_apply_fibers"));
+	box_check_replication_sync_quorum(cfg_geti("replication_sync_quorum"));
+	box_check_replication_sync_timeout(cfg_getd("replication_sync_timeout"));
+	box_check_snapshot_threads(cfg_geti("snapshot_threads"));
+	box_check_iproto_threads(cfg_geti("iproto_threads"));
+	box_check_net_msg_max(cfg_geti("net_msg_max"));
 	box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
@@ -426,6 +516,7 @@ box_check_config()
 			  "can't be greater than vinyl_range_size");
 	if (cfg_geti("vinyl_threads") < 2)
 		tnt_raise(ClientError, ER_CFG, "vinyl_threads", "must be >= 2");
+	box_check_vinyl_dump_threads(cfg_geti("vinyl_dump_threads"));
 }
 
 /*
@@ -541,6 +632,36 @@ box_set_snap_io_rate_limit(void)
 		memtx->setSnapIoRateLimit(cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_vinyl_dump_threads(void)
+{
+	int dump_threads = box_check_vinyl_dump_threads(
+		cfg_geti("vinyl_dump_threads"));
+	VinylEngine *vinyl = (VinylEngine *) engine_find("vinyl");
+	if (vinyl)
+		vy_set_dump_threads(vinyl->env, dump_threads);
+}
+
+void
+box_set_vinyl_compact_io_rate_limit(void)
+{
+	VinylEngine *vinyl = (VinylEngine *) engine_find("vinyl");
+	if (vinyl) {
+		vy_set_compact_io_rate_limit(vinyl->env,
+				cfg_getd("vinyl_compact_io_rate_limit"));
+	}
+}
+
+void
+box_set_snapshot_threads(void)
+{
+	int thread_count = box_check_snapshot_threads(
+		cfg_geti("snapshot_threads"));
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setSnapshotThreads(thread_count);
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -555,6 +676,41 @@ box_set_readahead(void)
 	iobuf_set_readahead(readahead);
 }
 
+void
+box_set_net_msg_max(void)
+{
+	iproto_set_msg_max(box_check_net_msg_max(cfg_geti("net_msg_max")));
+}
+
+void
+box_set_replication_batch_size(void)
+{
+	applier_batch_size = box_check_replication_batch_size(
+		cfg_geti("replication_batch_size"));
+}
+
+void
+box_set_replication_apply_fibers(void)
+{
+	applier_fiber_count = box_check_replication_apply_fibers(
+		cfg_geti("replication_apply_fibers"));
+}
+
+void
+box_set_replication_sync_quorum(void)
+{
+	replication_sync_quorum = box_check_replication_sync_quorum(
+		cfg_geti("replication_sync_quorum"));
+	replicaset_sync_update();
+}
+
+void
+box_set_replication_sync_timeout(void)
+{
+	replication_sync_timeout = box_check_replication_sync_timeout(
+		cfg_getd("replication_sync_timeout"));
+}
+
 /* }}} configuration bindings */
 
 /**
@@ -809,6 +965,37 @@ space_truncate(struct space *space)
 		return;
 	}
 
+	/*
+	 * _truncate appeared in 1.7.5. Until the schema is
+	 * upgraded, truncate the old way, by recreating indexes.
+	 */
+	if ((space->handler->engine->flags & ENGINE_CAN_TRUNCATE) &&
+	    !space_is_system(space) &&
+	    schema_dd_version_id() >= version_id(1, 7, 5)) {
+		/*
+		 * Bump the truncation counter of the space in
+		 * _truncate. The trigger on _truncate swaps the
+		 * space with an empty copy and lets the engine free
+		 * the old data in background.
+		 */
+		char tuple_buf[32];
+		char *tuple_end = mp_encode_array(tuple_buf, 2);
+		tuple_end = mp_encode_uint(tuple_end, space_id(space));
+		tuple_end = mp_encode_uint(tuple_end, 1);
+		assert(tuple_end <= tuple_buf + sizeof(tuple_buf));
+		char ops_buf[32];
+		char *ops_end = mp_encode_array(ops_buf, 1);
+		ops_end = mp_encode_array(ops_end, 3);
+		ops_end = mp_encode_str(ops_end, "+", 1);
+		ops_end = mp_encode_uint(ops_end, 1);
+		ops_end = mp_encode_uint(ops_end, 1);
+		assert(ops_end <= ops_buf + sizeof(ops_buf));
+		if (box_upsert(BOX_TRUNCATE_ID, 0, tuple_buf, tuple_end,
+			       ops_buf, ops_end, 0, NULL) != 0)
+			diag_raise();
+		return;
+	}
+
 	char key_buf[20];
 	char *key_buf_end;
 	key_buf_end = mp_encode_uint(key_buf, space_id(space));
@@ -1550,7 +1737,8 @@ box_cfg_xc(void)
 
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_threads(cfg_geti("iproto_threads")),
+		    box_check_net_msg_max(cfg_geti("net_msg_max")));
 	wal_thread_start();
 
 	title("loading");
@@ -152,8 +152,16 @@ void box_set_replication(void);
 void box_set_log_level(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_snapshot_threads(void);
+void box_set_vinyl_dump_threads(void);
+void box_set_vinyl_compact_io_rate_limit(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
+void box_set_net_msg_max(void);
+void box_set_replication_batch_size(void);
+void box_set_replication_apply_fibers(void);
+void box_set_replication_sync_quorum(void);
+void box_set_replication_sync_timeout(void);
 void box_set_force_recovery(void);
 
 extern "C" {
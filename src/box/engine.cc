@@ -221,6 +221,17 @@ Handler::commitAlterSpace(struct space *, struct space *)
 {
 }
 
+void
+Handler::prepareTruncateSpace(struct space *, struct space *)
+{
+	tnt_raise(ClientError, ER_UNSUPPORTED, engine->name, "truncate");
+}
+
+void
+Handler::commitTruncateSpace(struct space *, struct space *)
+{
+}
+
 void
 Handler::executeSelect(struct txn *, struct space *space,
 		       uint32_t index_id, uint32_t iterator,
@@ -40,6 +40,11 @@ struct relay;
 
 enum engine_flags {
 	ENGINE_CAN_BE_TEMPORARY = 1,
+	/**
+	 * The engine can truncate a space by replacing it with
+	 * an empty copy, see Handler::prepareTruncateSpace().
+	 */
+	ENGINE_CAN_TRUNCATE = 2,
 };
 
 extern struct rlist engines;
@@ -251,6 +256,21 @@ public:
 	 */
 	virtual void commitAlterSpace(struct space *old_space,
 				      struct space *new_space);
+	/**
+	 * Prepare 'new_space', an empty copy of 'old_space',
+	 * to replace it on truncation. The indexes of
+	 * 'new_space' are created, but empty.
+	 */
+	virtual void prepareTruncateSpace(struct space *old_space,
+					  struct space *new_space);
+	/**
+	 * Notify the engine that the truncation of 'old_space'
+	 * is written to WAL and 'old_space' is about to be
+	 * deleted. The engine may take over the indexes of
+	 * 'old_space' to free them in background. Must not fail.
+	 */
+	virtual void commitTruncateSpace(struct space *old_space,
+					 struct space *new_space);
 	Engine *engine;
 };
 
@@ -235,6 +235,21 @@ Index::findByKey(const char *key, uint32_t part_count) const
 	return NULL;
 }
 
+void
+Index::findByKeys(const char **keys, uint32_t count,
+		  struct tuple **result) const
+{
+	for (uint32_t i = 0; i < count; i++) {
+		const char *key = keys[i];
+		uint32_t part_count = mp_decode_array(&key);
+		struct tuple *tuple = findByKey(key, part_count);
+		if (tuple != NULL) {
+			tuple_ref_xc(tuple);
+			result[i] = tuple;
+		}
+	}
+}
+
 struct tuple *
 Index::findByTuple(struct tuple *tuple) const
 {
@@ -379,6 +394,54 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	}
 }
 
+int
+box_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		   const char *keys_end, box_tuple_t **result)
+{
+	assert(keys != NULL && keys_end != NULL && result != NULL);
+	mp_tuple_assert(keys, keys_end);
+	uint32_t count = mp_decode_array(&keys);
+	memset(result, 0, count * sizeof(*result));
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	try {
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		if (!index->index_def->opts.is_unique)
+			tnt_raise(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		const char **key_array = (const char **)
+			region_alloc_xc(region, count * sizeof(*key_array));
+		for (uint32_t i = 0; i < count; i++) {
+			key_array[i] = keys;
+			if (mp_typeof(*keys) != MP_ARRAY)
+				tnt_raise(ClientError, ER_TUPLE_NOT_ARRAY);
+			uint32_t part_count = mp_decode_array(&keys);
+			if (primary_key_validate(index->index_def, keys,
+						 part_count))
+				diag_raise();
+			for (uint32_t j = 0; j < part_count; j++)
+				mp_next(&keys);
+		}
+		/* Start transaction in the engine. */
+		struct txn *txn = txn_begin_ro_stmt(space);
+		index->findByKeys(key_array, count, result);
+		/* Count statistics */
+		rmean_collect(rmean_box, IPROTO_SELECT, count);
+		txn_commit_ro_stmt(txn);
+		region_truncate(region, used);
+		return 0;
+	}  catch (Exception *) {
+		txn_rollback_stmt();
+		region_truncate(region, used);
+		for (uint32_t i = 0; i < count; i++) {
+			if (result[i] != NULL)
+				tuple_unref(result[i]);
+			result[i] = NULL;
+		}
+		return -1;
+	}
+}
+
 int
 box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -243,6 +243,26 @@ box_index_count(uint32_t space_id, uint32_t index_id, int type,
 
 /** \endcond public */
 
+/**
+ * Look up tuples by several keys in a unique index.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param keys encoded keys in MsgPack Array format
+ *             ([[part1, part2, ...], [part1, part2, ...], ...]).
+ * \param keys_end the end of encoded \a keys
+ * \param[out] result an array of the size of \a keys, result[i]
+ *             is set to the tuple matching the i-th key or NULL.
+ *             Found tuples are referenced, the caller must
+ *             unreference them with box_tuple_unref().
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \sa \code box.space[space_id].index[index_id]:get_many(keys) \endcode
+ */
+int
+box_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		   const char *keys_end, box_tuple_t **result);
+
 struct info_handler;
 
 /**
@@ -357,6 +377,15 @@ public:
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
+	/**
+	 * Look up tuples by @a count full keys at once. Each key
+	 * is a MsgPack array. result[i] is set to the tuple found
+	 * by keys[i] or left NULL. Found tuples are referenced, the
+	 * caller must unreference them, also on error.
+	 * The default implementation calls findByKey() for each key.
+	 */
+	virtual void findByKeys(const char **keys, uint32_t count,
+				struct tuple **result) const;
 	virtual struct tuple *findByTuple(struct tuple *tuple) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
@@ -59,15 +59,117 @@
 #include "iproto_constants.h"
 #include "rmean.h"
 
-/* The number of iproto messages in flight */
-enum { IPROTO_MSG_MAX = 768 };
+enum {
+	/**
+	 * Tuples of a SELECT reply which are at least this big
+	 * are written to the socket right from the tuple memory.
+	 * Smaller ones are cheaper to copy to the output buffer
+	 * than to send as a separate iovec.
+	 */
+	IPROTO_TUPLE_REF_MIN_SIZE = 1024,
+	/** The max number of iovecs in a single writev(). */
+	IPROTO_FLUSH_IOV_MAX = 128,
+};
+
+struct iproto_thread;
+
+/**
+ * A message which carries tuples written to the sockets of
+ * a network thread back to tx to unreference them. There is
+ * one such message per thread: tuples written while it is
+ * in flight are sent with the next batch.
+ */
+struct iproto_release_msg: public cmsg
+{
+	struct iproto_thread *thread;
+	/** A batch of port_ref to release. */
+	struct stailq refs;
+	/** True while the message is on its way. */
+	bool in_progress;
+};
+
+/**
+ * A network io thread. Connections accepted by the first
+ * thread, which owns the listening socket, are distributed
+ * among all threads in round-robin order. A connection is
+ * served by the same thread until it is closed. Each thread
+ * has its own message pools, pipes to and from the tx thread
+ * and statistics, so network threads never contend with each
+ * other.
+ */
+struct iproto_thread {
+	/** Thread number, also its index in iproto_threads. */
+	int id;
+	/** Name of the thread and its cbus endpoint. */
+	char name[FIBER_NAME_MAX];
+	struct cord cord;
+	/**
+	 * A pipe from the tx thread to this thread.
+	 * Used in the tx thread.
+	 */
+	struct cpipe net_pipe;
+	/**
+	 * A single queue for all requests in all connections
+	 * of this thread. Requests from all connections are
+	 * processed concurrently. Is also used as a queue for
+	 * just established connections and to execute
+	 * disconnect triggers. A few notes about these
+	 * triggers:
+	 * - they need to be run in a fiber
+	 * - unlike an ordinary request failure, on_connect
+	 *   trigger failure must lead to connection close.
+	 * - on_connect trigger must be processed before any
+	 *   other request on this connection.
+	 * Used in this thread.
+	 */
+	struct cpipe tx_pipe;
+	/**
+	 * A pipe from the first thread to this thread, to pass
+	 * accepted connections. Used in the first thread,
+	 * unused in the first thread's own struct.
+	 */
+	struct cpipe accept_pipe;
+	/**
+	 * The number of messages in flight allowed, this
+	 * thread's share of box.cfg.net_msg_max.
+	 */
+	int msg_max;
+	struct mempool msg_pool;
+	struct mempool connection_pool;
+	/** Connections throttled by iproto_stop_input(). */
+	struct rlist stopped_connections;
+	/** Network statistics of this thread. */
+	struct rmean *rmean;
+	/**
+	 * Tuples written to the sockets of this thread and
+	 * not sent to tx for release yet.
+	 */
+	struct stailq written_refs;
+	struct iproto_release_msg release_msg;
+	/*
+	 * Message routes. A route refers to the pipe back to
+	 * this thread, hence each thread has its own copy.
+	 */
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop sync_route[2];
+	struct cmsg_hop connect_route[2];
+	struct cmsg_hop release_route[2];
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+};
+
+/** Network io threads. */
+static struct iproto_thread *iproto_threads;
+static int iproto_thread_count;
 
 /* {{{ iproto_msg - declaration */
 
 /**
  * A single msg from io thread. All requests
- * from all connections are queued into a single queue
- * and processed in FIFO order.
+ * from all connections of an io thread are queued
+ * into a single queue and processed in FIFO order.
  */
 struct iproto_msg: public cmsg
 {
@@ -93,6 +195,11 @@ struct iproto_msg: public cmsg
 	size_t len;
 	/** End of write position in the output buffer */
 	struct obuf_svp write_end;
+	/**
+	 * Tuples of the reply which are written to the socket
+	 * from the tuple memory, see port_dump_refs().
+	 */
+	struct stailq out_refs;
 	/**
 	 * Used in "connect" msgs, true if connect trigger failed
 	 * and the connection must be closed.
@@ -100,30 +207,11 @@ struct iproto_msg: public cmsg
 	bool close_connection;
 };
 
-static struct mempool iproto_msg_pool;
-
 static struct iproto_msg *
-iproto_msg_new(struct iproto_connection *con)
-{
-	struct iproto_msg *msg =
-		(struct iproto_msg *) mempool_alloc_xc(&iproto_msg_pool);
-	msg->connection = con;
-	return msg;
-}
-
-/**
- * Resume stopped connections, if any.
- */
-static void
-iproto_resume();
-
+iproto_msg_new(struct iproto_connection *con);
 
 static inline void
-iproto_msg_delete(struct cmsg *msg)
-{
-	mempool_free(&iproto_msg_pool, msg);
-	iproto_resume();
-}
+iproto_msg_delete(struct cmsg *msg);
 
 struct IprotoMsgGuard {
 	struct iproto_msg *msg;
@@ -138,31 +226,27 @@ struct IprotoMsgGuard {
 
 /* {{{ iproto connection and requests */
 
-/**
- * A single global queue for all requests in all connections. All
- * requests from all connections are processed concurrently.
- * Is also used as a queue for just established connections and to
- * execute disconnect triggers. A few notes about these triggers:
- * - they need to be run in a fiber
- * - unlike an ordinary request failure, on_connect trigger
- *   failure must lead to connection close.
- * - on_connect trigger must be processed before any other
- *   request on this connection.
- */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
 /* A pointer to the transaction processor cord. */
 struct cord *tx_cord;
 
-struct rmean *rmean_net;
-
 enum rmean_net_name {
 	IPROTO_SENT,
 	IPROTO_RECEIVED,
+	/** Connections stopped as the message limit was reached. */
+	IPROTO_INPUT_STOPS,
+	/** Time spent by connections in the stopped state, ms. */
+	IPROTO_INPUT_STOP_MS,
+	/** Connections throttled by the per-connection quota. */
+	IPROTO_INPUT_THROTTLES,
+	/** Time spent by connections in the throttled state, ms. */
+	IPROTO_INPUT_THROTTLE_MS,
 	IPROTO_LAST,
 };
 
-const char *rmean_net_strings[IPROTO_LAST] = { "SENT", "RECEIVED" };
+const char *rmean_net_strings[IPROTO_LAST] = {
+	"SENT", "RECEIVED", "INPUT_STOPS", "INPUT_STOP_MS",
+	"INPUT_THROTTLES", "INPUT_THROTTLE_MS",
+};
 
 /** Context of a single client connection. */
 struct iproto_connection
@@ -192,13 +276,48 @@ struct iproto_connection
 	/** Logical session. */
 	struct session *session;
 	ev_loop *loop;
+	/** The network thread serving this connection. */
+	struct iproto_thread *iproto_thread;
 	/* Pre-allocated disconnect msg. */
 	struct iproto_msg *disconnect;
 	struct rlist in_stop_list;
+	/** Time when the connection was stopped or throttled. */
+	ev_tstamp stop_time;
+	/** The number of requests of this connection in flight. */
+	int msg_count;
+	/**
+	 * Set if the connection has used up its quota of
+	 * messages in flight, see iproto_connection_msg_quota().
+	 * Input is not read or parsed until some of them
+	 * are processed.
+	 */
+	bool is_throttled;
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
+static struct iproto_msg *
+iproto_msg_new(struct iproto_connection *con)
+{
+	struct iproto_msg *msg = (struct iproto_msg *)
+		mempool_alloc_xc(&con->iproto_thread->msg_pool);
+	msg->connection = con;
+	stailq_create(&msg->out_refs);
+	return msg;
+}
+
+/**
+ * Resume stopped connections, if any.
+ */
+static void
+iproto_resume(struct iproto_thread *thread);
+
+static inline void
+iproto_msg_delete(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct iproto_thread *thread = msg->connection->iproto_thread;
+	mempool_free(&thread->msg_pool, msg);
+	iproto_resume(thread);
+}
 
 /**
  * Returns true if we have enough spare messages
@@ -206,11 +325,23 @@ static RLIST_HEAD(stopped_connections);
  * discounted: they are mostly reserved and idle.
  */
 static inline bool
-iproto_stop_input()
+iproto_stop_input(struct iproto_thread *thread)
+{
+	size_t connection_count = mempool_count(&thread->connection_pool);
+	size_t request_count = mempool_count(&thread->msg_pool);
+	return request_count > connection_count + thread->msg_max;
+}
+
+/**
+ * The number of requests a single connection may have in
+ * flight. A client pipelining lots of requests is throttled
+ * long before it exhausts the limit of the whole thread, so
+ * it can't starve other connections.
+ */
+static inline int
+iproto_connection_msg_quota(struct iproto_connection *con)
 {
-	size_t connection_count = mempool_count(&iproto_connection_pool);
-	size_t request_count = mempool_count(&iproto_msg_pool);
-	return request_count > connection_count + IPROTO_MSG_MAX;
+	return MAX(con->iproto_thread->msg_max / 2, 1);
 }
 
 /**
@@ -220,20 +351,20 @@ iproto_stop_input()
  * object in the message pool.
  */
 static void
-iproto_resume()
+iproto_resume(struct iproto_thread *thread)
 {
 	/*
 	 * Most of the time we have nothing to do here: throttling
 	 * is not active.
 	 */
-	if (rlist_empty(&stopped_connections))
+	if (rlist_empty(&thread->stopped_connections))
 		return;
-	if (iproto_stop_input())
+	if (iproto_stop_input(thread))
 		return;
 
 	struct iproto_connection *con;
-	con = rlist_first_entry(&stopped_connections, struct iproto_connection,
-				in_stop_list);
+	con = rlist_first_entry(&thread->stopped_connections,
+				struct iproto_connection, in_stop_list);
 	ev_feed_event(con->loop, &con->input, EV_READ);
 }
 
@@ -264,7 +395,10 @@ iproto_connection_stop(struct iproto_connection *con)
 {
 	assert(rlist_empty(&con->in_stop_list));
 	ev_io_stop(con->loop, &con->input);
-	rlist_add_tail(&stopped_connections, &con->in_stop_list);
+	rlist_add_tail(&con->iproto_thread->stopped_connections,
+		       &con->in_stop_list);
+	con->stop_time = ev_now(con->loop);
+	rmean_collect(con->iproto_thread->rmean, IPROTO_INPUT_STOPS, 1);
 }
 
 static void
@@ -290,7 +424,7 @@ iproto_connection_delete(struct iproto_connection *con)
 	iobuf_delete_mt(con->iobuf[1]);
 	if (con->disconnect)
 		iproto_msg_delete(con->disconnect);
-	mempool_free(&iproto_connection_pool, con);
+	mempool_free(&con->iproto_thread->connection_pool, con);
 }
 
 static void
@@ -337,6 +471,8 @@ tx_process_disconnect(struct cmsg *m)
 	 */
 	obuf_destroy(&con->iobuf[0]->out);
 	obuf_destroy(&con->iobuf[1]->out);
+	port_refs_release(&con->iobuf[0]->out_refs);
+	port_refs_release(&con->iobuf[1]->out_refs);
 }
 
 /**
@@ -347,58 +483,24 @@ static void
 net_finish_disconnect(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
-	/* Runs the trigger, which may yield. */
-	iproto_connection_delete(msg->connection);
+	struct iproto_connection *con = msg->connection;
+	/*
+	 * Delete the message first: it refers to the
+	 * connection thread.
+	 */
 	iproto_msg_delete(msg);
+	/* Runs the trigger, which may yield. */
+	iproto_connection_delete(con);
 }
 
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL },
-};
-
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	misc_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	misc_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	misc_route                              /* IPROTO_CALL */
-};
-
-static const struct cmsg_hop sync_route[] = {
-	{ tx_process_join_subscribe, &net_pipe },
-	{ net_end_join_subscribe, NULL },
-};
-
 static struct iproto_connection *
-iproto_connection_new(const char *name, int fd)
+iproto_connection_new(struct iproto_thread *thread, int fd)
 {
-	(void) name;
 	struct iproto_connection *con = (struct iproto_connection *)
-		mempool_alloc_xc(&iproto_connection_pool);
+		mempool_alloc_xc(&thread->connection_pool);
 	con->input.data = con->output.data = con;
 	con->loop = loop();
+	con->iproto_thread = thread;
 	ev_io_init(&con->input, iproto_connection_on_input, fd, EV_READ);
 	ev_io_init(&con->output, iproto_connection_on_output, fd, EV_WRITE);
 	con->iobuf[0] = iobuf_new_mt(&tx_cord->slabc);
@@ -406,9 +508,11 @@ iproto_connection_new(const char *name, int fd)
 	con->parse_size = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	con->msg_count = 0;
+	con->is_throttled = false;
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_msg_new(con);
-	cmsg_init(con->disconnect, disconnect_route);
+	cmsg_init(con->disconnect, thread->disconnect_route);
 	return con;
 }
 
@@ -453,7 +557,7 @@ iproto_connection_close(struct iproto_connection *con)
 		assert(con->disconnect != NULL);
 		struct iproto_msg *msg = con->disconnect;
 		con->disconnect = NULL;
-		cpipe_push(&tx_pipe, msg);
+		cpipe_push(&con->iproto_thread->tx_pipe, msg);
 	}
 	rlist_del(&con->in_stop_list);
 }
@@ -555,6 +659,7 @@ static void
 iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
 {
+	struct iproto_thread *thread = msg->connection->iproto_thread;
 	xrow_header_decode_xc(&msg->header, pos, reqend);
 	assert(*pos == reqend);
 	request_create(&msg->request, msg->header.type);
@@ -586,15 +691,16 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 				 (const char *) msg->header.body[0].iov_base,
 				 msg->header.body[0].iov_len,
 				 request_key_map(msg->header.type));
-		assert(msg->header.type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(msg, dml_route[msg->header.type]);
+		assert(msg->header.type < sizeof(thread->dml_route) /
+					  sizeof(*thread->dml_route));
+		cmsg_init(msg, thread->dml_route[msg->header.type]);
 		break;
 	case IPROTO_PING:
-		cmsg_init(msg, misc_route);
+		cmsg_init(msg, thread->misc_route);
 		break;
 	case IPROTO_JOIN:
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(msg, sync_route);
+		cmsg_init(msg, thread->sync_route);
 		*stop_input = true;
 		break;
 	default:
@@ -608,6 +714,7 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 static inline void
 iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 {
+	struct cpipe *tx_pipe = &con->iproto_thread->tx_pipe;
 	int n_requests = 0;
 	bool stop_input = false;
 	while (con->parse_size && stop_input == false) {
@@ -624,6 +731,18 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		const char *reqend = pos + len;
 		if (reqend > in->wpos)
 			break;
+		if (con->msg_count >= iproto_connection_msg_quota(con)) {
+			/*
+			 * Leave the request in the buffer, it
+			 * will be parsed when the connection is
+			 * unthrottled in net_send_msg().
+			 */
+			con->is_throttled = true;
+			con->stop_time = ev_now(con->loop);
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_INPUT_THROTTLES, 1);
+			break;
+		}
 		struct iproto_msg *msg = iproto_msg_new(con);
 		msg->iobuf = con->iobuf[0];
 		IprotoMsgGuard guard(msg);
@@ -632,8 +751,9 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 
 		try {
 			iproto_decode_msg(msg, &pos, reqend, &stop_input);
-			cpipe_push_input(&tx_pipe, guard.release());
+			cpipe_push_input(tx_pipe, guard.release());
 			n_requests++;
+			con->msg_count++;
 		} catch (Exception *e) {
 			/*
 			 * Do not close connection if we failed to
@@ -669,6 +789,8 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_io_stop(con->loop, &con->output);
 		ev_io_stop(con->loop, &con->input);
+	} else if (con->is_throttled) {
+		ev_io_stop(con->loop, &con->input);
 	} else if (n_requests != 1 || con->parse_size != 0) {
 		assert(rlist_empty(&con->in_stop_list));
 		/*
@@ -690,7 +812,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	cpipe_flush_input(tx_pipe);
 }
 
 static void
@@ -699,17 +821,25 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 {
 	struct iproto_connection *con =
 		(struct iproto_connection *) watcher->data;
+	struct iproto_thread *thread = con->iproto_thread;
 	int fd = con->input.fd;
 	assert(fd >= 0);
+	if (con->is_throttled) {
+		/* Wait until the quota is replenished. */
+		ev_io_stop(loop, &con->input);
+		return;
+	}
 	if (! rlist_empty(&con->in_stop_list)) {
 		/* Resumed stopped connection. */
 		rlist_del(&con->in_stop_list);
+		rmean_collect(thread->rmean, IPROTO_INPUT_STOP_MS,
+			      (ev_now(loop) - con->stop_time) * 1000);
 		/*
 		 * This connection may have no input, so
 		 * resume one more connection which might have
 		 * input.
 		 */
-		iproto_resume();
+		iproto_resume(thread);
 	}
 	/*
 	 * Throttle if there are too many pending requests,
@@ -718,7 +848,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	 * another fiber waiting for write to complete).
 	 * Ignore iproto_connection->disconnect messages.
 	 */
-	if (iproto_stop_input()) {
+	if (iproto_stop_input(thread)) {
 		iproto_connection_stop(con);
 		return;
 	}
@@ -743,7 +873,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
+		rmean_collect(thread->rmean, IPROTO_RECEIVED, nrd);
 
 		/* Update the read position and connection state. */
 		in->wpos += nrd;
@@ -762,7 +892,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 static inline struct iobuf *
 iproto_connection_output_iobuf(struct iproto_connection *con)
 {
-	if (obuf_used(&con->iobuf[1]->out) > 0)
+	if (iobuf_has_output(con->iobuf[1]))
 		return con->iobuf[1];
 	/*
 	 * Don't try to write from a newer buffer if an older one
@@ -771,11 +901,28 @@ iproto_connection_output_iobuf(struct iproto_connection *con)
 	 * pieces of replies from both buffers.
 	 */
 	if (ibuf_used(&con->iobuf[1]->in) == 0 &&
-	    obuf_used(&con->iobuf[0]->out) > 0)
+	    iobuf_has_output(con->iobuf[0]))
 		return con->iobuf[0];
 	return NULL;
 }
 
+/**
+ * Send tuples written to the sockets of a thread to tx to
+ * unreference them, unless the previous batch is in flight.
+ */
+static void
+iproto_release_refs(struct iproto_thread *thread)
+{
+	struct iproto_release_msg *msg = &thread->release_msg;
+	if (msg->in_progress || stailq_empty(&thread->written_refs))
+		return;
+	assert(stailq_empty(&msg->refs));
+	stailq_concat(&msg->refs, &thread->written_refs);
+	cmsg_init(msg, thread->release_route);
+	msg->in_progress = true;
+	cpipe_push(&thread->tx_pipe, msg);
+}
+
 /** writev() to the socket and handle the result. */
 
 static int
@@ -784,25 +931,98 @@ iproto_flush(struct iobuf *iobuf, struct iproto_connection *con)
 	int fd = con->output.fd;
 	struct obuf_svp *begin = &iobuf->out.wpos;
 	struct obuf_svp *end = &iobuf->out.wend;
-	assert(begin->used < end->used);
-	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
+	struct stailq *refs = &iobuf->out_refs;
+	assert(begin->used < end->used || !stailq_empty(refs));
 	struct iovec *src = iobuf->out.iov;
-	int iovcnt = end->pos - begin->pos + 1;
 	/*
-	 * iov[i].iov_len may be concurrently modified in tx thread,
-	 * but only for the last position.
+	 * Tuple data referenced by the reply is spliced
+	 * between chunks of the output buffer. iov_ref[i]
+	 * is the reference iov[i] points to, or NULL if
+	 * iov[i] is a chunk of the output buffer.
 	 */
-	memcpy(iov, src + begin->pos, iovcnt * sizeof(struct iovec));
-	sio_add_to_iov(iov, -begin->iov_len);
-	/* *Overwrite* iov_len of the last pos as it may be garbage. */
-	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
+	struct iovec iov[IPROTO_FLUSH_IOV_MAX];
+	struct port_ref *iov_ref[IPROTO_FLUSH_IOV_MAX];
+	while (true) {
+		struct port_ref *ref = NULL;
+		if (!stailq_empty(refs))
+			ref = stailq_first_entry(refs, struct port_ref, in_list);
+		int pos = begin->pos;
+		size_t iov_len = begin->iov_len;
+		size_t used = begin->used;
+		size_t total = 0;
+		int iovcnt = 0;
+		while (iovcnt < IPROTO_FLUSH_IOV_MAX) {
+			if (ref != NULL && ref->offset == used) {
+				iov[iovcnt].iov_base = (void *) ref->data;
+				iov[iovcnt].iov_len = ref->size;
+				iov_ref[iovcnt++] = ref;
+				total += ref->size;
+				struct stailq_entry *next =
+					stailq_next(&ref->in_list);
+				ref = next == NULL ? NULL :
+				      stailq_entry(next, struct port_ref,
+						   in_list);
+				continue;
+			}
+			if (used == end->used)
+				break;
+			/*
+			 * iov[i].iov_len may be concurrently modified
+			 * in tx thread, but only for the last position.
+			 */
+			size_t len = (pos == end->pos ? end->iov_len :
+				      src[pos].iov_len) - iov_len;
+			if (ref != NULL)
+				len = MIN(len, ref->offset - used);
+			assert(len > 0 || pos < end->pos);
+			if (len > 0) {
+				iov[iovcnt].iov_base =
+					(char *) src[pos].iov_base + iov_len;
+				iov[iovcnt].iov_len = len;
+				iov_ref[iovcnt++] = NULL;
+				total += len;
+			}
+			used += len;
+			iov_len += len;
+			if (pos < end->pos && iov_len == src[pos].iov_len) {
+				pos++;
+				iov_len = 0;
+			}
+		}
 
-	ssize_t nwr = sio_writev(fd, iov, iovcnt);
+		ssize_t nwr = sio_writev(fd, iov, iovcnt);
 
-	/* Count statistics */
-	rmean_collect(rmean_net, IPROTO_SENT, nwr);
-	if (nwr > 0) {
-		if (begin->used + nwr == end->used) {
+		/* Count statistics */
+		rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+		if (nwr <= 0)
+			return -1;
+		bool is_partial = (size_t) nwr < total;
+		/* Advance write position. */
+		for (int i = 0; i < iovcnt && nwr > 0; i++) {
+			size_t len = MIN((size_t) nwr, iov[i].iov_len);
+			nwr -= len;
+			ref = iov_ref[i];
+			if (ref != NULL) {
+				ref->data += len;
+				ref->size -= len;
+				if (ref->size > 0)
+					continue;
+				/* The tuple is written out, release it. */
+				stailq_shift(refs);
+				stailq_add_tail_entry(
+					&con->iproto_thread->written_refs,
+					ref, in_list);
+				continue;
+			}
+			begin->used += len;
+			begin->iov_len += len;
+			if (begin->pos < end->pos &&
+			    begin->iov_len == src[begin->pos].iov_len) {
+				begin->pos++;
+				begin->iov_len = 0;
+			}
+		}
+		if (begin->used == end->used && stailq_empty(refs)) {
 			if (ibuf_used(&iobuf->in) == 0) {
 				/* Quickly recycle the buffer if it's idle. */
 				assert(end->used == obuf_size(&iobuf->out));
@@ -814,15 +1034,9 @@ iproto_flush(struct iobuf *iobuf, struct iproto_connection *con)
 			}
 			return 0;
 		}
-		size_t offset = 0;
-		int advance = 0;
-		advance = sio_move_iov(iov, nwr, &offset);
-		begin->used += nwr;             /* advance write position */
-		begin->iov_len = advance == 0 ? begin->iov_len + offset: offset;
-		begin->pos += advance;
-		assert(begin->pos <= end->pos);
+		if (is_partial)
+			return -1;
 	}
-	return -1;
 }
 
 static void
@@ -836,6 +1050,7 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 		while ((iobuf = iproto_connection_output_iobuf(con))) {
 			if (iproto_flush(iobuf, con) < 0) {
 				ev_io_start(loop, &con->output);
+				iproto_release_refs(con->iproto_thread);
 				return;
 			}
 			if (! ev_is_active(&con->input) &&
@@ -849,6 +1064,7 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 		e->log();
 		iproto_connection_close(con);
 	}
+	iproto_release_refs(con->iproto_thread);
 }
 
 static int
@@ -896,6 +1112,7 @@ tx_process_select(struct cmsg *m)
 	struct obuf *out = &msg->iobuf->out;
 	struct obuf_svp svp;
 	struct port port;
+	size_t ref_size;
 	int rc;
 	struct request *req = &msg->request;
 
@@ -913,8 +1130,10 @@ tx_process_select(struct cmsg *m)
 		port_destroy(&port);
 		goto error;
 	}
-	port_dump(&port, out);
-	iproto_reply_select(out, &svp, msg->header.sync, port.size);
+	ref_size = port_dump_refs(&port, out, &msg->out_refs,
+				  IPROTO_TUPLE_REF_MIN_SIZE);
+	iproto_reply_select_ext(out, &svp, msg->header.sync, port.size,
+				ref_size);
 	msg->write_end = obuf_create_svp(out);
 	return;
 error:
@@ -1004,6 +1223,30 @@ tx_process_join_subscribe(struct cmsg *m)
 	}
 }
 
+/**
+ * Resume a connection throttled by its quota of messages in
+ * flight: enqueue requests which are already read up and
+ * continue reading input.
+ */
+static void
+iproto_connection_unthrottle(struct iproto_connection *con)
+{
+	assert(con->is_throttled);
+	con->is_throttled = false;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_INPUT_THROTTLE_MS,
+		      (ev_now(con->loop) - con->stop_time) * 1000);
+	if (! evio_has_fd(&con->input))
+		return;
+	try {
+		iproto_enqueue_batch(con, &con->iobuf[0]->in);
+	} catch (Exception *e) {
+		/* Best effort at sending the error message to the client. */
+		iproto_write_error(con->input.fd, e);
+		e->log();
+		iproto_connection_close(con);
+	}
+}
+
 static void
 net_send_msg(struct cmsg *m)
 {
@@ -1012,7 +1255,9 @@ net_send_msg(struct cmsg *m)
 	struct iobuf *iobuf = msg->iobuf;
 	/* Discard request (see iproto_enqueue_batch()) */
 	iobuf->in.rpos += msg->len;
+	stailq_concat(&iobuf->out_refs, &msg->out_refs);
 	iobuf->out.wend = msg->write_end;
+	con->msg_count--;
 
 	if (evio_has_fd(&con->output)) {
 		if (! ev_is_active(&con->output))
@@ -1020,6 +1265,9 @@ net_send_msg(struct cmsg *m)
 	} else if (iproto_connection_is_idle(con)) {
 		iproto_connection_close(con);
 	}
+	if (con->is_throttled &&
+	    con->msg_count < iproto_connection_msg_quota(con))
+		iproto_connection_unthrottle(con);
 	iproto_msg_delete(msg);
 }
 
@@ -1031,6 +1279,7 @@ net_end_join_subscribe(struct cmsg *m)
 	struct iobuf *iobuf = msg->iobuf;
 
 	iobuf->in.rpos += msg->len;
+	con->msg_count--;
 	iproto_msg_delete(msg);
 
 	assert(! ev_is_active(&con->input));
@@ -1041,6 +1290,23 @@ net_end_join_subscribe(struct cmsg *m)
 	iproto_enqueue_batch(con, &iobuf->in);
 }
 
+/** Unreference tuples written to the sockets of a thread. */
+static void
+tx_release_refs(struct cmsg *m)
+{
+	struct iproto_release_msg *msg = (struct iproto_release_msg *) m;
+	port_refs_release(&msg->refs);
+}
+
+static void
+net_end_release_refs(struct cmsg *m)
+{
+	struct iproto_release_msg *msg = (struct iproto_release_msg *) m;
+	msg->in_progress = false;
+	/* Send the tuples written meanwhile. */
+	iproto_release_refs(msg->thread);
+}
+
 /**
  * Handshake a connection: invoke the on-connect trigger
  * and possibly authenticate. Try to send the client an error
@@ -1090,7 +1356,8 @@ net_send_greeting(struct cmsg *m)
 						 obuf_iovcnt(out));
 
 			/* Count statistics */
-			rmean_collect(rmean_net, IPROTO_SENT, nwr);
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_SENT, nwr);
 		} catch (Exception *e) {
 			e->log();
 		}
@@ -1111,37 +1378,115 @@ net_send_greeting(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
+/** Initialize message routes of a network thread. */
+static void
+iproto_thread_init_routes(struct iproto_thread *thread)
+{
+	struct cpipe *net_pipe = &thread->net_pipe;
+
+	thread->disconnect_route[0] = { tx_process_disconnect, net_pipe };
+	thread->disconnect_route[1] = { net_finish_disconnect, NULL };
+	thread->misc_route[0] = { tx_process_misc, net_pipe };
+	thread->misc_route[1] = { net_send_msg, NULL };
+	thread->select_route[0] = { tx_process_select, net_pipe };
+	thread->select_route[1] = { net_send_msg, NULL };
+	thread->process1_route[0] = { tx_process1, net_pipe };
+	thread->process1_route[1] = { net_send_msg, NULL };
+	thread->sync_route[0] = { tx_process_join_subscribe, net_pipe };
+	thread->sync_route[1] = { net_end_join_subscribe, NULL };
+	thread->connect_route[0] = { tx_process_connect, net_pipe };
+	thread->connect_route[1] = { net_send_greeting, NULL };
+	thread->release_route[0] = { tx_release_refs, net_pipe };
+	thread->release_route[1] = { net_end_release_refs, NULL };
+
+	const struct cmsg_hop **dml_route = thread->dml_route;
+	dml_route[IPROTO_OK] = NULL;
+	dml_route[IPROTO_SELECT] = thread->select_route;
+	dml_route[IPROTO_INSERT] = thread->process1_route;
+	dml_route[IPROTO_REPLACE] = thread->process1_route;
+	dml_route[IPROTO_UPDATE] = thread->process1_route;
+	dml_route[IPROTO_DELETE] = thread->process1_route;
+	dml_route[IPROTO_CALL_16] = thread->misc_route;
+	dml_route[IPROTO_AUTH] = thread->misc_route;
+	dml_route[IPROTO_EVAL] = thread->misc_route;
+	dml_route[IPROTO_UPSERT] = thread->process1_route;
+	dml_route[IPROTO_CALL] = thread->misc_route;
+}
+
 /**
- * Create a connection and start input.
+ * Create a connection in the current network thread
+ * and start input.
  */
 static void
-iproto_on_accept(struct evio_service * /* service */, int fd,
-		 struct sockaddr *addr, socklen_t addrlen)
+iproto_thread_accept(struct iproto_thread *thread, int fd)
 {
-	char name[SERVICE_NAME_MAXLEN];
-	snprintf(name, sizeof(name), "%s/%s", "iobuf",
-		sio_strfaddr(addr, addrlen));
-
-	struct iproto_connection *con;
-
-	con = iproto_connection_new(name, fd);
+	struct iproto_connection *con = iproto_connection_new(thread, fd);
 	/*
 	 * Ignore msg allocation failure - the queue size is
 	 * fixed so there is a limited number of msgs in
 	 * use, all stored in just a few blocks of the memory pool.
 	 */
 	struct iproto_msg *msg = iproto_msg_new(con);
-	cmsg_init(msg, connect_route);
+	cmsg_init(msg, thread->connect_route);
 	msg->iobuf = con->iobuf[0];
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, msg);
+	cpipe_push(&thread->tx_pipe, msg);
+}
+
+/** A message passing an accepted socket to another thread. */
+struct iproto_accept_msg: public cmsg
+{
+	struct iproto_thread *thread;
+	int fd;
+};
+
+static void
+net_accept_remote(struct cmsg *m)
+{
+	struct iproto_accept_msg *msg = (struct iproto_accept_msg *) m;
+	struct iproto_thread *thread = msg->thread;
+	int fd = msg->fd;
+	/* Allocated with malloc() in the first thread. */
+	free(msg);
+	try {
+		iproto_thread_accept(thread, fd);
+	} catch (Exception *e) {
+		close(fd);
+		e->log();
+	}
+}
+
+static const struct cmsg_hop accept_route[] = {
+	{ net_accept_remote, NULL },
+};
+
+/**
+ * Choose a network thread for a new connection and
+ * create the connection there. Runs in the first thread.
+ */
+static void
+iproto_on_accept(struct evio_service * /* service */, int fd,
+		 struct sockaddr * /* addr */, socklen_t /* addrlen */)
+{
+	static unsigned accept_count;
+	struct iproto_thread *thread =
+		&iproto_threads[accept_count++ % iproto_thread_count];
+	if (thread == &iproto_threads[0]) {
+		iproto_thread_accept(thread, fd);
+		return;
+	}
+	struct iproto_accept_msg *msg = (struct iproto_accept_msg *)
+		malloc(sizeof(*msg));
+	if (msg == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*msg), "malloc",
+			  "struct iproto_accept_msg");
+	}
+	cmsg_init(msg, accept_route);
+	msg->thread = thread;
+	msg->fd = fd;
+	cpipe_push(&thread->accept_pipe, msg);
 }
 
 static struct evio_service binary; /* iproto binary listener */
@@ -1151,62 +1496,120 @@ static struct evio_service binary; /* iproto binary listener */
  * begin serving the message bus.
  */
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
+	struct iproto_thread *thread = va_arg(ap, struct iproto_thread *);
 	/* Got to be called in every thread using iobuf */
 	iobuf_init();
-	mempool_create(&iproto_msg_pool, &cord()->slabc,
+	mempool_create(&thread->msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
-	mempool_create(&iproto_connection_pool, &cord()->slabc,
+	mempool_create(&thread->connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
 
-	evio_service_init(loop(), &binary, "binary",
-			  iproto_on_accept, NULL);
-
-
 	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	thread->rmean = rmean_new(rmean_net_strings, IPROTO_LAST);
 
-	if (rmean_net == NULL) {
+	if (thread->rmean == NULL) {
 		tnt_raise(OutOfMemory, sizeof(struct rmean),
 			  "rmean", "struct rmean");
 	}
 
 	struct cbus_endpoint endpoint;
-	/* Create "net" endpoint. */
-	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
+	/* Create the thread endpoint. */
+	cbus_endpoint_create(&endpoint, thread->name, fiber_schedule_cb,
+			     fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
-	cpipe_set_max_input(&tx_pipe, IPROTO_MSG_MAX/2);
+	cpipe_create(&thread->tx_pipe, "tx");
+	cpipe_set_max_input(&thread->tx_pipe, thread->msg_max / 2);
+	if (thread->id == 0) {
+		/*
+		 * The first thread owns the listening socket
+		 * and hands accepted connections over to the
+		 * other threads.
+		 */
+		evio_service_init(loop(), &binary, "binary",
+				  iproto_on_accept, NULL);
+		for (int i = 1; i < iproto_thread_count; i++)
+			cpipe_create(&iproto_threads[i].accept_pipe,
+				     iproto_threads[i].name);
+	}
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
 
-	cpipe_destroy(&tx_pipe);
+	if (thread->id == 0) {
+		for (int i = 1; i < iproto_thread_count; i++)
+			cpipe_destroy(&iproto_threads[i].accept_pipe);
+	}
+	cpipe_destroy(&thread->tx_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
-	if (evio_service_is_active(&binary))
+	if (thread->id == 0 && evio_service_is_active(&binary))
 		evio_service_stop(&binary);
 
-	rmean_delete(rmean_net);
+	rmean_delete(thread->rmean);
 	return 0;
 }
 
-/** Initialize the iproto subsystem and start network io thread */
+/** Initialize the iproto subsystem and start network io threads */
 void
-iproto_init()
+iproto_init(int thread_count, int msg_max)
 {
+	assert(thread_count > 0);
 	tx_cord = cord();
 
-	static struct cord net_cord;
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
-		panic("failed to initialize iproto thread");
+	iproto_threads = (struct iproto_thread *)
+		calloc(thread_count, sizeof(struct iproto_thread));
+	if (iproto_threads == NULL)
+		panic("failed to allocate iproto threads");
+	iproto_thread_count = thread_count;
+
+	for (int i = 0; i < thread_count; i++) {
+		struct iproto_thread *thread = &iproto_threads[i];
+		thread->id = i;
+		/* Keep the name of the first thread for compatibility. */
+		if (i == 0)
+			snprintf(thread->name, sizeof(thread->name), "net");
+		else
+			snprintf(thread->name, sizeof(thread->name),
+				 "net%d", i);
+		thread->msg_max = MAX(msg_max / thread_count,
+				      IPROTO_MSG_MAX_MIN);
+		rlist_create(&thread->stopped_connections);
+		stailq_create(&thread->written_refs);
+		thread->release_msg.thread = thread;
+		stailq_create(&thread->release_msg.refs);
+		iproto_thread_init_routes(thread);
+		if (cord_costart(&thread->cord, i == 0 ? "iproto" :
+				 thread->name, net_cord_f, thread))
+			panic("failed to initialize iproto thread");
+		/* Create a pipe to the network thread. */
+		cpipe_create(&thread->net_pipe, thread->name);
+		cpipe_set_max_input(&thread->net_pipe, thread->msg_max / 2);
+	}
+}
 
-	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
-	cpipe_set_max_input(&net_pipe, IPROTO_MSG_MAX/2);
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx)
+{
+	for (size_t i = 0; i < IPROTO_LAST; i++) {
+		int64_t mean = 0;
+		int64_t total = 0;
+		for (int t = 0; t < iproto_thread_count; t++) {
+			struct rmean *rmean = iproto_threads[t].rmean;
+			/* Not started yet. */
+			if (rmean == NULL)
+				continue;
+			mean += rmean_mean(rmean, i);
+			total += rmean_total(rmean, i);
+		}
+		int res = cb(rmean_net_strings[i], mean, total, cb_ctx);
+		if (res != 0)
+			return res;
+	}
+	return 0;
 }
 
 /**
@@ -1253,7 +1656,8 @@ iproto_bind(const char *uri)
 {
 	static struct iproto_bind_msg m;
 	m.uri = uri;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_bind,
+	struct iproto_thread *thread = &iproto_threads[0];
+	if (cbus_call(&thread->net_pipe, &thread->tx_pipe, &m, iproto_do_bind,
 		      NULL, TIMEOUT_INFINITY))
 		diag_raise();
 }
@@ -1263,9 +1667,45 @@ iproto_listen()
 {
 	/* Declare static to avoid stack corruption on fiber cancel. */
 	static struct cbus_call_msg m;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_listen,
+	struct iproto_thread *thread = &iproto_threads[0];
+	if (cbus_call(&thread->net_pipe, &thread->tx_pipe, &m, iproto_do_listen,
 		      NULL, TIMEOUT_INFINITY))
 		diag_raise();
 }
 
+struct iproto_cfg_msg: public cbus_call_msg
+{
+	struct iproto_thread *thread;
+	int msg_max;
+};
+
+static int
+iproto_do_cfg(struct cbus_call_msg *m)
+{
+	struct iproto_cfg_msg *msg = (struct iproto_cfg_msg *) m;
+	struct iproto_thread *thread = msg->thread;
+	thread->msg_max = msg->msg_max;
+	cpipe_set_max_input(&thread->tx_pipe, thread->msg_max / 2);
+	/* The limit may have been raised. */
+	iproto_resume(thread);
+	return 0;
+}
+
+void
+iproto_set_msg_max(int msg_max)
+{
+	/* Declare static to avoid stack corruption on fiber cancel. */
+	static struct iproto_cfg_msg m;
+	for (int i = 0; i < iproto_thread_count; i++) {
+		struct iproto_thread *thread = &iproto_threads[i];
+		m.thread = thread;
+		m.msg_max = MAX(msg_max / iproto_thread_count,
+				IPROTO_MSG_MAX_MIN);
+		cpipe_set_max_input(&thread->net_pipe, m.msg_max / 2);
+		if (cbus_call(&thread->net_pipe, &thread->tx_pipe, &m,
+			      iproto_do_cfg, NULL, TIMEOUT_INFINITY))
+			diag_raise();
+	}
+}
+
 /* vim: set foldmethod=marker */
@@ -30,8 +30,40 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include "rmean.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+enum {
+	/** Maximal number of network io threads. */
+	IPROTO_THREADS_MAX = 1000,
+	/**
+	 * Minimal number of messages in flight allowed
+	 * in each network thread.
+	 */
+	IPROTO_MSG_MAX_MIN = 2,
+};
+
+/**
+ * Iterate over network statistics (box.stat.net()),
+ * summed up over all network threads.
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+
+/**
+ * Start @a thread_count network io threads. Accepted
+ * connections are distributed among them evenly.
+ * @a msg_max is the initial limit of requests in flight,
+ * see iproto_set_msg_max().
+ */
 void
-iproto_init();
+iproto_init(int thread_count, int msg_max);
 
 void
 iproto_bind(const char *uri);
@@ -39,4 +71,13 @@ iproto_bind(const char *uri);
 void
 iproto_listen();
 
+/**
+ * Set the limit of requests in flight, see box.cfg.net_msg_max.
+ * The limit is split evenly between the network threads.
+ */
+void
+iproto_set_msg_max(int msg_max);
+
+#endif /* defined(__cplusplus) */
+
 #endif
@@ -182,7 +182,8 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"min key",
 	"max key",
 	"page count",
-	"bloom filter"
+	"bloom filter",
+	"prefix bloom filters"
 };
 
 const char *vy_page_index_key_strs[VY_PAGE_INDEX_KEY_MAX] = {
@@ -281,8 +281,10 @@ enum vy_run_info_key {
 	VY_RUN_INFO_PAGE_COUNT = 3,
 	/** Bloom filter for keys. */
 	VY_RUN_INFO_BLOOM = 4,
+	/** Bloom filters for key prefixes. */
+	VY_RUN_INFO_PREFIX_BLOOMS = 5,
 	/** The last key in this enum + 1 */
-	VY_RUN_INFO_KEY_MAX = VY_RUN_INFO_BLOOM + 1
+	VY_RUN_INFO_KEY_MAX = VY_RUN_INFO_PREFIX_BLOOMS + 1
 };
 
 /**
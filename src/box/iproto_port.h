@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include <stdint.h>
+#include <stddef.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -49,6 +50,15 @@ iproto_prepare_select(struct obuf *buf, struct obuf_svp *svp);
 void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t count);
+
+/**
+ * Like iproto_reply_select(), but the reply body has
+ * @a ext_size more bytes, which are not in the buffer
+ * and are sent separately, see port_dump_refs().
+ */
+void
+iproto_reply_select_ext(struct obuf *buf, struct obuf_svp *svp,
+			uint64_t sync, uint32_t count, size_t ext_size);
 #if defined(__cplusplus)
 } /*  extern "C" */
 
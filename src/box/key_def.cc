@@ -120,7 +120,9 @@ const struct index_opts index_opts_default = {
 	/* .page_size           = */ 0,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .bloom_prefix_parts  = */ 0,
 	/* .lsn                 = */ 0,
+	/* .hint                = */ true,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -131,7 +133,9 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT, struct index_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
+	OPT_DEF("bloom_prefix_parts", OPT_INT, struct index_opts, bloom_prefix_parts),
 	OPT_DEF("lsn", OPT_INT, struct index_opts, lsn),
+	OPT_DEF("hint", OPT_BOOL, struct index_opts, hint),
 	{ NULL, opt_type_MAX, 0, 0 },
 };
 
@@ -205,10 +205,23 @@ struct index_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Number of key prefixes to build bloom filters for,
+	 * in addition to the full key one. If N > 0, each
+	 * run stores a bloom filter of the first 1, 2, ..., N
+	 * key parts, which lets EQ lookups by a partial key
+	 * skip runs.
+	 */
+	int64_t bloom_prefix_parts;
 	/**
 	 * LSN from the time of index creation.
 	 */
 	int64_t lsn;
+	/**
+	 * Store hints of the first key part along with tuples
+	 * in a memtx TREE index to speed up comparisons.
+	 */
+	bool hint;
 };
 
 extern const struct index_opts index_opts_default;
@@ -223,6 +236,8 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		return o1->dimension < o2->dimension ? -1 : 1;
 	if (o1->distance != o2->distance)
 		return o1->distance < o2->distance ? -1 : 1;
+	if (o1->hint != o2->hint)
+		return o1->hint < o2->hint ? -1 : 1;
 	return 0;
 }
 
@@ -109,6 +109,61 @@ lbox_cfg_set_readahead(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_net_msg_max(struct lua_State *L)
+{
+	try {
+		box_set_net_msg_max();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_batch_size(struct lua_State *L)
+{
+	try {
+		box_set_replication_batch_size();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_apply_fibers(struct lua_State *L)
+{
+	try {
+		box_set_replication_apply_fibers();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_sync_quorum(struct lua_State *L)
+{
+	try {
+		box_set_replication_sync_quorum();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_sync_timeout(struct lua_State *L)
+{
+	try {
+		box_set_replication_sync_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_io_collect_interval(struct lua_State *L)
 {
@@ -142,6 +197,39 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_vinyl_dump_threads(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_dump_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_vinyl_compact_io_rate_limit(struct lua_State *L)
+{
+	try {
+		box_set_vinyl_compact_io_rate_limit();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_snapshot_threads(struct lua_State *L)
+{
+	try {
+		box_set_snapshot_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -165,9 +253,17 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_replication", lbox_cfg_set_replication},
 		{"cfg_set_log_level", lbox_cfg_set_log_level},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
+		{"cfg_set_net_msg_max", lbox_cfg_set_net_msg_max},
+		{"cfg_set_replication_batch_size", lbox_cfg_set_replication_batch_size},
+		{"cfg_set_replication_apply_fibers", lbox_cfg_set_replication_apply_fibers},
+		{"cfg_set_replication_sync_quorum", lbox_cfg_set_replication_sync_quorum},
+		{"cfg_set_replication_sync_timeout", lbox_cfg_set_replication_sync_timeout},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_vinyl_dump_threads", lbox_cfg_set_vinyl_dump_threads},
+		{"cfg_set_vinyl_compact_io_rate_limit", lbox_cfg_set_vinyl_compact_io_rate_limit},
+		{"cfg_set_snapshot_threads", lbox_cfg_set_snapshot_threads},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{NULL, NULL}
 	};
@@ -36,6 +36,8 @@
 #include "box/lua/info.h"
 #include "box/lua/tuple.h"
 #include "box/lua/misc.h" /* lbox_encode_tuple_on_gc() */
+#include "fiber.h" /* fiber->gc */
+#include <msgpuck/msgpuck.h>
 
 /** {{{ box.index Lua library: access to spaces and indexes
  */
@@ -169,6 +171,47 @@ lbox_index_get(lua_State *L)
 	return luaT_pushtupleornil(L, tuple);
 }
 
+static int
+lbox_index_get_many(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage index.get_many(space_id, index_id, "
+				  "keys)");
+
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	struct region *gc = &fiber()->gc;
+	size_t used = region_used(gc);
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+	const char *p = keys;
+	uint32_t count = mp_decode_array(&p);
+
+	struct tuple **result = (struct tuple **)
+		region_alloc(gc, count * sizeof(*result));
+	if (result == NULL) {
+		region_truncate(gc, used);
+		return luaL_error(L, "Failed to allocate %u bytes for result",
+				  (unsigned) (count * sizeof(*result)));
+	}
+	if (box_index_get_many(space_id, index_id, keys, keys + keys_len,
+			       result) != 0) {
+		region_truncate(gc, used);
+		return luaT_error(L);
+	}
+	/* The same caveat as in lbox_select() applies on Lua errors. */
+	lua_createtable(L, count, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (result[i] == NULL)
+			continue;
+		luaT_pushtuple(L, result[i]);
+		lua_rawseti(L, -2, i + 1);
+		box_tuple_unref(result[i]);
+	}
+	region_truncate(gc, used);
+	return 1;
+}
+
 static int
 lbox_index_min(lua_State *L)
 {
@@ -343,6 +386,7 @@ box_lua_index_init(struct lua_State *L)
 		{"delete",  lbox_index_delete},
 		{"random", lbox_index_random},
 		{"get",  lbox_index_get},
+		{"get_many", lbox_index_get_many},
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
@@ -49,6 +49,7 @@
 #include "box/box.h"
 #include "lua/utils.h"
 #include "fiber.h"
+#include "histogram.h"
 
 #include "box/vinyl.h"
 
@@ -106,6 +107,28 @@ lbox_pushrelay(lua_State *L, struct relay *relay)
 	lua_pushstring(L, "vclock");
 	lbox_pushvclock(L, relay_vclock(relay));
 	lua_settable(L, -3);
+
+	const struct relay_stat *stat = relay_stat(relay);
+	lua_pushstring(L, "batches");
+	luaL_pushuint64(L, stat->batch_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "rows");
+	luaL_pushuint64(L, stat->row_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "bytes");
+	luaL_pushuint64(L, stat->byte_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "flush_latency");
+	lua_pushnumber(L, stat->batch_count > 0 ?
+		       stat->flush_latency / stat->batch_count : 0);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "flush_latency_max");
+	lua_pushnumber(L, stat->flush_latency_max);
+	lua_settable(L, -3);
 }
 
 static void
@@ -138,6 +161,9 @@ lbox_pushreplica(lua_State *L, struct replica *replica)
 	if (relay != NULL) {
 		lua_pushstring(L, "downstream");
 		lbox_pushrelay(L, relay);
+		lua_pushstring(L, "ack_lsn");
+		luaL_pushint64(L, replica->ack_lsn);
+		lua_settable(L, -3);
 		lua_settable(L, -3);
 	}
 }
@@ -334,6 +360,68 @@ luaT_info_handler_create(struct info_handler *h, struct lua_State *L)
 extern struct vy_env *
 vinyl_engine_get_env();
 
+/* Declared in memtx_engine.cc */
+extern void
+memtx_engine_info(struct info_handler *h);
+
+static void
+lbox_pushhistogram(struct lua_State *L, struct histogram *hist)
+{
+	lua_newtable(L);
+
+	lua_pushstring(L, "count");
+	luaL_pushuint64(L, hist->total);
+	lua_settable(L, -3);
+
+	static const int pcts[] = {50, 90, 99};
+	for (unsigned i = 0; i < lengthof(pcts); i++) {
+		char name[8];
+		snprintf(name, sizeof(name), "p%d", pcts[i]);
+		lua_pushstring(L, name);
+		lua_pushnumber(L, histogram_percentile(hist, pcts[i]) / 1e6);
+		lua_settable(L, -3);
+	}
+
+	lua_pushstring(L, "max");
+	lua_pushnumber(L, hist->max / 1e6);
+	lua_settable(L, -3);
+}
+
+static int
+lbox_info_sync(struct lua_State *L)
+{
+	struct replicaset_sync_stat *stat = &replicaset_sync_stat;
+	lua_newtable(L);
+
+	lua_pushstring(L, "quorum");
+	lua_pushinteger(L, replication_sync_quorum);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "confirmed_lsn");
+	luaL_pushint64(L, stat->confirmed_lsn);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "waiting");
+	lua_pushinteger(L, stat->waiting);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "timeouts");
+	luaL_pushint64(L, stat->timeouts);
+	lua_settable(L, -3);
+
+	/* Commit latency, in seconds, by the quorum size. */
+	lua_pushstring(L, "latency");
+	lua_newtable(L);
+	for (int i = 0; i < VCLOCK_MAX; i++) {
+		if (stat->latency[i] == NULL)
+			continue;
+		lbox_pushhistogram(L, stat->latency[i]);
+		lua_rawseti(L, -2, i);
+	}
+	lua_settable(L, -3);
+	return 1;
+}
+
 static int
 lbox_info_vinyl_call(struct lua_State *L)
 {
@@ -359,6 +447,31 @@ lbox_info_vinyl(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_info_memtx_call(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	memtx_engine_info(&h);
+	return 1;
+}
+
+static int
+lbox_info_memtx(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	lua_newtable(L); /* metatable */
+
+	lua_pushstring(L, "__call");
+	lua_pushcfunction(L, lbox_info_memtx_call);
+	lua_settable(L, -3);
+
+	lua_setmetatable(L, -2);
+
+	return 1;
+}
+
 static const struct luaL_reg
 lbox_info_dynamic_meta [] =
 {
@@ -370,10 +483,12 @@ lbox_info_dynamic_meta [] =
 	{"ro", lbox_info_ro},
 	{"replication", lbox_info_replication},
 	{"status", lbox_info_status},
+	{"sync", lbox_info_sync},
 	{"uptime", lbox_info_uptime},
 	{"pid", lbox_info_pid},
 	{"cluster", lbox_info_cluster},
 	{"vinyl", lbox_info_vinyl},
+	{"memtx", lbox_info_memtx},
 	{NULL, NULL}
 };
 
@@ -20,7 +20,10 @@ local default_cfg = {
     vinyl_dir           = '.',
     vinyl_memory        = 128 * 1024 * 1024,
     vinyl_cache         = 128 * 1024 * 1024,
+    vinyl_page_cache    = 64 * 1024 * 1024,
     vinyl_threads       = 2,
+    vinyl_dump_threads  = 1,
+    vinyl_compact_io_rate_limit = nil, -- no limit
     vinyl_run_count_per_level = 2,
     vinyl_run_size_ratio      = 3.5,
     vinyl_range_size          = 1024 * 1024 * 1024,
@@ -31,7 +34,10 @@ local default_cfg = {
     log_level           = 5,
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_threads      = 1,
+    net_msg_max         = 768,
     snap_io_rate_limit  = nil, -- no limit
+    snapshot_threads    = 1,
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     rows_per_wal        = 500000,
@@ -39,6 +45,10 @@ local default_cfg = {
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
     replication         = nil,
+    replication_batch_size = 1,
+    replication_apply_fibers = 1,
+    replication_sync_quorum = 0,
+    replication_sync_timeout = 10,
     custom_proc_title   = nil,
     pid_file            = nil,
     background          = false,
@@ -66,7 +76,10 @@ local template_cfg = {
     vinyl_dir           = 'string',
     vinyl_memory        = 'number',
     vinyl_cache               = 'number',
+    vinyl_page_cache          = 'number',
     vinyl_threads             = 'number',
+    vinyl_dump_threads        = 'number',
+    vinyl_compact_io_rate_limit = 'number',
     vinyl_run_count_per_level = 'number',
     vinyl_run_size_ratio      = 'number',
     vinyl_range_size          = 'number',
@@ -78,7 +91,10 @@ local template_cfg = {
     log_level           = 'number',
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_threads      = 'number',
+    net_msg_max         = 'number',
     snap_io_rate_limit  = 'number',
+    snapshot_threads    = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
@@ -86,6 +102,10 @@ local template_cfg = {
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
+    replication_batch_size = 'number',
+    replication_apply_fibers = 'number',
+    replication_sync_quorum = 'number',
+    replication_sync_timeout = 'number',
     custom_proc_title   = 'string',
     pid_file            = 'string',
     background          = 'boolean',
@@ -133,11 +153,19 @@ local log_cfg_option = {
 local dynamic_cfg = {
     listen                  = private.cfg_set_listen,
     replication             = private.cfg_set_replication,
+    replication_batch_size  = private.cfg_set_replication_batch_size,
+    replication_apply_fibers = private.cfg_set_replication_apply_fibers,
+    replication_sync_quorum = private.cfg_set_replication_sync_quorum,
+    replication_sync_timeout = private.cfg_set_replication_sync_timeout,
     log_level               = private.cfg_set_log_level,
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
+    net_msg_max             = private.cfg_set_net_msg_max,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snapshot_threads        = private.cfg_set_snapshot_threads,
+    vinyl_dump_threads      = private.cfg_set_vinyl_dump_threads,
+    vinyl_compact_io_rate_limit = private.cfg_set_vinyl_compact_io_rate_limit,
     read_only               = private.cfg_set_read_only,
     -- snapshot_daemon
     checkpoint_interval     = box.internal.snapshot_daemon.set_checkpoint_interval,
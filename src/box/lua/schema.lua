@@ -309,6 +309,7 @@ box.schema.space.drop = function(space_id, space_name, opts)
     local _space = box.space[box.schema.SPACE_ID]
     local _index = box.space[box.schema.INDEX_ID]
     local _priv = box.space[box.schema.PRIV_ID]
+    local _truncate = box.space[box.schema.TRUNCATE_ID]
     local keys = _index:select(space_id)
     for i = #keys, 1, -1 do
         local v = keys[i]
@@ -318,6 +319,7 @@ box.schema.space.drop = function(space_id, space_name, opts)
     for k, tuple in pairs(privs) do
         box.schema.user.revoke(tuple[2], tuple[5], tuple[3], tuple[4])
     end
+    _truncate:delete{space_id}
     if _space:delete{space_id} == nil then
         if space_name == nil then
             space_name = '#'..tostring(space_id)
@@ -393,6 +395,8 @@ box.schema.index.create = function(space_id, name, options)
         range_size = 'number',
         run_count_per_level = 'number',
         run_size_ratio = 'number',
+        bloom_prefix_parts = 'number',
+        hint = 'boolean',
     }
     check_param_table(options, options_template)
     local options_defaults = {
@@ -460,6 +464,8 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            bloom_prefix_parts = options.bloom_prefix_parts,
+            hint = options.hint,
             lsn = box.info.signature,
     }
     local field_type_aliases = {
@@ -519,6 +525,7 @@ box.schema.index.alter = function(space_id, index_id, options)
         unique = 'boolean',
         dimension = 'number',
         distance = 'string',
+        hint = 'boolean',
     }
     check_param_table(options, options_template)
 
@@ -588,6 +595,9 @@ box.schema.index.alter = function(space_id, index_id, options)
     if options.distance ~= nil then
         index_opts.distance = options.distance
     end
+    if options.hint ~= nil then
+        index_opts.hint = options.hint
+    end
     if options.parts ~= nil then
         check_index_parts(options.parts)
         options.parts = update_index_parts(options.parts)
@@ -871,6 +881,19 @@ function box.schema.space.bless(space)
         return internal.get(index.space_id, index.id, key)
     end
 
+    index_mt.get_many = function(index, keys)
+        check_index_arg(index, 'get_many')
+        if type(keys) ~= 'table' then
+            box.error(box.error.PROC_LUA,
+                      "Usage: index:get_many({key1, key2, ...})")
+        end
+        local k = {}
+        for i, key in ipairs(keys) do
+            k[i] = keify(key)
+        end
+        return internal.get_many(index.space_id, index.id, k)
+    end
+
     local function check_select_opts(opts, key_is_nil)
         local offset = 0
         local limit = 4294967295
@@ -991,6 +1014,10 @@ function box.schema.space.bless(space)
         check_space_arg(space, 'get')
         return check_primary_index(space):get(key)
     end
+    space_mt.get_many = function(space, keys)
+        check_space_arg(space, 'get_many')
+        return check_primary_index(space):get_many(keys)
+    end
     space_mt.select = function(space, key, opts)
         check_space_arg(space, 'select')
         return check_primary_index(space):select(key, opts)
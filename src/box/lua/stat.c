@@ -39,11 +39,12 @@
 #include <lualib.h>
 
 #include "lua/utils.h"
+#include "box/iproto.h"
+#include "cbus.h"
+#include "fiber.h"
 
 extern struct rmean *rmean_box;
 extern struct rmean *rmean_error;
-/** network statistics (iproto & cbus) */
-extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -113,14 +114,76 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	luaL_checkstring(L, -1);
-	return rmean_foreach(rmean_net, seek_stat_item, L);
+	return iproto_rmean_foreach(seek_stat_item, L);
 }
 
 static int
 lbox_stat_net_call(struct lua_State *L)
 {
 	lua_newtable(L);
-	rmean_foreach(rmean_net, set_stat_item, L);
+	iproto_rmean_foreach(set_stat_item, L);
+	return 1;
+}
+
+static int
+cpipe_stat_copy(const struct cpipe_stat *stat, void *cb_ctx)
+{
+	struct region *region = (struct region *) cb_ctx;
+	struct cpipe_stat *copy = (struct cpipe_stat *)
+		region_alloc(region, sizeof(*copy));
+	if (copy == NULL) {
+		diag_set(OutOfMemory, sizeof(*copy), "region",
+			 "struct cpipe_stat");
+		return -1;
+	}
+	*copy = *stat;
+	return 0;
+}
+
+/**
+ * box.stat.cbus() - statistics of the pipes between threads:
+ * the current cap of staged messages and flush counters.
+ */
+static int
+lbox_stat_cbus(struct lua_State *L)
+{
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	/*
+	 * Copy the statistics first: the bus is locked while
+	 * the callback runs, and Lua may throw.
+	 */
+	if (cbus_foreach_pipe(cpipe_stat_copy, region) != 0) {
+		region_truncate(region, used);
+		return luaT_error(L);
+	}
+	size_t size = region_used(region) - used;
+	struct cpipe_stat *stats = NULL;
+	if (size > 0) {
+		stats = (struct cpipe_stat *) region_join(region, size);
+		if (stats == NULL) {
+			region_truncate(region, used);
+			diag_set(OutOfMemory, size, "region", "region_join");
+			return luaT_error(L);
+		}
+	}
+	int count = size / sizeof(struct cpipe_stat);
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++) {
+		lua_createtable(L, 0, 5);
+		lua_pushstring(L, stats[i].producer);
+		lua_setfield(L, -2, "producer");
+		lua_pushstring(L, stats[i].consumer);
+		lua_setfield(L, -2, "consumer");
+		lua_pushinteger(L, stats[i].max_input);
+		lua_setfield(L, -2, "max_input");
+		luaL_pushint64(L, stats[i].flushes);
+		lua_setfield(L, -2, "flushes");
+		luaL_pushint64(L, stats[i].messages);
+		lua_setfield(L, -2, "messages");
+		lua_rawseti(L, -2, i + 1);
+	}
+	region_truncate(region, used);
 	return 1;
 }
 
@@ -144,7 +207,12 @@ box_lua_stat_init(struct lua_State *L)
 		{NULL, NULL}
 	};
 
-	luaL_register_module(L, "box.stat", statlib);
+	static const struct luaL_reg lbox_stat_lib [] = {
+		{"cbus", lbox_stat_cbus},
+		{NULL, NULL}
+	};
+
+	luaL_register_module(L, "box.stat", lbox_stat_lib);
 
 	lua_newtable(L);
 	luaL_register(L, NULL, lbox_stat_meta);
@@ -53,6 +53,7 @@ local function set_system_triggers(val)
     box.space._user:run_triggers(val)
     box.space._func:run_triggers(val)
     box.space._priv:run_triggers(val)
+    box.space._truncate:run_triggers(val)
 end
 
 --------------------------------------------------------------------------------
@@ -65,6 +66,7 @@ local function erase()
     truncate(box.space._user)
     truncate(box.space._func)
     truncate(box.space._priv)
+    truncate(box.space._truncate)
     --truncate(box.space._schema)
     box.space._schema:delete('version')
     box.space._schema:delete('max_id')
@@ -533,6 +535,41 @@ local function upgrade_to_1_7_2()
     box.space._schema:replace({'version', 1, 7, 2})
 end
 
+--------------------------------------------------------------------------------
+-- Tarantool 1.7.5
+--------------------------------------------------------------------------------
+
+local function create_truncate_space()
+    local _space = box.space[box.schema.SPACE_ID]
+    local _index = box.space[box.schema.INDEX_ID]
+    local _priv = box.space[box.schema.PRIV_ID]
+    local _truncate = box.space[box.schema.TRUNCATE_ID]
+    local MAP = setmap({})
+
+    log.info("create space _truncate")
+    _space:insert{_truncate.id, ADMIN, '_truncate', 'memtx', 0, MAP,
+                  {{name = 'id', type = 'num'}, {name = 'count', type = 'num'}}}
+
+    log.info("create index primary on _truncate")
+    _index:insert{_truncate.id, 0, 'primary', 'tree', {unique = true},
+                  {{0, 'unsigned'}}}
+
+    -- everyone can truncate spaces they own
+    log.info("grant write on space _truncate to public")
+    _priv:insert{ADMIN, PUBLIC, 'space', _truncate.id, 2}
+end
+
+local function upgrade_to_1_7_5()
+    if VERSION_ID >= version_id(1, 7, 5) then
+        return
+    end
+
+    create_truncate_space()
+
+    log.info("set schema version to 1.7.5")
+    box.space._schema:replace({'version', 1, 7, 5})
+end
+
 --------------------------------------------------------------------------------
 
 local function upgrade()
@@ -549,6 +586,7 @@ local function upgrade()
     upgrade_to_1_6_8()
     upgrade_to_1_7_1()
     upgrade_to_1_7_2()
+    upgrade_to_1_7_5()
 end
 
 local function bootstrap()
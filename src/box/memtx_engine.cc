@@ -32,6 +32,7 @@
 #include "memtx_space.h"
 #include "memtx_tuple.h"
 
+#include "coeio.h"
 #include "coeio_file.h"
 #include "scoped_guard.h"
 
@@ -46,6 +47,8 @@
 #include "schema.h"
 
 #include "gc.h"
+#include "tt_pthread.h"
+#include "info.h"
 
 /** For all memory used by all indexes.
  * If you decide to use memtx_index_arena or
@@ -86,6 +89,88 @@ memtx_end_build_primary_key(struct space *space, void *param)
 	handler->replace = memtx_replace_primary_key;
 }
 
+enum {
+	/**
+	 * Sort TREE indexes with at least this many tuples
+	 * in the coeio thread pool.
+	 */
+	MEMTX_BUILD_PARALLEL_MIN = 10000,
+};
+
+static ssize_t
+memtx_tree_sort_cb(va_list ap)
+{
+	MemtxTree *index = va_arg(ap, MemtxTree *);
+	index->sortBuild();
+	return 0;
+}
+
+/** A fiber waiting for a TREE index to be sorted by coeio. */
+static int
+memtx_tree_sort_f(va_list ap)
+{
+	MemtxTree *index = va_arg(ap, MemtxTree *);
+	if (coio_call(memtx_tree_sort_cb, index) != 0) {
+		/* Failed to create a task, sort in place. */
+		index->sortBuild();
+	}
+	return 0;
+}
+
+/**
+ * Build the secondary indexes of a space. Sorting, which
+ * dominates the build of a big TREE index, is done in coeio
+ * threads, several indexes at a time, while the rest of
+ * the indexes are built in the tx thread.
+ *
+ * @retval 0 for success
+ * @retval -1 for error, check diag
+ */
+static int
+memtx_build_secondary_keys_parallel(struct space *space)
+{
+	MemtxIndex *pk = (MemtxIndex *) space->index[0];
+	struct fiber *sorters[BOX_INDEX_MAX];
+	memset(sorters, 0, sizeof(sorters));
+	int rc = 0;
+	try {
+		for (uint32_t j = 1; j < space->index_count; j++) {
+			MemtxIndex *index = (MemtxIndex *) space->index[j];
+			if (index->index_def->type != TREE ||
+			    pk->size() < MEMTX_BUILD_PARALLEL_MIN) {
+				index_build(index, pk);
+				continue;
+			}
+			index_build_begin(index, pk);
+			struct fiber *f = fiber_new("index.build",
+						    memtx_tree_sort_f);
+			if (f == NULL)
+				diag_raise();
+			fiber_set_joinable(f, true);
+			fiber_start(f, static_cast<MemtxTree *>(index));
+			sorters[j] = f;
+		}
+	} catch (Exception *) {
+		rc = -1;
+	}
+	/* Wait for all sorters, even on error. */
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		if (sorters[j] != NULL)
+			fiber_join(sorters[j]);
+	}
+	if (rc != 0)
+		return -1;
+	try {
+		for (uint32_t j = 1; j < space->index_count; j++) {
+			if (sorters[j] != NULL)
+				((MemtxIndex *) space->index[j])->endBuild();
+		}
+	} catch (Exception *) {
+		return -1;
+	}
+	return 0;
+}
+
 /**
  * Secondary indexes are built in bulk after all data is
  * recovered. This function enables secondary keys on a space.
@@ -109,8 +194,8 @@ memtx_build_secondary_keys(struct space *space, void *param)
 				 space_name(space));
 		}
 
-		for (uint32_t j = 1; j < space->index_count; j++)
-			index_build((MemtxIndex *) space->index[j], pk);
+		if (memtx_build_secondary_keys_parallel(space) != 0)
+			diag_raise();
 
 		if (n_tuples > 0) {
 			say_info("Space '%s': done", space_name(space));
@@ -119,6 +204,101 @@ memtx_build_secondary_keys(struct space *space, void *param)
 	handler->replace = memtx_replace_all_keys;
 }
 
+/* {{{ Garbage collection of truncated spaces */
+
+enum {
+	/** Number of tuples freed by the gc fiber before yielding. */
+	MEMTX_GC_YIELD_LOOPS = 1000,
+};
+
+/** Indexes of a truncated space, freed in background. */
+struct memtx_gc_task {
+	/** Link in memtx_gc_queue. */
+	struct stailq_entry link;
+	/** Number of indexes in the array below. */
+	uint32_t index_count;
+	/** The indexes, in the order of space->index. */
+	Index *index[0];
+};
+
+/** Tasks waiting for the gc fiber. */
+static struct stailq memtx_gc_queue;
+/** The fiber freeing truncated spaces, started on demand. */
+static struct fiber *memtx_gc_fiber;
+
+/**
+ * Delete @a index. If it's a primary key, free all tuples
+ * stored in it first, yielding every MEMTX_GC_YIELD_LOOPS
+ * tuples if @a can_yield is set. Nobody else can access
+ * the index at this point, so it's safe to iterate over it
+ * across yields.
+ */
+static void
+memtx_gc_index(Index *index, bool can_yield)
+{
+	if (index->index_def->iid == 0) {
+		struct iterator *it = ((MemtxIndex *) index)->position();
+		index->initIterator(it, ITER_ALL, NULL, 0);
+		struct tuple *tuple;
+		uint64_t loops = 0;
+		while ((tuple = it->next(it)) != NULL) {
+			tuple_unref(tuple);
+			if (can_yield && ++loops % MEMTX_GC_YIELD_LOOPS == 0)
+				fiber_sleep(0);
+		}
+	}
+	delete index;
+}
+
+static int
+memtx_gc_f(va_list /* ap */)
+{
+	while (!stailq_empty(&memtx_gc_queue)) {
+		struct memtx_gc_task *task =
+			stailq_shift_entry(&memtx_gc_queue,
+					   struct memtx_gc_task, link);
+		for (uint32_t i = 0; i < task->index_count; i++)
+			memtx_gc_index(task->index[i], true);
+		free(task);
+	}
+	memtx_gc_fiber = NULL;
+	return 0;
+}
+
+void
+memtx_gc_space(struct space *space)
+{
+	size_t size = sizeof(struct memtx_gc_task) +
+		space->index_count * sizeof(Index *);
+	struct memtx_gc_task *task = (struct memtx_gc_task *) malloc(size);
+	if (task == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct memtx_gc_task");
+		goto fail;
+	}
+	if (memtx_gc_fiber == NULL) {
+		memtx_gc_fiber = fiber_new("memtx.gc", memtx_gc_f);
+		if (memtx_gc_fiber == NULL) {
+			free(task);
+			goto fail;
+		}
+		fiber_wakeup(memtx_gc_fiber);
+	}
+	task->index_count = space->index_count;
+	memcpy(task->index, space->index, size - sizeof(*task));
+	stailq_add_tail_entry(&memtx_gc_queue, task, link);
+	space->index_count = 0;
+	return;
+fail:
+	/* Free the space synchronously then. */
+	error_log(diag_last_error(diag_get()));
+	diag_clear(diag_get());
+	for (uint32_t i = 0; i < space->index_count; i++)
+		memtx_gc_index(space->index[i], false);
+	space->index_count = 0;
+}
+
+/* }}} */
+
 MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 			 uint64_t tuple_arena_max_size, uint32_t objsize_min,
 			 uint32_t objsize_max, float alloc_factor)
@@ -126,12 +306,14 @@ MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 	m_checkpoint(0),
 	m_state(MEMTX_INITIALIZED),
 	m_snap_io_rate_limit(0),
+	m_snap_threads(1),
 	m_force_recovery(force_recovery)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, objsize_max,
 			 alloc_factor);
 
-	flags = ENGINE_CAN_BE_TEMPORARY;
+	flags = ENGINE_CAN_BE_TEMPORARY | ENGINE_CAN_TRUNCATE;
+	stailq_create(&memtx_gc_queue);
 	xdir_create(&m_snap_dir, snap_dirname, SNAP, &INSTANCE_UUID);
 }
 
@@ -155,13 +337,24 @@ MemtxEngine::recoverSnapshot(const struct vclock *vclock)
 	struct xlog_cursor cursor;
 	xlog_cursor_open_xc(&cursor, filename);
 	INSTANCE_UUID = cursor.meta.instance_uuid;
+	xlog_cursor_close(&cursor, false);
+
+	/*
+	 * Checksum verification and decompression of the
+	 * snapshot are done in a separate thread, so that
+	 * this thread only decodes and applies rows.
+	 */
+	struct xlog_prefetch prefetch;
+	if (xlog_prefetch_start(&prefetch, filename, m_force_recovery) != 0)
+		diag_raise();
 	auto reader_guard = make_scoped_guard([&]{
-		xlog_cursor_close(&cursor, false);
+		xlog_prefetch_stop(&prefetch);
 	});
 
 	struct xrow_header row;
 	uint64_t row_count = 0;
-	while (xlog_cursor_next_xc(&cursor, &row, m_force_recovery) == 0) {
+	int rc;
+	while ((rc = xlog_prefetch_next(&prefetch, &row)) == 0) {
 		try {
 			recoverSnapshotRow(&row);
 		} catch (ClientError *e) {
@@ -177,14 +370,16 @@ MemtxEngine::recoverSnapshot(const struct vclock *vclock)
 			fiber_yield_timeout(0);
 		}
 	}
+	if (rc < 0)
+		diag_raise();
 
 	/**
 	 * We should never try to read snapshots with no EOF
 	 * marker - such snapshots are very likely corrupted and
 	 * should not be trusted.
 	 */
-	if (cursor.state != XLOG_CURSOR_EOF)
-		panic("snapshot `%s' has no EOF marker", filename);
+	if (!prefetch.eof_read)
+		panic("snapshot `%s' has no EOF marker", prefetch.filename);
 
 }
 
@@ -335,6 +530,286 @@ MemtxEngine::initSystemSpace(struct space *space)
 	memtx_add_primary_key(space, MEMTX_OK);
 }
 
+/* {{{ Online build of secondary keys */
+
+enum {
+	/**
+	 * Number of tuples inserted into a new secondary key
+	 * before an online build yields to let other fibers run.
+	 */
+	MEMTX_BUILD_YIELD_LOOPS = 1000,
+};
+
+/**
+ * A secondary key being built online, see
+ * MemtxEngine::buildSecondaryKey().
+ */
+struct memtx_index_build {
+	/** Link in memtx_index_builds. */
+	struct rlist link;
+	/** The space the key is being added to. */
+	struct space *space;
+	/** The key being built. */
+	MemtxIndex *index;
+	/** Format of the altered space, to validate tuples. */
+	struct tuple_format *format;
+	/** Definition of the primary key of the space. */
+	const struct key_def *pk_def;
+	/**
+	 * The last tuple inserted into the key, referenced.
+	 * All tuples of the primary key up to and including
+	 * this one have been copied to the new key.
+	 */
+	struct tuple *last;
+	/** Number of tuples inserted into the key so far. */
+	uint64_t done;
+	/** Size of the primary key when the build started. */
+	uint64_t total;
+	/** Trigger applying concurrent changes to the key. */
+	struct trigger on_replace;
+};
+
+/** All secondary keys being built online, for box.info.memtx(). */
+static RLIST_HEAD(memtx_index_builds);
+
+/**
+ * Return true if @a tuple has the same primary key as a tuple
+ * which has already been copied to the new key.
+ */
+static bool
+memtx_index_build_is_behind(struct memtx_index_build *build,
+			    struct tuple *tuple)
+{
+	return build->last != NULL &&
+	       tuple_compare(tuple, build->last, build->pk_def) <= 0;
+}
+
+/**
+ * Undo record of a transaction which changed the space while
+ * a key was being built online. Rolls back the changes applied
+ * to the key if the transaction is rolled back. Allocated on
+ * the transaction region and unlinked from the key when the
+ * transaction ends or the key is freed, whichever is first.
+ */
+struct memtx_index_build_undo {
+	/** Link in MemtxIndex::m_build_undo. */
+	struct rlist in_index;
+	/** The key being built. */
+	MemtxIndex *index;
+	/** The transaction which changed the space. */
+	struct txn *txn;
+	/**
+	 * The last statement of the transaction whose change
+	 * was applied to the key by the on_replace trigger.
+	 */
+	struct txn_stmt *applied_stmt;
+	/**
+	 * The statement whose change failed to be applied to
+	 * the key. It must not be undone in the key.
+	 */
+	struct txn_stmt *failed_stmt;
+	/** Triggers unlinking the record when txn ends. */
+	struct trigger on_commit;
+	struct trigger on_rollback;
+};
+
+static void
+memtx_index_build_undo_delete(struct memtx_index_build_undo *undo)
+{
+	trigger_clear(&undo->on_commit);
+	trigger_clear(&undo->on_rollback);
+	rlist_del_entry(undo, in_index);
+}
+
+void
+memtx_index_build_detach_undo(MemtxIndex *index)
+{
+	struct memtx_index_build_undo *undo, *tmp;
+	rlist_foreach_entry_safe(undo, &index->m_build_undo, in_index, tmp)
+		memtx_index_build_undo_delete(undo);
+}
+
+static void
+memtx_index_build_on_commit(struct trigger *trigger, void * /* event */)
+{
+	memtx_index_build_undo_delete(
+		(struct memtx_index_build_undo *) trigger->data);
+}
+
+/**
+ * Undo changes made in the space by a rolled back transaction
+ * in the key being built. A change past the build position is
+ * undone by the primary key rollback alone: the build hasn't
+ * copied the changed tuple yet.
+ */
+static void
+memtx_index_build_on_rollback(struct trigger *trigger, void *event)
+{
+	struct txn *txn = (struct txn *) event;
+	struct memtx_index_build_undo *undo =
+		(struct memtx_index_build_undo *) trigger->data;
+	MemtxIndex *index = undo->index;
+	struct memtx_index_build *build = index->m_build;
+	struct txn_stmt *failed_stmt = undo->failed_stmt;
+	memtx_index_build_undo_delete(undo);
+	/*
+	 * Undo the changes in the reverse order, like
+	 * MemtxEngine::rollback() does, so that several changes
+	 * of the same key end up with its original tuple. The
+	 * order is restored for the engine rollback, which runs
+	 * after the triggers.
+	 */
+	stailq_reverse(&txn->stmts);
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->space->def.id != index->index_def->space_id ||
+		    stmt->engine_savepoint == NULL || stmt == failed_stmt)
+			continue;
+		struct tuple *tuple = stmt->new_tuple != NULL ?
+				      stmt->new_tuple : stmt->old_tuple;
+		if (tuple == NULL)
+			continue;
+		if (build != NULL && !memtx_index_build_is_behind(build, tuple))
+			continue;
+		try {
+			index->replace(stmt->new_tuple, stmt->old_tuple,
+				       DUP_REPLACE_OR_INSERT);
+		} catch (Exception *e) {
+			/* Rollback triggers must not throw. */
+			e->log();
+			panic("failed to roll back a change in index '%s'",
+			      index->index_def->name);
+		}
+	}
+	stailq_reverse(&txn->stmts);
+}
+
+/**
+ * Find the undo record of @a txn for the key being built.
+ * Return NULL if the transaction hasn't changed the space.
+ */
+static struct memtx_index_build_undo *
+memtx_index_build_find_undo(MemtxIndex *index, struct txn *txn)
+{
+	struct memtx_index_build_undo *undo;
+	rlist_foreach_entry(undo, &index->m_build_undo, in_index) {
+		if (undo->txn == txn)
+			return undo;
+	}
+	return NULL;
+}
+
+/**
+ * Register an undo record of @a txn for the key being built,
+ * unless the transaction already has one.
+ */
+static struct memtx_index_build_undo *
+memtx_index_build_add_undo(MemtxIndex *index, struct txn *txn)
+{
+	struct memtx_index_build_undo *undo =
+		memtx_index_build_find_undo(index, txn);
+	if (undo != NULL)
+		return undo;
+	undo = region_calloc_object_xc(&fiber()->gc,
+				       struct memtx_index_build_undo);
+	undo->index = index;
+	undo->txn = txn;
+	trigger_create(&undo->on_commit, memtx_index_build_on_commit,
+		       undo, NULL);
+	trigger_create(&undo->on_rollback, memtx_index_build_on_rollback,
+		       undo, NULL);
+	txn_on_commit(txn, &undo->on_commit);
+	txn_on_rollback(txn, &undo->on_rollback);
+	rlist_add_entry(&index->m_build_undo, undo, in_index);
+	return undo;
+}
+
+/**
+ * Undo a change of a rolled back statement in the keys being
+ * built on its space. A statement is rolled back right after
+ * its on_replace triggers, before the build can copy the
+ * changed tuple, so only a change applied by the trigger is
+ * undone.
+ */
+static void
+memtx_index_build_rollback_stmt(struct txn *txn, struct txn_stmt *stmt)
+{
+	struct memtx_index_build *build;
+	rlist_foreach_entry(build, &memtx_index_builds, link) {
+		if (build->space != stmt->space)
+			continue;
+		struct memtx_index_build_undo *undo =
+			memtx_index_build_find_undo(build->index, txn);
+		if (undo == NULL || undo->applied_stmt != stmt)
+			continue;
+		undo->applied_stmt = NULL;
+		build->index->replace(stmt->new_tuple, stmt->old_tuple,
+				      DUP_REPLACE_OR_INSERT);
+	}
+}
+
+/**
+ * Apply a change made in the space while the build yields to
+ * the key being built, unless the build is yet to reach the
+ * changed tuple.
+ */
+static void
+memtx_index_build_on_replace(struct trigger *trigger, void *event)
+{
+	struct txn *txn = (struct txn *) event;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	struct memtx_index_build *build =
+		(struct memtx_index_build *) trigger->data;
+	/*
+	 * The transaction may be rolled back after the build
+	 * has passed the tuple, so register the undo record
+	 * even if the change isn't applied now.
+	 */
+	struct memtx_index_build_undo *undo =
+		memtx_index_build_add_undo(build->index, txn);
+
+	struct tuple *tuple = stmt->new_tuple != NULL ?
+			      stmt->new_tuple : stmt->old_tuple;
+	if (tuple == NULL || !memtx_index_build_is_behind(build, tuple))
+		return;
+	/*
+	 * If the change can't be applied, the statement is
+	 * rolled back, and the key, which lacks the change,
+	 * must be left as is.
+	 */
+	undo->failed_stmt = stmt;
+	if (stmt->new_tuple != NULL &&
+	    tuple_validate(build->format, stmt->new_tuple) != 0)
+		diag_raise();
+	(void) build->index->replace(stmt->old_tuple, stmt->new_tuple,
+				     DUP_INSERT);
+	undo->failed_stmt = NULL;
+	undo->applied_stmt = stmt;
+}
+
+/* Used by lua/info.c */
+extern "C" void
+memtx_engine_info(struct info_handler *h)
+{
+	info_begin(h);
+	info_table_begin(h, "build");
+	struct memtx_index_build *build;
+	rlist_foreach_entry(build, &memtx_index_builds, link) {
+		char name[BOX_NAME_MAX * 2 + 2];
+		snprintf(name, sizeof(name), "%s.%s",
+			 space_name(build->space),
+			 build->index->index_def->name);
+		info_table_begin(h, name);
+		info_append_u64(h, "done", build->done);
+		info_append_u64(h, "total", build->total);
+		info_table_end(h);
+	}
+	info_table_end(h);
+	info_end(h);
+}
+
+/* }}} */
+
 void
 MemtxEngine::buildSecondaryKey(struct space *old_space,
 			       struct space *new_space, Index *new_index)
@@ -357,6 +832,61 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 	IteratorGuard guard(it);
 	pk->initIterator(it, ITER_ALL, NULL, 0);
 
+	/*
+	 * A big space is built online: the build yields every
+	 * MEMTX_BUILD_YIELD_LOOPS tuples, and changes made in the
+	 * space meanwhile are applied to the new key by
+	 * an on_replace trigger. Concurrent DDL waits on
+	 * the schema latch, which is held by the caller.
+	 *
+	 * The build can't use a read view, since the key must
+	 * see all changes committed before the alter. Instead,
+	 * it remembers the last copied tuple and repositions
+	 * the iterator past it after each yield. That requires
+	 * an ordered primary key, so a space with a HASH primary
+	 * key, as well as a system space, is built in one go.
+	 */
+	bool is_online = m_state == MEMTX_OK &&
+			 pk->index_def->type == TREE &&
+			 !space_is_system(old_space);
+	struct memtx_index_build build;
+	rlist_create(&build.link);
+	trigger_create(&build.on_replace, memtx_index_build_on_replace,
+		       &build, NULL);
+	build.space = old_space;
+	build.index = (MemtxIndex *) new_index;
+	build.format = new_space->format;
+	build.pk_def = &pk->index_def->key_def;
+	build.last = NULL;
+	build.done = 0;
+	build.total = pk->size();
+	auto build_guard = make_scoped_guard([&]{
+		build.index->m_build = NULL;
+		trigger_clear(&build.on_replace);
+		rlist_del_entry(&build, link);
+		if (build.last != NULL)
+			tuple_unref(build.last);
+	});
+	if (is_online) {
+		build.index->m_build = &build;
+		trigger_add(&old_space->on_replace, &build.on_replace);
+		rlist_add_tail_entry(&memtx_index_builds, &build, link);
+	}
+	size_t region_svp = region_used(&fiber()->gc);
+
+	/*
+	 * An RTREE built in one go is bulk loaded, which is
+	 * faster than inserting tuples one by one and gives
+	 * pages with less overlap. An online build inserts
+	 * tuples one by one, since concurrent changes are
+	 * applied to the tree while it is being built.
+	 */
+	bool is_bulk = !is_online && new_index_def->type == RTREE;
+	if (is_bulk) {
+		build.index->beginBuild();
+		build.index->reserve(build.total);
+	}
+
 	/*
 	 * The index has to be built tuple by tuple, since
 	 * there is no guarantee that all tuples satisfy
@@ -374,6 +904,10 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 		 */
 		if (tuple_validate(format, tuple))
 			diag_raise();
+		if (is_bulk) {
+			build.index->buildNext(tuple);
+			continue;
+		}
 		/*
 		 * @todo: better message if there is a duplicate.
 		 */
@@ -381,7 +915,29 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 			new_index->replace(NULL, tuple, DUP_INSERT);
 		assert(old_tuple == NULL); /* Guaranteed by DUP_INSERT. */
 		(void) old_tuple;
+		if (!is_online || ++build.done % MEMTX_BUILD_YIELD_LOOPS != 0)
+			continue;
+		/* Remember the position and let other fibers run. */
+		tuple_ref_xc(tuple);
+		if (build.last != NULL)
+			tuple_unref(build.last);
+		build.last = tuple;
+		fiber_sleep(0);
+		fiber_testcancel();
+		/*
+		 * The tree may have changed while the build
+		 * was sleeping, reposition the iterator.
+		 */
+		region_truncate(&fiber()->gc, region_svp);
+		const char *key = tuple_extract_key(build.last,
+						    build.pk_def, NULL);
+		if (key == NULL)
+			diag_raise();
+		uint32_t part_count = mp_decode_array(&key);
+		pk->initIterator(it, ITER_GT, key, part_count);
 	}
+	if (is_bulk)
+		build.index->endBuild();
 }
 
 void
@@ -500,7 +1056,7 @@ MemtxEngine::begin(struct txn *txn)
 }
 
 void
-MemtxEngine::rollbackStatement(struct txn *, struct txn_stmt *stmt)
+MemtxEngine::rollbackStatement(struct txn *txn, struct txn_stmt *stmt)
 {
 	if (stmt->old_tuple == NULL && stmt->new_tuple == NULL)
 		return;
@@ -518,6 +1074,8 @@ MemtxEngine::rollbackStatement(struct txn *, struct txn_stmt *stmt)
 	else
 		panic("transaction rolled back during snapshot recovery");
 
+	if (index_count > 0)
+		memtx_index_build_rollback_stmt(txn, stmt);
 	for (int i = 0; i < index_count; i++) {
 		Index *index = space->index[i];
 		index->replace(stmt->new_tuple, stmt->old_tuple, DUP_INSERT);
@@ -578,16 +1136,22 @@ MemtxEngine::bootstrap()
 		recoverSnapshotRow(&row);
 }
 
-static void
-checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+/** The timestamp of snapshot rows. */
+static ev_tstamp
+checkpoint_row_tm()
 {
 	static ev_tstamp last = 0;
 	if (last == 0) {
 		ev_now_update(loop());
 		last = ev_now(loop());
 	}
+	return last;
+}
 
-	row->tm = last;
+static void
+checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+{
+	row->tm = checkpoint_row_tm();
 	row->replica_id = 0;
 	/**
 	 * Rows in snapshot are numbered from 1 to %rows.
@@ -610,26 +1174,38 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 
 }
 
+/**
+ * Make a snapshot row of a tuple of space @a n. The row
+ * body refers to @a body and the tuple data.
+ */
+static void
+checkpoint_encode_tuple(struct xrow_header *row,
+			struct request_replace_body *body,
+			uint32_t n, struct tuple *tuple)
+{
+	body->m_body = 0x82; /* map of two elements. */
+	body->k_space_id = IPROTO_SPACE_ID;
+	body->m_space_id = 0xce; /* uint32 */
+	body->v_space_id = mp_bswap_u32(n);
+	body->k_tuple = IPROTO_TUPLE;
+
+	memset(row, 0, sizeof(struct xrow_header));
+	row->type = IPROTO_INSERT;
+
+	row->bodycnt = 2;
+	row->body[0].iov_base = body;
+	row->body[0].iov_len = sizeof(*body);
+	uint32_t bsize;
+	row->body[1].iov_base = (char *) tuple_data_range(tuple, &bsize);
+	row->body[1].iov_len = bsize;
+}
+
 static void
 checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 {
 	struct request_replace_body body;
-	body.m_body = 0x82; /* map of two elements. */
-	body.k_space_id = IPROTO_SPACE_ID;
-	body.m_space_id = 0xce; /* uint32 */
-	body.v_space_id = mp_bswap_u32(n);
-	body.k_tuple = IPROTO_TUPLE;
-
 	struct xrow_header row;
-	memset(&row, 0, sizeof(struct xrow_header));
-	row.type = IPROTO_INSERT;
-
-	row.bodycnt = 2;
-	row.body[0].iov_base = &body;
-	row.body[0].iov_len = sizeof(body);
-	uint32_t bsize;
-	row.body[1].iov_base = (char *) tuple_data_range(tuple, &bsize);
-	row.body[1].iov_len = bsize;
+	checkpoint_encode_tuple(&row, &body, n, tuple);
 	checkpoint_write_row(l, &row);
 }
 
@@ -646,6 +1222,8 @@ struct checkpoint {
 	 */
 	struct rlist entries;
 	uint64_t snap_io_rate_limit;
+	/** Number of threads encoding and compressing rows. */
+	int thread_count;
 	struct cord cord;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
@@ -660,12 +1238,13 @@ struct checkpoint {
 
 static void
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
-		uint64_t snap_io_rate_limit)
+		uint64_t snap_io_rate_limit, int thread_count)
 {
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
 	ckpt->waiting_for_snap_thread = false;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID);
 	ckpt->snap_io_rate_limit = snap_io_rate_limit;
+	ckpt->thread_count = thread_count;
 	/* May be used in abortCheckpoint() */
 	vclock_create(&ckpt->vclock);
 	ckpt->touch = false;
@@ -707,6 +1286,302 @@ checkpoint_add_space(struct space *sp, void *data)
 	pk->createReadViewForIterator(entry->iterator);
 };
 
+/**
+ * Parallel snapshot writer.
+ *
+ * The snapshot thread walks the read views of spaces and cuts
+ * the tuples into batches of about an xlog transaction size.
+ * Worker threads encode and compress the batches, while the
+ * snapshot thread appends the compressed batches to the file
+ * in order, so the file is the same as the one written by a
+ * single thread, and snap_io_rate_limit applies to the whole
+ * snapshot. Batches are assigned to the workers round-robin,
+ * which makes the worker holding the next batch to write
+ * known in advance.
+ */
+
+enum {
+	/** Max number of rows in a batch of a snapshot worker. */
+	CHECKPOINT_BATCH_ROWS_MAX = 16 * 1024,
+	/** Cut a batch once the size of its tuples gets this big. */
+	CHECKPOINT_BATCH_SIZE = 128 * 1024,
+};
+
+enum checkpoint_worker_state {
+	/** The worker has no batch to encode. */
+	CHECKPOINT_WORKER_IDLE,
+	/** The batch is to be encoded. */
+	CHECKPOINT_WORKER_QUEUED,
+	/** The batch is encoded and can be written. */
+	CHECKPOINT_WORKER_DONE,
+	/** Failed to encode the batch, see diag. */
+	CHECKPOINT_WORKER_FAILED,
+};
+
+struct checkpoint_pool;
+
+/** A thread encoding and compressing batches of snapshot rows. */
+struct checkpoint_worker {
+	struct cord cord;
+	struct checkpoint_pool *pool;
+	/** Protected by checkpoint_pool::mutex. */
+	enum checkpoint_worker_state state;
+	/** LSN of the first row of the batch. */
+	int64_t lsn;
+	/** Number of rows in the batch. */
+	int count;
+	/** Tuples of the batch and ids of their spaces. */
+	struct tuple **tuples;
+	uint32_t *space_ids;
+	/** The encoded batch, allocated by the worker thread. */
+	struct xlog_tx_buf buf;
+	bool has_buf;
+	/** The error which failed the batch. */
+	struct diag diag;
+};
+
+struct checkpoint_pool {
+	pthread_mutex_t mutex;
+	/** Signaled when a batch is queued or the pool is stopped. */
+	pthread_cond_t worker_cond;
+	/** Signaled when a batch is encoded. */
+	pthread_cond_t done_cond;
+	bool is_running;
+	/** The timestamp of snapshot rows. */
+	ev_tstamp tm;
+	struct checkpoint_worker *workers;
+	int worker_count;
+};
+
+/** Encode and compress the batch of a worker. */
+static int
+checkpoint_worker_encode(struct checkpoint_worker *worker)
+{
+	if (!worker->has_buf) {
+		if (xlog_tx_buf_create(&worker->buf) != 0)
+			return -1;
+		worker->has_buf = true;
+	}
+	xlog_tx_buf_reset(&worker->buf);
+	int rc = 0;
+	for (int i = 0; i < worker->count; i++) {
+		struct request_replace_body body;
+		struct xrow_header row;
+		checkpoint_encode_tuple(&row, &body, worker->space_ids[i],
+					worker->tuples[i]);
+		row.tm = worker->pool->tm;
+		row.lsn = worker->lsn + i;
+		if (xlog_tx_buf_add_row(&worker->buf, &row) < 0) {
+			rc = -1;
+			break;
+		}
+	}
+	if (rc == 0)
+		rc = xlog_tx_buf_encode(&worker->buf);
+	fiber_gc();
+	return rc;
+}
+
+static int
+checkpoint_worker_f(va_list ap)
+{
+	struct checkpoint_worker *worker =
+		va_arg(ap, struct checkpoint_worker *);
+	struct checkpoint_pool *pool = worker->pool;
+
+	tt_pthread_mutex_lock(&pool->mutex);
+	while (true) {
+		while (pool->is_running &&
+		       worker->state != CHECKPOINT_WORKER_QUEUED)
+			tt_pthread_cond_wait(&pool->worker_cond, &pool->mutex);
+		if (worker->state != CHECKPOINT_WORKER_QUEUED)
+			break;
+		tt_pthread_mutex_unlock(&pool->mutex);
+
+		int rc = checkpoint_worker_encode(worker);
+		if (rc != 0)
+			diag_move(diag_get(), &worker->diag);
+
+		tt_pthread_mutex_lock(&pool->mutex);
+		worker->state = rc == 0 ? CHECKPOINT_WORKER_DONE :
+					  CHECKPOINT_WORKER_FAILED;
+		tt_pthread_cond_broadcast(&pool->done_cond);
+	}
+	tt_pthread_mutex_unlock(&pool->mutex);
+	if (worker->has_buf)
+		xlog_tx_buf_destroy(&worker->buf);
+	return 0;
+}
+
+/** Stop the worker threads and free the pool. */
+static void
+checkpoint_pool_destroy(struct checkpoint_pool *pool)
+{
+	tt_pthread_mutex_lock(&pool->mutex);
+	pool->is_running = false;
+	tt_pthread_cond_broadcast(&pool->worker_cond);
+	tt_pthread_mutex_unlock(&pool->mutex);
+
+	for (int i = 0; i < pool->worker_count; i++) {
+		struct checkpoint_worker *worker = &pool->workers[i];
+		cord_join(&worker->cord);
+		diag_destroy(&worker->diag);
+		free(worker->tuples);
+		free(worker->space_ids);
+	}
+	free(pool->workers);
+	tt_pthread_cond_destroy(&pool->worker_cond);
+	tt_pthread_cond_destroy(&pool->done_cond);
+	tt_pthread_mutex_destroy(&pool->mutex);
+}
+
+static int
+checkpoint_pool_create(struct checkpoint_pool *pool, int worker_count)
+{
+	tt_pthread_mutex_init(&pool->mutex, NULL);
+	tt_pthread_cond_init(&pool->worker_cond, NULL);
+	tt_pthread_cond_init(&pool->done_cond, NULL);
+	pool->is_running = true;
+	pool->tm = checkpoint_row_tm();
+	pool->worker_count = 0;
+	pool->workers = (struct checkpoint_worker *)
+		calloc(worker_count, sizeof(*pool->workers));
+	if (pool->workers == NULL) {
+		diag_set(OutOfMemory, worker_count * sizeof(*pool->workers),
+			 "malloc", "struct checkpoint_worker");
+		checkpoint_pool_destroy(pool);
+		return -1;
+	}
+	for (int i = 0; i < worker_count; i++) {
+		struct checkpoint_worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->state = CHECKPOINT_WORKER_IDLE;
+		worker->tuples = (struct tuple **)
+			malloc(CHECKPOINT_BATCH_ROWS_MAX *
+			       sizeof(*worker->tuples));
+		worker->space_ids = (uint32_t *)
+			malloc(CHECKPOINT_BATCH_ROWS_MAX *
+			       sizeof(*worker->space_ids));
+		diag_create(&worker->diag);
+		if (worker->tuples == NULL || worker->space_ids == NULL) {
+			diag_set(OutOfMemory, CHECKPOINT_BATCH_ROWS_MAX *
+				 sizeof(*worker->tuples), "malloc",
+				 "checkpoint batch");
+			goto error;
+		}
+		if (cord_costart(&worker->cord, "snapshot.worker",
+				 checkpoint_worker_f, worker) != 0)
+			goto error;
+		pool->worker_count++;
+	}
+	return 0;
+error:
+	/* Free the worker which failed to start. */
+	diag_destroy(&pool->workers[pool->worker_count].diag);
+	free(pool->workers[pool->worker_count].tuples);
+	free(pool->workers[pool->worker_count].space_ids);
+	checkpoint_pool_destroy(pool);
+	return -1;
+}
+
+/** A position in the read views of the spaces to snapshot. */
+struct checkpoint_cursor {
+	struct checkpoint *ckpt;
+	/** The space being read, NULL when all spaces are read. */
+	struct checkpoint_entry *entry;
+	/** LSN of the next row. */
+	int64_t lsn;
+};
+
+/** Cut the next batch of rows and queue it to @a worker. */
+static void
+checkpoint_pool_queue(struct checkpoint_pool *pool,
+		      struct checkpoint_worker *worker,
+		      struct checkpoint_cursor *cursor)
+{
+	assert(worker->state != CHECKPOINT_WORKER_QUEUED);
+	worker->lsn = cursor->lsn;
+	worker->count = 0;
+	size_t size = 0;
+	while (cursor->entry != NULL &&
+	       worker->count < CHECKPOINT_BATCH_ROWS_MAX &&
+	       size < CHECKPOINT_BATCH_SIZE) {
+		struct iterator *it = cursor->entry->iterator;
+		struct tuple *tuple = it->next(it);
+		if (tuple == NULL) {
+			struct rlist *next = rlist_next(&cursor->entry->link);
+			cursor->entry = next == &cursor->ckpt->entries ? NULL :
+				rlist_entry(next, struct checkpoint_entry, link);
+			continue;
+		}
+		worker->tuples[worker->count] = tuple;
+		worker->space_ids[worker->count] =
+			space_id(cursor->entry->space);
+		worker->count++;
+		size += tuple->bsize;
+	}
+	cursor->lsn += worker->count;
+	tt_pthread_mutex_lock(&pool->mutex);
+	if (worker->count > 0) {
+		worker->state = CHECKPOINT_WORKER_QUEUED;
+		tt_pthread_cond_broadcast(&pool->worker_cond);
+	} else {
+		worker->state = CHECKPOINT_WORKER_IDLE;
+	}
+	tt_pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * Write a snapshot using ckpt->thread_count worker threads
+ * to encode and compress rows.
+ */
+static int
+checkpoint_write_parallel(struct checkpoint *ckpt, struct xlog *snap)
+{
+	struct checkpoint_pool pool;
+	if (checkpoint_pool_create(&pool, ckpt->thread_count) != 0)
+		return -1;
+
+	struct checkpoint_cursor cursor;
+	cursor.ckpt = ckpt;
+	cursor.entry = rlist_empty(&ckpt->entries) ? NULL :
+		rlist_first_entry(&ckpt->entries, struct checkpoint_entry,
+				  link);
+	/* Keep numbering rows as checkpoint_write_row() does. */
+	cursor.lsn = snap->rows;
+
+	for (int i = 0; i < pool.worker_count; i++)
+		checkpoint_pool_queue(&pool, &pool.workers[i], &cursor);
+
+	int rc = 0;
+	for (int i = 0; ; i = (i + 1) % pool.worker_count) {
+		struct checkpoint_worker *worker = &pool.workers[i];
+		tt_pthread_mutex_lock(&pool.mutex);
+		while (worker->state == CHECKPOINT_WORKER_QUEUED)
+			tt_pthread_cond_wait(&pool.done_cond, &pool.mutex);
+		enum checkpoint_worker_state state = worker->state;
+		tt_pthread_mutex_unlock(&pool.mutex);
+		/* Batches are queued round-robin: no more rows. */
+		if (state == CHECKPOINT_WORKER_IDLE)
+			break;
+		if (state == CHECKPOINT_WORKER_FAILED) {
+			diag_move(&worker->diag, diag_get());
+			rc = -1;
+			break;
+		}
+		int64_t rows = snap->rows;
+		if (xlog_write_tx_buf(snap, &worker->buf) < 0) {
+			rc = -1;
+			break;
+		}
+		if (snap->rows / 100000 != rows / 100000)
+			say_crit("%.1fM rows written", snap->rows / 1000000.0);
+		checkpoint_pool_queue(&pool, worker, &cursor);
+	}
+	checkpoint_pool_destroy(&pool);
+	return rc;
+}
+
 int
 checkpoint_f(va_list ap)
 {
@@ -730,13 +1605,20 @@ checkpoint_f(va_list ap)
 	snap.rate_limit = ckpt->snap_io_rate_limit;
 
 	say_info("saving snapshot `%s'", snap.filename);
-	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		struct tuple *tuple;
-		struct iterator *it = entry->iterator;
-		for (tuple = it->next(it); tuple; tuple = it->next(it)) {
-			checkpoint_write_tuple(&snap, space_id(entry->space),
-					       tuple);
+	if (ckpt->thread_count > 1) {
+		if (checkpoint_write_parallel(ckpt, &snap) != 0)
+			diag_raise();
+	} else {
+		struct checkpoint_entry *entry;
+		rlist_foreach_entry(entry, &ckpt->entries, link) {
+			struct tuple *tuple;
+			struct iterator *it = entry->iterator;
+			for (tuple = it->next(it); tuple;
+			     tuple = it->next(it)) {
+				checkpoint_write_tuple(&snap,
+						       space_id(entry->space),
+						       tuple);
+			}
 		}
 	}
 	xlog_flush(&snap);
@@ -751,7 +1633,8 @@ MemtxEngine::beginCheckpoint()
 
 	m_checkpoint = region_alloc_object_xc(&fiber()->gc, struct checkpoint);
 
-	checkpoint_init(m_checkpoint, m_snap_dir.dirname, m_snap_io_rate_limit);
+	checkpoint_init(m_checkpoint, m_snap_dir.dirname, m_snap_io_rate_limit,
+			m_snap_threads);
 	space_foreach(checkpoint_add_space, m_checkpoint);
 
 	/* increment snapshot version; set tuple deletion to delayed mode */
@@ -70,6 +70,16 @@ enum memtx_recovery_state {
 /** Memtx extents pool, available to statistics. */
 extern struct mempool memtx_index_extent_pool;
 
+/**
+ * Take over the indexes of a truncated space and free them
+ * along with all tuples stored in them in a background fiber.
+ * Sets space->index_count to 0, so that space_delete() leaves
+ * the indexes alone. Never fails: falls back on freeing the
+ * indexes synchronously if out of memory.
+ */
+void
+memtx_gc_space(struct space *space);
+
 struct MemtxEngine: public Engine {
 	MemtxEngine(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
@@ -107,6 +117,11 @@ struct MemtxEngine: public Engine {
 	{
 		m_snap_io_rate_limit = new_limit * 1024 * 1024;
 	}
+	/* Update snapshot_threads. */
+	void setSnapshotThreads(int thread_count)
+	{
+		m_snap_threads = thread_count;
+	}
 	void recoverSnapshot(const struct vclock *vclock);
 private:
 	void
@@ -118,12 +133,16 @@ private:
 	struct xdir m_snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t m_snap_io_rate_limit;
+	/** Number of threads compressing snapshot rows. */
+	int m_snap_threads;
 	bool m_force_recovery;
 };
 
 enum {
 	MEMTX_EXTENT_SIZE = 16 * 1024,
-	MEMTX_SLAB_SIZE = 4 * 1024 * 1024
+	MEMTX_SLAB_SIZE = 4 * 1024 * 1024,
+	/** Max number of threads writing a snapshot. */
+	MEMTX_SNAPSHOT_THREADS_MAX = 32
 };
 
 /**
@@ -37,6 +37,13 @@
 #include "user_def.h"
 #include "space.h"
 
+MemtxIndex::~MemtxIndex()
+{
+	memtx_index_build_detach_undo(this);
+	if (m_position != NULL)
+		m_position->free(m_position);
+}
+
 void
 MemtxIndex::beginBuild()
 {}
@@ -87,7 +94,7 @@ MemtxIndex::count(enum iterator_type type, const char *key,
 }
 
 void
-index_build(MemtxIndex *index, MemtxIndex *pk)
+index_build_begin(MemtxIndex *index, MemtxIndex *pk)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
@@ -106,6 +113,11 @@ index_build(MemtxIndex *index, MemtxIndex *pk)
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(MemtxIndex *index, MemtxIndex *pk)
+{
+	index_build_begin(index, pk);
 	index->endBuild();
 }
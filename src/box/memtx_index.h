@@ -32,15 +32,16 @@
  */
 #include "index.h"
 
+struct memtx_index_build;
+
 class MemtxIndex: public Index {
 public:
 	MemtxIndex(struct index_def *index_def_arg)
-		:Index(index_def_arg), m_position(NULL)
-	{}
-	virtual ~MemtxIndex() override {
-		if (m_position != NULL)
-			m_position->free(m_position);
+		:Index(index_def_arg), m_build(NULL), m_position(NULL)
+	{
+		rlist_create(&m_build_undo);
 	}
+	virtual ~MemtxIndex() override;
 	virtual struct tuple *min(const char *key,
 				  uint32_t part_count) const override;
 	virtual struct tuple *max(const char *key,
@@ -67,6 +68,17 @@ public:
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
 	virtual void endBuild();
+	/**
+	 * State of the online build of this index, NULL unless
+	 * the index is being built.
+	 */
+	struct memtx_index_build *m_build;
+	/**
+	 * Undo records of transactions which changed the space
+	 * while the index was being built online and haven't
+	 * ended yet, see memtx_index_build_on_replace().
+	 */
+	struct rlist m_build_undo;
 protected:
 	/*
 	 * Pre-allocated iterator to speed up the main case of
@@ -75,8 +87,23 @@ protected:
 	mutable struct iterator *m_position;
 };
 
+/**
+ * Detach rollback triggers of transactions that changed the
+ * space during the online build of the index, so that they
+ * don't touch the index once it is freed.
+ */
+void
+memtx_index_build_detach_undo(MemtxIndex *index);
+
 /** Build this index based on the contents of another index. */
 void
 index_build(MemtxIndex *index, MemtxIndex *pk);
 
+/**
+ * Begin building this index and add all tuples of another
+ * index to it. The build is finished with endBuild().
+ */
+void
+index_build_begin(MemtxIndex *index, MemtxIndex *pk);
+
 #endif /* TARANTOOL_BOX_MEMTX_INDEX_H_INCLUDED */
@@ -306,3 +306,29 @@ MemtxRTree::beginBuild()
 	rtree_purge(&m_tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (rtree_build_reserve(&m_tree, size_hint) != 0) {
+		tnt_raise(OutOfMemory, size_hint * m_tree.page_branch_size,
+			  "MemtxRTree", "reserve");
+	}
+}
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	struct rtree_rect rect;
+	extract_rectangle(&rect, tuple, index_def);
+	if (rtree_build_add(&m_tree, &rect, tuple) != 0) {
+		tnt_raise(OutOfMemory, m_tree.build_alloc *
+			  m_tree.page_branch_size, "MemtxRTree", "buildNext");
+	}
+}
+
+void
+MemtxRTree::endBuild()
+{
+	rtree_build_end(&m_tree);
+}
+
@@ -40,6 +40,7 @@
 #include "memtx_bitset.h"
 #include "port.h"
 #include "memtx_tuple.h"
+#include "memtx_engine.h"
 
 /**
  * A version of space_replace for a space which has
@@ -505,6 +506,33 @@ MemtxSpace::prepareAlterSpace(struct space *old_space, struct space *new_space)
 	replace = handler->replace;
 }
 
+void
+MemtxSpace::prepareTruncateSpace(struct space *old_space,
+				 struct space *new_space)
+{
+	MemtxSpace *handler = (MemtxSpace *) old_space->handler;
+	replace = handler->replace;
+	/* Bring the empty indexes to the state of the old ones. */
+	if (replace == memtx_replace_build_next) {
+		((MemtxIndex *) new_space->index[0])->beginBuild();
+	} else if (replace == memtx_replace_primary_key) {
+		((MemtxIndex *) new_space->index[0])->beginBuild();
+		((MemtxIndex *) new_space->index[0])->endBuild();
+	} else if (replace == memtx_replace_all_keys) {
+		for (uint32_t i = 0; i < new_space->index_count; i++) {
+			((MemtxIndex *) new_space->index[i])->beginBuild();
+			((MemtxIndex *) new_space->index[i])->endBuild();
+		}
+	}
+}
+
+void
+MemtxSpace::commitTruncateSpace(struct space *old_space,
+				struct space * /* new_space */)
+{
+	memtx_gc_space(old_space);
+}
+
 void
 MemtxSpace::executeSelect(struct txn *, struct space *space,
 			  uint32_t index_id, uint32_t iterator,
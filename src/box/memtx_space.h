@@ -82,6 +82,10 @@ struct MemtxSpace: public Handler {
 	virtual void dropIndex(Index *index) override;
 	virtual void prepareAlterSpace(struct space *old_space,
 				       struct space *new_space) override;
+	virtual void prepareTruncateSpace(struct space *old_space,
+					  struct space *new_space) override;
+	virtual void commitTruncateSpace(struct space *old_space,
+					 struct space *new_space) override;
 public:
 	/**
 	 * A pointer to replace function, set to different values
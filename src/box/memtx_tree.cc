@@ -39,11 +39,74 @@
 
 /* {{{ Utilities. *************************************************/
 
-struct key_data
+/**
+ * Calculate a hint of a key part of the given type: a 64-bit
+ * number such that hint(a) < hint(b) implies a < b. Equal hints
+ * tell nothing about the order of parts. Hints are calculated
+ * for unsigned, integer and string parts only, other types get
+ * zero.
+ */
+static inline uint64_t
+memtx_tree_hint(const char *field, enum field_type type)
 {
-	const char *key;
-	uint32_t part_count;
-};
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_decode_uint(&field);
+	case FIELD_TYPE_INTEGER:
+	{
+		/*
+		 * Negative values go to [0, 2^63), non-negative
+		 * to [2^63, 2^64 - 1]. Values starting with
+		 * 2^63 - 1 share the top hint.
+		 */
+		if (mp_typeof(*field) == MP_INT)
+			return (uint64_t)mp_decode_int(&field) -
+			       (uint64_t)INT64_MIN;
+		uint64_t val = mp_decode_uint(&field);
+		if (val >= (uint64_t)INT64_MAX)
+			return UINT64_MAX;
+		return val - (uint64_t)INT64_MIN;
+	}
+	case FIELD_TYPE_STRING:
+	{
+		/* The first 8 bytes in big-endian order. */
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		uint64_t hint = 0;
+		for (uint32_t i = 0; i < len && i < sizeof(hint); i++) {
+			hint |= (uint64_t)(unsigned char)str[i] <<
+				(CHAR_BIT * (sizeof(hint) - 1 - i));
+		}
+		return hint;
+	}
+	default:
+		return 0;
+	}
+}
+
+static inline uint64_t
+memtx_tree_tuple_hint(const struct tuple *tuple, struct index_def *index_def)
+{
+	if (!index_def->opts.hint)
+		return 0;
+	const struct key_part *part = &index_def->key_def.parts[0];
+	const char *field = tuple_field(tuple, part->fieldno);
+	assert(field != NULL);
+	return memtx_tree_hint(field, part->type);
+}
+
+static inline void
+memtx_tree_key_data_create(struct key_data *key_data, const char *key,
+			   uint32_t part_count, struct index_def *index_def)
+{
+	key_data->key = key;
+	key_data->part_count = part_count;
+	key_data->hint = 0;
+	if (part_count > 0 && index_def->opts.hint) {
+		key_data->hint = memtx_tree_hint(key,
+					index_def->key_def.parts[0].type);
+	}
+}
 
 int
 memtx_tree_compare(const tuple *a, const tuple *b, struct index_def *index_def)
@@ -65,8 +128,8 @@ memtx_tree_compare_key(const tuple *a, const struct key_data *key_data,
 int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
-	return memtx_tree_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct index_def *)c);
+	return memtx_tree_data_compare(*(struct memtx_tree_data *)a,
+		*(struct memtx_tree_data *)b, (struct index_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -105,49 +168,54 @@ static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
-	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
+	if (memtx_tree_data_compare_key(*res, &it->key_data,
+					it->index_def) != 0) {
 		it->tree_iterator = memtx_tree_invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
 	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -163,15 +231,17 @@ static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
-	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
+	if (memtx_tree_data_compare_key(*res, &it->key_data,
+					it->index_def) != 0) {
 		it->tree_iterator = memtx_tree_invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -188,7 +258,7 @@ tree_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
 
 MemtxTree::MemtxTree(struct index_def *index_def_arg)
 	: MemtxIndex(index_def_arg), build_array(0), build_array_size(0),
-	  build_array_alloc_size(0)
+	  build_array_alloc_size(0), build_array_is_sorted(false)
 {
 	memtx_index_arena_init();
 	memtx_tree_create(&tree, index_def,
@@ -217,8 +287,8 @@ MemtxTree::bsize() const
 struct tuple *
 MemtxTree::random(uint32_t rnd) const
 {
-	struct tuple **res = memtx_tree_random(&tree, rnd);
-	return res ? *res : 0;
+	struct memtx_tree_data *res = memtx_tree_random(&tree, rnd);
+	return res ? res->tuple : 0;
 }
 
 struct tuple *
@@ -227,10 +297,67 @@ MemtxTree::findByKey(const char *key, uint32_t part_count) const
 	assert(index_def->opts.is_unique && part_count == index_def->key_def.part_count);
 
 	struct key_data key_data;
-	key_data.key = key;
-	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&tree, &key_data);
-	return res ? *res : 0;
+	memtx_tree_key_data_create(&key_data, key, part_count, index_def);
+	struct memtx_tree_data *res = memtx_tree_find(&tree, &key_data);
+	return res ? res->tuple : 0;
+}
+
+struct key_order_arg {
+	const char **keys;
+	const struct key_def *key_def;
+};
+
+static int
+memtx_tree_key_order_qcompare(const void *a, const void *b, void *c)
+{
+	struct key_order_arg *arg = (struct key_order_arg *) c;
+	return key_compare(arg->keys[*(uint32_t *) a],
+			   arg->keys[*(uint32_t *) b], arg->key_def);
+}
+
+void
+MemtxTree::findByKeys(const char **keys, uint32_t count,
+		      struct tuple **result) const
+{
+	/*
+	 * Look the keys up in ascending order, so that
+	 * consecutive lookups share the path from the root
+	 * and find the blocks already in cache.
+	 */
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	uint32_t *order = (uint32_t *)
+		region_alloc_xc(region, count * sizeof(*order));
+	for (uint32_t i = 0; i < count; i++)
+		order[i] = i;
+	struct key_order_arg arg = { keys, &index_def->key_def };
+	qsort_arg(order, count, sizeof(*order),
+		  memtx_tree_key_order_qcompare, &arg);
+	/*
+	 * Don't touch found tuples until all the keys are
+	 * looked up, just prefetch them: referencing a tuple
+	 * right away would stall on a cache miss.
+	 */
+	struct tuple **found = (struct tuple **)
+		region_alloc_xc(region, count * sizeof(*found));
+	for (uint32_t i = 0; i < count; i++) {
+		const char *key = keys[order[i]];
+		uint32_t part_count = mp_decode_array(&key);
+		struct key_data key_data;
+		memtx_tree_key_data_create(&key_data, key, part_count,
+					   index_def);
+		struct memtx_tree_data *res = memtx_tree_find(&tree, &key_data);
+		found[i] = res != NULL ? res->tuple : NULL;
+		if (found[i] != NULL)
+			__builtin_prefetch(found[i], 1);
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (found[i] == NULL)
+			continue;
+		tuple_ref_xc(found[i]);
+		result[order[i]] = found[i];
+	}
+	region_truncate(region, used);
 }
 
 struct tuple *
@@ -240,31 +367,38 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		struct memtx_tree_data new_data;
+		new_data.tuple = new_tuple;
+		new_data.hint = memtx_tree_tuple_hint(new_tuple, index_def);
+		struct memtx_tree_data dup_data;
+		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res =
-		memtx_tree_insert(&tree, new_tuple, &dup_tuple);
+		memtx_tree_insert(&tree, new_data, &dup_data);
 		if (tree_res) {
 			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
 				  "MemtxTree", "replace");
 		}
 
-		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
+		errcode = replace_check_dup(old_tuple, dup_data.tuple, mode);
 
 		if (errcode) {
-			memtx_tree_delete(&tree, new_tuple);
-			if (dup_tuple)
-				memtx_tree_insert(&tree, dup_tuple, 0);
+			memtx_tree_delete(&tree, new_data);
+			if (dup_data.tuple)
+				memtx_tree_insert(&tree, dup_data, 0);
 			struct space *sp = space_cache_find(index_def->space_id);
 			tnt_raise(ClientError, errcode, index_name(this),
 				  space_name(sp));
 		}
-		if (dup_tuple)
-			return dup_tuple;
+		if (dup_data.tuple)
+			return dup_data.tuple;
 	}
 	if (old_tuple) {
-		memtx_tree_delete(&tree, old_tuple);
+		struct memtx_tree_data old_data;
+		old_data.tuple = old_tuple;
+		old_data.hint = memtx_tree_tuple_hint(old_tuple, index_def);
+		memtx_tree_delete(&tree, old_data);
 	}
 	return old_tuple;
 }
@@ -305,8 +439,7 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
 		key = 0;
 	}
-	it->key_data.key = key;
-	it->key_data.part_count = part_count;
+	memtx_tree_key_data_create(&it->key_data, key, part_count, index_def);
 
 	bool exact = false;
 	if (key == 0) {
@@ -366,7 +499,7 @@ MemtxTree::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	struct tuple **tmp = (struct tuple**)
+	struct memtx_tree_data *tmp = (struct memtx_tree_data *)
 		realloc(build_array, size_hint * sizeof(*tmp));
 	if (tmp == NULL)
 		tnt_raise(OutOfMemory, size_hint * sizeof(*tmp),
@@ -379,19 +512,20 @@ void
 MemtxTree::buildNext(struct tuple *tuple)
 {
 	if (build_array == NULL) {
-		build_array = (struct tuple**) malloc(BPS_TREE_EXTENT_SIZE);
+		build_array = (struct memtx_tree_data *)
+			malloc(BPS_TREE_EXTENT_SIZE);
 		if (build_array == NULL) {
 			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
 				"MemtxTree", "buildNext");
 		}
 		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+			BPS_TREE_EXTENT_SIZE / sizeof(struct memtx_tree_data);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		struct tuple **tmp = (struct tuple **)
+		struct memtx_tree_data *tmp = (struct memtx_tree_data *)
 			realloc(build_array, build_array_alloc_size *
 				sizeof(*tmp));
 		if (tmp == NULL) {
@@ -400,19 +534,31 @@ MemtxTree::buildNext(struct tuple *tuple)
 		}
 		build_array = tmp;
 	}
-	build_array[build_array_size++] = tuple;
+	struct memtx_tree_data *elem = &build_array[build_array_size++];
+	elem->tuple = tuple;
+	elem->hint = memtx_tree_tuple_hint(tuple, index_def);
+}
+
+void
+MemtxTree::sortBuild()
+{
+	qsort_arg(build_array, build_array_size,
+		  sizeof(struct memtx_tree_data), memtx_tree_qcompare, index_def);
+	build_array_is_sorted = true;
 }
 
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), memtx_tree_qcompare, index_def);
+	if (!build_array_is_sorted)
+		sortBuild();
 	memtx_tree_build(&tree, build_array, build_array_size);
 
 	free(build_array);
 	build_array = 0;
 	build_array_size = 0;
 	build_array_alloc_size = 0;
+	build_array_is_sorted = false;
 }
 
 /**
@@ -35,7 +35,26 @@
 #include "memtx_engine.h"
 
 struct tuple;
-struct key_data;
+
+/**
+ * An element of a TREE index: a tuple and a hint of its first
+ * key part, see memtx_tree_hint(). Comparing hints is enough to
+ * order most pairs of elements, so the tuples, which are
+ * likely not in cache, are dereferenced only when hints are
+ * equal.
+ */
+struct memtx_tree_data {
+	struct tuple *tuple;
+	uint64_t hint;
+};
+
+/** A key to look up in a TREE index. */
+struct key_data {
+	const char *key;
+	uint32_t part_count;
+	/** Hint of the first key part. */
+	uint64_t hint;
+};
 
 int
 memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct index_def *index_def);
@@ -43,12 +62,31 @@ memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct index_de
 int
 memtx_tree_compare_key(const tuple *a, const key_data *b, struct index_def *index_def);
 
+static inline int
+memtx_tree_data_compare(struct memtx_tree_data a, struct memtx_tree_data b,
+			struct index_def *index_def)
+{
+	if (a.hint != b.hint)
+		return a.hint < b.hint ? -1 : 1;
+	return memtx_tree_compare(a.tuple, b.tuple, index_def);
+}
+
+static inline int
+memtx_tree_data_compare_key(struct memtx_tree_data a,
+			    const struct key_data *b,
+			    struct index_def *index_def)
+{
+	if (a.hint != b->hint)
+		return a.hint < b->hint ? -1 : 1;
+	return memtx_tree_compare_key(a.tuple, b, index_def);
+}
+
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
-#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(a, b, arg)
-#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_data_compare(a, b, arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_data_compare_key(a, b, arg)
+#define bps_tree_elem_t struct memtx_tree_data
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct index_def *
 
@@ -63,10 +101,19 @@ public:
 	virtual void reserve(uint32_t size_hint) override;
 	virtual void buildNext(struct tuple *tuple) override;
 	virtual void endBuild() override;
+	/**
+	 * Sort the tuples added with buildNext(), the most
+	 * expensive part of endBuild(). Touches nothing but
+	 * the build array, so can be called from another thread
+	 * between buildNext() and endBuild().
+	 */
+	void sortBuild();
 	virtual size_t size() const override;
 	virtual struct tuple *random(uint32_t rnd) const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
+	virtual void findByKeys(const char **keys, uint32_t count,
+				struct tuple **result) const override;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) override;
@@ -91,8 +138,9 @@ public:
 
 // protected:
 	struct memtx_tree tree;
-	struct tuple **build_array;
+	struct memtx_tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	bool build_array_is_sorted;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_TREE_H_INCLUDED */
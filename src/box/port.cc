@@ -32,9 +32,11 @@
 #include "tuple.h"
 #include <small/slab_cache.h>
 #include <small/mempool.h>
+#include <small/obuf.h>
 #include <fiber.h>
 
 static struct mempool port_entry_pool;
+static struct mempool port_ref_pool;
 
 void
 port_add_tuple(struct port *port, struct tuple *tuple)
@@ -85,22 +87,67 @@ port_destroy(struct port *port)
 	}
 }
 
-void
-port_dump(struct port *port, struct obuf *out)
+/**
+ * Dump a tuple of the port and drop the port reference to it,
+ * unless it is passed over to a port_ref.
+ */
+static size_t
+port_dump_tuple(struct tuple *tuple, struct obuf *out, struct stailq *refs,
+		size_t min_size)
 {
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+	if (refs != NULL && bsize >= min_size) {
+		struct port_ref *ref = (struct port_ref *)
+			mempool_alloc(&port_ref_pool);
+		if (ref != NULL) {
+			ref->tuple = tuple;
+			ref->offset = obuf_size(out);
+			ref->data = data;
+			ref->size = bsize;
+			stailq_add_tail_entry(refs, ref, in_list);
+			return bsize;
+		}
+	}
+	tuple_to_obuf(tuple, out);
+	tuple_unref(tuple);
+	return 0;
+}
+
+size_t
+port_dump_refs(struct port *port, struct obuf *out, struct stailq *refs,
+	       size_t min_size)
+{
+	size_t ref_size = 0;
 	struct port_entry *e = port->first;
 	if (e == NULL)
-		return;
-	tuple_to_obuf(e->tuple, out);
-	tuple_unref(e->tuple);
+		return 0;
+	ref_size += port_dump_tuple(e->tuple, out, refs, min_size);
 	e = e->next;
 	while (e != NULL) {
 		struct port_entry *cur = e;
-		tuple_to_obuf(e->tuple, out);
+		ref_size += port_dump_tuple(e->tuple, out, refs, min_size);
 		e = e->next;
-		tuple_unref(cur->tuple);
 		mempool_free(&port_entry_pool, cur);
 	}
+	return ref_size;
+}
+
+void
+port_dump(struct port *port, struct obuf *out)
+{
+	port_dump_refs(port, out, NULL, SIZE_MAX);
+}
+
+void
+port_refs_release(struct stailq *refs)
+{
+	struct port_ref *ref, *next;
+	stailq_foreach_entry_safe(ref, next, refs, in_list) {
+		tuple_unref(ref->tuple);
+		mempool_free(&port_ref_pool, ref);
+	}
+	stailq_create(refs);
 }
 
 void
@@ -108,10 +155,13 @@ port_init(void)
 {
 	mempool_create(&port_entry_pool, &cord()->slabc,
 		       sizeof(struct port_entry));
+	mempool_create(&port_ref_pool, &cord()->slabc,
+		       sizeof(struct port_ref));
 }
 
 void
 port_free(void)
 {
 	mempool_destroy(&port_entry_pool);
+	mempool_destroy(&port_ref_pool);
 }
@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include "trivia/util.h"
+#include "salad/stailq.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -81,6 +82,40 @@ port_destroy(struct port *port);
 void
 port_dump(struct port *port, struct obuf *out);
 
+/**
+ * A tuple which is sent to the client right from the tuple
+ * memory instead of being copied to the output buffer. The
+ * tuple stays referenced until the data is written out.
+ * Created and destroyed in the tx thread, but is consumed
+ * by a network thread in between.
+ */
+struct port_ref {
+	struct stailq_entry in_list;
+	struct tuple *tuple;
+	/** Size of the output buffer the tuple data follows. */
+	size_t offset;
+	/** Tuple data which is not written out yet. */
+	const char *data;
+	size_t size;
+};
+
+/**
+ * Like port_dump(), but tuples of at least @a min_size bytes
+ * are not copied to @a out. Instead, a port_ref is added to
+ * @a refs for each of them, taking over the port reference
+ * to the tuple. Tuples are copied if a port_ref can not be
+ * allocated.
+ *
+ * @return the total size of data left out of @a out.
+ */
+size_t
+port_dump_refs(struct port *port, struct obuf *out, struct stailq *refs,
+	       size_t min_size);
+
+/** Unreference tuples of a list of port_ref and free it. */
+void
+port_refs_release(struct stailq *refs);
+
 void
 port_add_tuple(struct port *port, struct tuple *tuple);
 
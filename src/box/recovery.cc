@@ -35,7 +35,8 @@
 #include "xlog.h"
 #include "xrow.h"
 #include "xstream.h"
-#include "wal.h" /* wal_watcher */
+#include "wal.h" /* wal_watcher, wal_tail */
+#include "small/ibuf.h"
 #include "replication.h"
 #include "session.h"
 #include "coeio_file.h"
@@ -218,6 +219,12 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 			 */
 			vclock_follow(&r->vclock,  row.replica_id, row.lsn);
 			xstream_write_xc(stream, &row);
+			/*
+			 * Let a buffering stream (e.g. relay) ship
+			 * the rows at the end of each WAL write.
+			 */
+			if (xlog_cursor_is_eot(&r->cursor))
+				xstream_flush_xc(stream);
 			++row_count;
 			if (row_count % 100000 == 0)
 				say_info("%.1fM rows processed",
@@ -324,6 +331,8 @@ recover_current_wal:
 	if (stop_vclock != NULL && vclock_compare(&r->vclock, stop_vclock) != 0)
 		tnt_raise(XlogGapError, &r->vclock, stop_vclock);
 
+	/* There are no more rows at hand, push out buffered ones. */
+	xstream_flush_xc(stream);
 	region_free(&fiber()->gc);
 }
 
@@ -467,6 +476,68 @@ public:
 	}
 };
 
+/**
+ * Relay rows from the in-memory tail of WAL, see
+ * wal_tail_attach(), until the fiber is cancelled or falls
+ * behind the tail.
+ *
+ * @retval true if the rows were relayed from memory
+ * @retval false if the tail is not available
+ */
+static bool
+recovery_follow_wal_tail(struct recovery *r, struct xstream *stream,
+			 WalSubscription *subscription,
+			 ev_tstamp wal_dir_rescan_delay)
+{
+	struct wal_tail_cursor cursor;
+	if (wal_tail_attach(&cursor, &r->vclock) != 0)
+		return false;
+	say_info("following the in-memory tail of WAL");
+
+	struct ibuf buf;
+	ibuf_create(&buf, &cord()->slabc, 16 * 1024);
+	auto buf_guard = make_scoped_guard([&]{
+		ibuf_destroy(&buf);
+	});
+	while (! fiber_is_cancelled()) {
+		ssize_t size = wal_tail_read(&cursor, &buf);
+		if (size < 0) {
+			say_info("fell behind the in-memory tail of WAL, "
+				 "switching to xlog files");
+			/* Pick up the xlogs written in the meantime. */
+			xdir_scan_xc(&r->wal_dir);
+			break;
+		}
+		const char *pos = buf.rpos;
+		struct xrow_header row;
+		int rc;
+		while ((rc = wal_tail_next(&pos, buf.wpos, &row)) == 0) {
+			/* See recover_xlog(). */
+			if (row.lsn <= vclock_get(&r->vclock, row.replica_id))
+				continue; /* already sent, skip */
+			vclock_follow(&r->vclock, row.replica_id, row.lsn);
+			xstream_write_xc(stream, &row);
+		}
+		if (rc < 0)
+			diag_raise();
+		/* Keep an incomplete row until the rest is read. */
+		buf.rpos = (char *) pos;
+		if (ibuf_used(&buf) == 0)
+			ibuf_reset(&buf);
+		if (size > 0) {
+			xstream_flush_xc(stream);
+			continue;
+		}
+		if (subscription->signaled == false) {
+			fiber_set_cancellable(true);
+			fiber_yield_timeout(wal_dir_rescan_delay);
+			fiber_set_cancellable(false);
+		}
+		subscription->signaled = false;
+	}
+	return true;
+}
+
 static int
 recovery_follow_f(va_list ap)
 {
@@ -512,6 +583,15 @@ recovery_follow_f(va_list ap)
 			 (r->cursor.state == XLOG_CURSOR_CLOSED ||
 			  r->cursor.state == XLOG_CURSOR_EOF));
 
+		/*
+		 * Caught up with the xlog files. Relay rows right
+		 * from memory, if possible, and return to the files
+		 * only if we fall behind.
+		 */
+		if (recovery_follow_wal_tail(r, stream, &subscription,
+					     wal_dir_rescan_delay))
+			continue;
+
 		subscription.set_log_path(r->cursor.state != XLOG_CURSOR_CLOSED ?
 					  r->cursor.name: NULL);
 
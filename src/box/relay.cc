@@ -50,9 +50,14 @@
 #include "xrow.h"
 #include "xrow_io.h"
 #include "xstream.h"
+#include "small/ibuf.h"
 
 /** Report relay status to tx thread at least once per this interval */
 static const int RELAY_REPORT_INTERVAL = 1;
+/** Write out the relay output buffer once it has grown this big. */
+static const size_t RELAY_BATCH_SIZE_MAX = 128 * 1024;
+/** Write out the relay output buffer if it holds rows this old. */
+static const ev_tstamp RELAY_BATCH_TIMEOUT = 0.01;
 
 /**
  * Cbus message to send status updates from relay to tx thread.
@@ -64,6 +69,10 @@ struct relay_status_msg {
 	struct relay *relay;
 	/** New vclock */
 	struct vclock vclock;
+	/** The vclock of rows written by the replica */
+	struct vclock ack_vclock;
+	/** Row shipping statistics */
+	struct relay_stat stat;
 };
 
 /**
@@ -94,6 +103,24 @@ struct relay {
 	ev_tstamp wal_dir_rescan_delay;
 	/** Remote replica id */
 	uint32_t replica_id;
+	/** The replica this relay feeds. Accessed in tx only. */
+	struct replica *replica;
+	/**
+	 * The vclock of rows the replica has written to its
+	 * WAL, as last acknowledged by it, see relay_reader_f().
+	 */
+	struct vclock ack_vclock;
+	/**
+	 * Output buffer: rows are packed into it and written
+	 * to the replica in one go, see relay_flush().
+	 */
+	struct obuf send_buf;
+	/** Number of rows in the output buffer. */
+	uint32_t send_rows;
+	/** Time the first row was put into the output buffer. */
+	ev_tstamp send_start;
+	/** Row shipping statistics, maintained by the relay. */
+	struct relay_stat stat;
 
 	/** Relay endpoint */
 	struct cbus_endpoint endpoint;
@@ -113,6 +140,8 @@ struct relay {
 		alignas(CACHELINE_SIZE)
 		/** Current vclock sent by relay */
 		struct vclock vclock;
+		/** Row shipping statistics reported by relay */
+		struct relay_stat stat;
 		/** The condition is signaled at relay exit. */
 		struct ipc_cond exit_cond;
 	} tx;
@@ -124,10 +153,20 @@ relay_vclock(const struct relay *relay)
 	return &relay->tx.vclock;
 }
 
+const struct relay_stat *
+relay_stat(const struct relay *relay)
+{
+	return &relay->tx.stat;
+}
+
 static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row);
 static void
 relay_send_row(struct xstream *stream, struct xrow_header *row);
+static void
+relay_flush_stream(struct xstream *stream);
+static void
+relay_flush(struct relay *relay);
 
 static inline void
 relay_create(struct relay *relay, int fd, uint64_t sync,
@@ -135,10 +174,29 @@ relay_create(struct relay *relay, int fd, uint64_t sync,
 {
 	memset(relay, 0, sizeof(*relay));
 	xstream_create(&relay->stream, stream_write);
+	relay->stream.flush = relay_flush_stream;
 	coio_init(&relay->io, fd);
 	relay->sync = sync;
 }
 
+/**
+ * Create the output buffer. Must be called in the thread
+ * which is going to send rows, since the buffer memory
+ * comes from the thread's slab cache.
+ */
+static inline void
+relay_send_buf_create(struct relay *relay)
+{
+	obuf_create(&relay->send_buf, &cord()->slabc, RELAY_BATCH_SIZE_MAX);
+	relay->send_rows = 0;
+}
+
+static inline void
+relay_send_buf_destroy(struct relay *relay)
+{
+	obuf_destroy(&relay->send_buf);
+}
+
 static inline void
 relay_destroy(struct relay *relay)
 {
@@ -165,12 +223,15 @@ relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
 {
 	struct relay relay;
 	relay_create(&relay, fd, sync, relay_send_initial_join_row);
+	relay_send_buf_create(&relay);
 	auto scope_guard = make_scoped_guard([&]{
+		relay_send_buf_destroy(&relay);
 		relay_destroy(&relay);
 	});
 
 	assert(relay.stream.write != NULL);
 	engine_join(vclock, &relay.stream);
+	relay_flush(&relay);
 }
 
 int
@@ -179,12 +240,17 @@ relay_final_join_f(va_list ap)
 	struct relay *relay = va_arg(ap, struct relay *);
 	coeio_enable();
 	relay_set_cord_name(relay->io.fd);
+	relay_send_buf_create(relay);
+	auto send_buf_guard = make_scoped_guard([&]{
+		relay_send_buf_destroy(relay);
+	});
 
 	/* Send all WALs until stop_vclock */
 	assert(relay->stream.write != NULL);
 	xdir_scan_xc(&relay->r->wal_dir);
 	recover_remaining_wals(relay->r, &relay->stream, &relay->stop_vclock);
 	assert(vclock_compare(&relay->r->vclock, &relay->stop_vclock) == 0);
+	relay_flush(relay);
 	return 0;
 }
 
@@ -213,11 +279,14 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 }
 
 static void
-feed_event_f(struct trigger *trigger, void * /* event */)
+wakeup_fiber_f(struct trigger *trigger, void * /* event */)
 {
-	ev_feed_event(loop(), (struct ev_io *) trigger->data, EV_CUSTOM);
+	fiber_wakeup((struct fiber *) trigger->data);
 }
 
+static void
+relay_send_status(struct relay *relay);
+
 /**
  * The message which updated tx thread with a new vclock has returned back
  * to the relay.
@@ -227,7 +296,14 @@ relay_status_update(struct cmsg *msg)
 {
 	msg->route = NULL;
 	struct relay_status_msg *status_msg = (struct relay_status_msg *)msg;
-	ipc_cond_signal(&status_msg->relay->status_cond);
+	struct relay *relay = status_msg->relay;
+	ipc_cond_signal(&relay->status_cond);
+	/*
+	 * Don't make transactions waiting for a quorum wait for
+	 * the next status report: deliver a fresh ack right away.
+	 */
+	if (vclock_compare(&status_msg->ack_vclock, &relay->ack_vclock) != 0)
+		relay_send_status(relay);
 }
 
 /**
@@ -238,6 +314,9 @@ tx_status_update(struct cmsg *msg)
 {
 	struct relay_status_msg *status = (struct relay_status_msg *)msg;
 	vclock_copy(&status->relay->tx.vclock, &status->vclock);
+	status->relay->tx.stat = status->stat;
+	replica_set_ack(status->relay->replica,
+			vclock_get(&status->ack_vclock, instance_id));
 	static const struct cmsg_hop route[] = {
 		{relay_status_update, NULL}
 	};
@@ -276,13 +355,75 @@ relay_cbus_detach(struct relay *relay)
 	cpipe_destroy(&relay->tx_pipe);
 	cbus_endpoint_destroy(&relay->endpoint, cbus_process);
 	ipc_cond_destroy(&relay->status_cond);
+	relay_send_buf_destroy(relay);
+}
+
+/**
+ * Deliver the relay vclock and the replica acknowledgement
+ * to tx thread, unless they are unchanged or the previous
+ * status message hasn't returned yet.
+ */
+static void
+relay_send_status(struct relay *relay)
+{
+	if (relay->status_msg.msg.route != NULL ||
+	    (vclock_compare(&relay->status_msg.vclock,
+			    &relay->r->vclock) == 0 &&
+	     vclock_compare(&relay->status_msg.ack_vclock,
+			    &relay->ack_vclock) == 0))
+		return;
+	static const struct cmsg_hop route[] = {
+		{tx_status_update, NULL}
+	};
+	cmsg_init(&relay->status_msg.msg, route);
+	vclock_copy(&relay->status_msg.vclock, &relay->r->vclock);
+	vclock_copy(&relay->status_msg.ack_vclock, &relay->ack_vclock);
+	relay->status_msg.stat = relay->stat;
+	relay->status_msg.relay = relay;
+	cpipe_push(&relay->tx_pipe, &relay->status_msg.msg);
 }
 
 /**
- * A libev callback invoked when a relay client socket is ready
- * for read. This currently only happens when the client closes
- * its socket, and we get an EOF.
+ * Read acknowledgements from the replica: each is the vclock
+ * of rows the replica has written to its WAL. Older replicas
+ * send nothing, so the only thing read from them is EOF.
+ * Stops the relay once the replica closes its socket.
  */
+static int
+relay_reader_f(va_list ap)
+{
+	struct relay *relay = va_arg(ap, struct relay *);
+	struct fiber *relay_f = va_arg(ap, struct fiber *);
+
+	struct ibuf ibuf;
+	struct ev_io io;
+	coio_init(&io, relay->io.fd);
+	ibuf_create(&ibuf, &cord()->slabc, 1024);
+	try {
+		while (!fiber_is_cancelled()) {
+			struct xrow_header xrow;
+			coio_read_xrow(&io, &ibuf, &xrow);
+			struct vclock ack_vclock;
+			vclock_create(&ack_vclock);
+			xrow_decode_vclock(&xrow, &ack_vclock);
+			vclock_copy(&relay->ack_vclock, &ack_vclock);
+			relay_send_status(relay);
+			fiber_gc();
+		}
+	} catch (FiberIsCancelled *e) {
+		/* The relay is exiting. */
+	} catch (SocketError *e) {
+		say_info("the replica has closed its socket, exiting");
+	} catch (Exception *e) {
+		e->log();
+	}
+	/* The relay fiber is joining us if we are cancelled. */
+	if (!fiber_is_cancelled())
+		fiber_cancel(relay_f);
+	ibuf_destroy(&ibuf);
+	return 0;
+}
+
 static int
 relay_subscribe_f(va_list ap)
 {
@@ -290,6 +431,7 @@ relay_subscribe_f(va_list ap)
 	struct recovery *r = relay->r;
 	coeio_enable();
 	relay->stream.write = relay_send_row;
+	relay_send_buf_create(relay);
 	ipc_cond_create(&relay->status_cond);
 	cbus_endpoint_create(&relay->endpoint, cord_name(cord()),
 			     fiber_schedule_cb, fiber());
@@ -308,18 +450,19 @@ relay_subscribe_f(va_list ap)
 			      relay->wal_dir_rescan_delay);
 
 	/*
-	 * Init a read event: when replica closes its end
-	 * of the socket, we can read EOF and shutdown the
-	 * relay.
+	 * Start a fiber reading acknowledgements from the
+	 * replica. When replica closes its end of the socket,
+	 * the reader gets EOF and cancels this fiber to shut
+	 * down the relay.
 	 */
-	struct ev_io read_ev;
-	read_ev.data = fiber();
-	ev_io_init(&read_ev, (ev_io_cb) fiber_schedule_cb,
-		   relay->io.fd, EV_READ);
+	char name[FIBER_NAME_MAX];
+	snprintf(name, sizeof(name), "%s:reader", fiber_name(fiber()));
+	struct fiber *reader = fiber_new_xc(name, relay_reader_f);
+	fiber_set_joinable(reader, true);
+	fiber_start(reader, relay, fiber());
 	/**
 	 * If there is an exception in the follower fiber, it's
-	 * sufficient to break the main fiber's wait on the read
-	 * event.
+	 * sufficient to break the main fiber's wait.
 	 * recovery_stop_local() will follow and raise the
 	 * original exception in the joined fiber.  This original
 	 * exception will reach cord_join() and will be raised
@@ -330,52 +473,26 @@ relay_subscribe_f(va_list ap)
 	 * the follower fiber is enclosed into life of this fiber.
 	 */
 	struct trigger on_follow_error = {
-		RLIST_LINK_INITIALIZER, feed_event_f, &read_ev, NULL
+		RLIST_LINK_INITIALIZER, wakeup_fiber_f, fiber(), NULL
 	};
 	trigger_add(&r->watcher->on_stop, &on_follow_error);
-	while (! fiber_is_dead(r->watcher)) {
-		ev_io_start(loop(), &read_ev);
+	while (!fiber_is_cancelled() && !fiber_is_dead(r->watcher)) {
 		fiber_yield_timeout(RELAY_REPORT_INTERVAL);
-		ev_io_stop(loop(), &read_ev);
 		/*
-		 * The fiber can be woken by IO read event, by the timeout of
-		 * status messaging or by an acknowledge to status message.
-		 * Handle cbus messages first.
+		 * The fiber can be woken by the timeout of status
+		 * messaging, by an acknowledge to status message
+		 * or by the reader. Handle cbus messages first.
 		 */
 		cbus_process(&relay->endpoint);
-
-		uint8_t data;
-		int rc = recv(read_ev.fd, &data, sizeof(data), 0);
-
-		if (rc == 0 || (rc < 0 && errno == ECONNRESET)) {
-			say_info("the replica has closed its socket, exiting");
-			break;
-		}
-		if (rc < 0 && errno != EINTR && errno != EAGAIN &&
-		    errno != EWOULDBLOCK)
-			say_syserror("recv");
-
-		/*
-		 * Check that the vclock has been updated and the previous
-		 * status message is delivered
-		 */
-		if (relay->status_msg.msg.route != NULL ||
-		    vclock_compare(&relay->status_msg.vclock,
-				   &r->vclock) == 0)
-			continue;
-		static const struct cmsg_hop route[] = {
-			{tx_status_update, NULL}
-		};
-		cmsg_init(&relay->status_msg.msg, route);
-		vclock_copy(&relay->status_msg.vclock, &r->vclock);
-		relay->status_msg.relay = relay;
-		cpipe_push(&relay->tx_pipe, &relay->status_msg.msg);
+		relay_send_status(relay);
 	}
 	/*
 	 * Avoid double wakeup: both from the on_stop and fiber
 	 * cancel events.
 	 */
 	trigger_clear(&on_follow_error);
+	fiber_cancel(reader);
+	fiber_join(reader);
 	recovery_stop_local(r);
 	return 0;
 }
@@ -399,6 +516,8 @@ relay_subscribe(int fd, uint64_t sync, struct replica *replica,
 			       replica_clock);
 	vclock_copy(&relay.tx.vclock, replica_clock);
 	relay.replica_id = replica->id;
+	relay.replica = replica;
+	vclock_create(&relay.ack_vclock);
 	relay.wal_dir_rescan_delay = cfg_getd("wal_dir_rescan_delay");
 	replica_set_relay(replica, &relay);
 
@@ -430,12 +549,64 @@ relay_subscribe(int fd, uint64_t sync, struct replica *replica,
 	}
 }
 
+/**
+ * Write all rows accumulated in the output buffer to the
+ * replica with a single writev().
+ */
+static void
+relay_flush(struct relay *relay)
+{
+	if (relay->send_rows == 0)
+		return;
+	struct obuf *buf = &relay->send_buf;
+	size_t size = obuf_size(buf);
+	int iovcnt = obuf_iovcnt(buf);
+	/* coio_writev() advances the iovec, don't let it spoil obuf. */
+	struct iovec iov[SMALL_OBUF_IOV_MAX + 1];
+	memcpy(iov, buf->iov, iovcnt * sizeof(struct iovec));
+	coio_writev(&relay->io, iov, iovcnt, size);
+
+	double latency = ev_time() - relay->send_start;
+	struct relay_stat *stat = &relay->stat;
+	stat->batch_count++;
+	stat->row_count += relay->send_rows;
+	stat->byte_count += size;
+	stat->flush_latency += latency;
+	if (latency > stat->flush_latency_max)
+		stat->flush_latency_max = latency;
+
+	obuf_reset(buf);
+	relay->send_rows = 0;
+}
+
+static void
+relay_flush_stream(struct xstream *stream)
+{
+	struct relay *relay = container_of(stream, struct relay, stream);
+	relay_flush(relay);
+}
+
+/**
+ * Put a row into the output buffer. The buffer is written
+ * out when it is big enough or holds rows for too long, and
+ * also at the end of each WAL transaction, when the
+ * recovery flushes the stream.
+ */
 static void
 relay_send(struct relay *relay, struct xrow_header *packet)
 {
 	packet->sync = relay->sync;
-	coio_write_xrow(&relay->io, packet);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec(packet, iov);
+	if (relay->send_rows == 0)
+		relay->send_start = ev_time();
+	for (int i = 0; i < iovcnt; i++)
+		obuf_dup_xc(&relay->send_buf, iov[i].iov_base, iov[i].iov_len);
+	relay->send_rows++;
 	fiber_gc();
+	if (obuf_size(&relay->send_buf) >= RELAY_BATCH_SIZE_MAX ||
+	    ev_time() - relay->send_start >= RELAY_BATCH_TIMEOUT)
+		relay_flush(relay);
 }
 
 static void
@@ -445,6 +616,7 @@ relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 	relay_send(relay, row);
 	ERROR_INJECT(ERRINJ_RELAY,
 	{
+		relay_flush(relay);
 		fiber_sleep(1000.0);
 	});
 }
@@ -464,6 +636,7 @@ relay_send_row(struct xstream *stream, struct xrow_header *packet)
 		relay_send(relay, packet);
 		ERROR_INJECT(ERRINJ_RELAY,
 		{
+			relay_flush(relay);
 			fiber_sleep(1000.0);
 		});
 	}
@@ -42,6 +42,23 @@ struct replica;
 struct tt_uuid;
 struct vclock;
 
+/** Statistics of rows shipped by a relay. */
+struct relay_stat {
+	/** Number of writes to the replica socket. */
+	uint64_t batch_count;
+	/** Number of rows sent. */
+	uint64_t row_count;
+	/** Number of bytes sent. */
+	uint64_t byte_count;
+	/**
+	 * Total time rows spent in the output buffer, from
+	 * the first row of a batch till the batch is written.
+	 */
+	double flush_latency;
+	/** Max time a batch spent in the output buffer. */
+	double flush_latency_max;
+};
+
 /**
  * Returns relay's vclock
  * @param relay relay
@@ -50,6 +67,13 @@ struct vclock;
 const struct vclock *
 relay_vclock(const struct relay *relay);
 
+/**
+ * Returns relay's row shipping statistics, as last
+ * reported to the tx thread.
+ */
+const struct relay_stat *
+relay_stat(const struct relay *relay);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
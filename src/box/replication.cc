@@ -39,10 +39,14 @@
 #include "box.h"
 #include "applier.h"
 #include "error.h"
+#include "histogram.h"
 #include "vclock.h" /* VCLOCK_MAX */
 
 struct vclock replicaset_vclock;
 uint32_t instance_id = REPLICA_ID_NIL;
+int replication_sync_quorum = 0;
+double replication_sync_timeout = 10;
+struct replicaset_sync_stat replicaset_sync_stat;
 /**
  * Globally unique identifier of this replica set.
  * A replica set is a set of appliers and their matching
@@ -70,6 +74,26 @@ rb_gen(, replicaset_, replicaset_t, struct replica, link,
 static struct mempool replica_pool;
 static replicaset_t replicaset;
 
+/** A fiber waiting for a quorum, see replicaset_sync_wait(). */
+struct sync_waiter {
+	/** Link in sync_queue. */
+	struct rlist in_queue;
+	/** LSN of the last row of the transaction. */
+	int64_t lsn;
+	struct fiber *fiber;
+	/** Set when a quorum has acknowledged the LSN. */
+	bool is_confirmed;
+};
+
+/** Fibers waiting for a quorum, ordered by LSN. */
+static struct rlist sync_queue;
+
+/** Buckets of the quorum wait latency histograms, microseconds. */
+static const int64_t sync_latency_buckets[] = {
+	100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000,
+	100000, 200000, 500000, 1000000, 2000000, 5000000, 10000000,
+};
+
 void
 replication_init(void)
 {
@@ -77,12 +101,17 @@ replication_init(void)
 		       sizeof(struct replica));
 	replicaset_new(&replicaset);
 	vclock_create(&replicaset_vclock);
+	rlist_create(&sync_queue);
 }
 
 void
 replication_free(void)
 {
 	mempool_destroy(&replica_pool);
+	for (int i = 0; i < VCLOCK_MAX; i++) {
+		if (replicaset_sync_stat.latency[i] != NULL)
+			histogram_delete(replicaset_sync_stat.latency[i]);
+	}
 }
 
 void
@@ -118,6 +147,7 @@ replica_new(const struct tt_uuid *uuid)
 	replica->uuid = *uuid;
 	replica->applier = NULL;
 	replica->relay = NULL;
+	replica->ack_lsn = 0;
 	return replica;
 }
 
@@ -281,3 +311,118 @@ replica_by_uuid(const struct tt_uuid *uuid)
 	key.uuid = *uuid;
 	return replicaset_search(&replicaset, &key);
 }
+
+static int
+sync_ack_cmp(const void *a, const void *b)
+{
+	int64_t lsn_a = *(const int64_t *) a;
+	int64_t lsn_b = *(const int64_t *) b;
+	/* Descending order. */
+	return lsn_a < lsn_b ? 1 : lsn_a > lsn_b ? -1 : 0;
+}
+
+/**
+ * Return the max LSN of this instance acknowledged by at
+ * least replication_sync_quorum replicas.
+ */
+static int64_t
+replicaset_sync_confirmed_lsn(void)
+{
+	int quorum = replication_sync_quorum;
+	assert(quorum > 0);
+	int64_t acks[VCLOCK_MAX];
+	int count = 0;
+	replicaset_foreach(replica) {
+		if (replica->id == REPLICA_ID_NIL ||
+		    replica->id == instance_id)
+			continue;
+		assert(count < VCLOCK_MAX);
+		acks[count++] = replica->ack_lsn;
+	}
+	if (count < quorum)
+		return 0;
+	qsort(acks, count, sizeof(*acks), sync_ack_cmp);
+	return acks[quorum - 1];
+}
+
+void
+replicaset_sync_update(void)
+{
+	int64_t confirmed_lsn = INT64_MAX;
+	if (replication_sync_quorum > 0) {
+		confirmed_lsn = replicaset_sync_confirmed_lsn();
+		replicaset_sync_stat.confirmed_lsn = confirmed_lsn;
+	}
+	while (!rlist_empty(&sync_queue)) {
+		struct sync_waiter *waiter =
+			rlist_first_entry(&sync_queue, struct sync_waiter,
+					  in_queue);
+		if (waiter->lsn > confirmed_lsn)
+			break;
+		rlist_del_entry(waiter, in_queue);
+		waiter->is_confirmed = true;
+		fiber_wakeup(waiter->fiber);
+	}
+}
+
+void
+replica_set_ack(struct replica *replica, int64_t lsn)
+{
+	if (lsn <= replica->ack_lsn)
+		return;
+	replica->ack_lsn = lsn;
+	if (replication_sync_quorum > 0)
+		replicaset_sync_update();
+}
+
+int
+replicaset_sync_wait(int64_t lsn)
+{
+	int quorum = replication_sync_quorum;
+	if (quorum == 0 || lsn <= replicaset_sync_stat.confirmed_lsn)
+		return 0;
+
+	struct sync_waiter waiter;
+	waiter.lsn = lsn;
+	waiter.fiber = fiber();
+	waiter.is_confirmed = false;
+	/*
+	 * Transactions are committed in LSN order, so
+	 * the waiter usually goes to the tail of the queue.
+	 */
+	struct rlist *prev = rlist_last(&sync_queue);
+	while (prev != &sync_queue &&
+	       rlist_entry(prev, struct sync_waiter, in_queue)->lsn > lsn)
+		prev = rlist_prev(prev);
+	rlist_add(prev, &waiter.in_queue);
+
+	replicaset_sync_stat.waiting++;
+	ev_tstamp start = ev_now(loop());
+	ev_tstamp deadline = start + replication_sync_timeout;
+	while (!waiter.is_confirmed) {
+		ev_tstamp timeout = deadline - ev_now(loop());
+		if (timeout <= 0 || fiber_is_cancelled())
+			break;
+		fiber_yield_timeout(timeout);
+	}
+	replicaset_sync_stat.waiting--;
+
+	if (!waiter.is_confirmed) {
+		rlist_del_entry(&waiter, in_queue);
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+		replicaset_sync_stat.timeouts++;
+		diag_set(ClientError, ER_TIMEOUT);
+		return -1;
+	}
+
+	struct histogram **latency = &replicaset_sync_stat.latency[quorum];
+	if (*latency == NULL)
+		*latency = histogram_new(sync_latency_buckets,
+					 lengthof(sync_latency_buckets));
+	if (*latency != NULL)
+		histogram_collect(*latency, (ev_now(loop()) - start) * 1e6);
+	return 0;
+}
@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include "tt_uuid.h"
+#include "vclock.h" /* VCLOCK_MAX */
 #include <stdint.h>
 #define RB_COMPACT 1
 #include <small/rb.h> /* replicaset_t */
@@ -39,8 +40,11 @@
  * @module replication - global state of multi-master
  * replicated database.
  *
- * Right now we only support asynchronous master-master
- * replication.
+ * Replication is asynchronous master-master, unless
+ * box.cfg.replication_sync_quorum is set: then a transaction
+ * is not reported committed to the client until the given
+ * number of replicas acknowledge they have written it to
+ * their WAL, see replicaset_sync_wait().
  *
  * Each replica set has a globally unique identifier. Each
  * replica in the replica set is identified as well.
@@ -100,6 +104,20 @@ extern uint32_t instance_id;
  */
 extern struct vclock replicaset_vclock;
 
+/**
+ * Number of replicas which must acknowledge a local
+ * transaction before it is reported committed,
+ * box.cfg.replication_sync_quorum. 0 means asynchronous
+ * replication.
+ */
+extern int replication_sync_quorum;
+
+/**
+ * How long a transaction waits for the quorum,
+ * box.cfg.replication_sync_timeout.
+ */
+extern double replication_sync_timeout;
+
 /** UUID of the instance. */
 extern struct tt_uuid INSTANCE_UUID;
 /** UUID of the replica set. */
@@ -114,8 +132,31 @@ struct replica {
 	struct applier *applier;
 	struct relay *relay;
 	uint32_t id;
+	/**
+	 * LSN of this instance the replica has acknowledged
+	 * to have written to its WAL.
+	 */
+	int64_t ack_lsn;
+};
+
+/** Statistics of transactions waiting for a quorum. */
+struct replicaset_sync_stat {
+	/** Max LSN acknowledged by a quorum of replicas. */
+	int64_t confirmed_lsn;
+	/** Number of transactions waiting for a quorum. */
+	int waiting;
+	/** Number of transactions which timed out waiting. */
+	int64_t timeouts;
+	/**
+	 * Histograms of the time spent waiting for a quorum,
+	 * in microseconds, indexed by the quorum size.
+	 * NULL if no transaction has waited for such a quorum.
+	 */
+	struct histogram *latency[VCLOCK_MAX];
 };
 
+extern struct replicaset_sync_stat replicaset_sync_stat;
+
 enum {
 	/**
 	 * Reserved id used for local requests, snapshot rows and in cases
@@ -169,6 +210,35 @@ replica_set_relay(struct replica *replica, struct relay *relay);
 void
 replica_clear_relay(struct replica *replica);
 
+/**
+ * Account an acknowledgement from a \a replica: it has
+ * written the rows of this instance up to \a lsn. Wakes up
+ * transactions confirmed by a quorum.
+ */
+void
+replica_set_ack(struct replica *replica, int64_t lsn);
+
+/**
+ * Wait until replication_sync_quorum replicas acknowledge
+ * the rows of this instance up to \a lsn. Many fibers may
+ * wait at once, each for its own transaction.
+ *
+ * The transaction is committed locally by the time this
+ * function is called, and stays committed if it fails.
+ *
+ * @retval 0 the quorum is reached or not configured
+ * @retval -1 timeout or the fiber is cancelled, diag is set
+ */
+int
+replicaset_sync_wait(int64_t lsn);
+
+/**
+ * Re-check the waiting transactions after
+ * replication_sync_quorum is changed.
+ */
+void
+replicaset_sync_update(void);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 
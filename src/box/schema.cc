@@ -40,6 +40,7 @@
 #include "key_def.h"
 #include "alter.h"
 #include "scoped_guard.h"
+#include "version.h"
 #include <stdio.h>
 /**
  * @module Data Dictionary
@@ -219,6 +220,27 @@ schema_find_id(uint32_t system_space_id, uint32_t index_id,
 	return BOX_ID_NIL;
 }
 
+uint32_t
+schema_dd_version_id()
+{
+	struct space *space = space_cache_find(BOX_SCHEMA_ID);
+	MemtxIndex *index = index_find_system(space, 0);
+	char buf[16];
+	mp_encode_str(buf, "version", strlen("version"));
+
+	struct iterator *it = index->position();
+	index->initIterator(it, ITER_EQ, buf, 1);
+
+	struct tuple *tuple = it->next(it);
+	if (tuple == NULL)
+		return 0;
+	/* {'version', major, minor[, patch]} */
+	uint32_t patch = tuple_field_count(tuple) > 3 ?
+			 tuple_field_u32_xc(tuple, 3) : 0;
+	return version_id(tuple_field_u32_xc(tuple, 1),
+			  tuple_field_u32_xc(tuple, 2), patch);
+}
+
 /**
  * Initialize a prototype for the two mandatory data
  * dictionary spaces and create a cache entry for them.
@@ -291,6 +313,14 @@ schema_init()
 	index_def->space_id = def.id = BOX_CLUSTER_ID;
 	snprintf(def.name, sizeof(def.name), "_cluster");
 	(void) sc_space_new(&def, index_def, &on_replace_cluster);
+
+	/*
+	 * _truncate - space id <-> number of truncations.
+	 * The real index is defined in the snapshot.
+	 */
+	index_def->space_id = def.id = BOX_TRUNCATE_ID;
+	snprintf(def.name, sizeof(def.name), "_truncate");
+	(void) sc_space_new(&def, index_def, &on_replace_truncate);
 	index_def_delete(index_def);
 
 	/* _index - definition of indexes in all spaces */
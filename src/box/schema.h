@@ -59,6 +59,8 @@ enum {
 	BOX_VPRIV_ID = 313,
 	/** Space id of _cluster. */
 	BOX_CLUSTER_ID = 320,
+	/** Space id of _truncate. */
+	BOX_TRUNCATE_ID = 330,
 	/** End of the reserved range of system spaces. */
 	BOX_SYSTEM_ID_MAX = 511,
 	BOX_ID_NIL = 2147483647
@@ -142,6 +144,13 @@ uint32_t
 schema_find_id(uint32_t system_space_id, uint32_t index_id,
 	       const char *name, uint32_t len);
 
+/**
+ * Return the version of the data dictionary stored in
+ * _schema, encoded with version_id(), or 0 if there's none.
+ */
+uint32_t
+schema_dd_version_id();
+
 void
 func_cache_replace(struct func_def *def);
 
@@ -371,13 +371,29 @@ tuple_hash_slow_path(const struct tuple *tuple, const struct key_def *key_def)
 {
 	assert(key_def->part_count != 1 ||
 	       key_def->parts[1].type != FIELD_TYPE_UNSIGNED);
+	return tuple_hash_parts(tuple, key_def, key_def->part_count);
+}
+
+uint32_t
+key_hash_slow_path(const char *key, const struct key_def *key_def)
+{
+	assert(key_def->part_count != 1 ||
+	       key_def->parts[1].type != FIELD_TYPE_UNSIGNED);
+	return key_hash_parts(key, key_def, key_def->part_count);
+}
+
+uint32_t
+tuple_hash_parts(const struct tuple *tuple, const struct key_def *key_def,
+		 uint32_t part_count)
+{
+	assert(part_count <= key_def->part_count);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
 
 	for (const struct key_part *part = key_def->parts;
-	     part < key_def->parts + key_def->part_count; part++) {
+	     part < key_def->parts + part_count; part++) {
 		const char *field = tuple_field(tuple, part->fieldno);
 		total_size += tuple_hash_field(&h, &carry, &field, part->type);
 	}
@@ -386,17 +402,17 @@ tuple_hash_slow_path(const struct tuple *tuple, const struct key_def *key_def)
 }
 
 uint32_t
-key_hash_slow_path(const char *key, const struct key_def *key_def)
+key_hash_parts(const char *key, const struct key_def *key_def,
+	       uint32_t part_count)
 {
-	assert(key_def->part_count != 1 ||
-	       key_def->parts[1].type != FIELD_TYPE_UNSIGNED);
+	assert(part_count <= key_def->part_count);
 
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
 
 	for (const struct key_part *part = key_def->parts;
-	     part < key_def->parts + key_def->part_count; part++) {
+	     part < key_def->parts + part_count; part++) {
 		total_size += tuple_hash_field(&h, &carry, &key, part->type);
 	}
 
@@ -670,6 +670,32 @@ key_hash(const char *key, const struct key_def *key_def)
 	return key_hash_slow_path(key, key_def);
 }
 
+/**
+ * Calculate a hash value of the first @a part_count parts
+ * of a tuple key. Unlike tuple_hash(), doesn't have a fast
+ * path for single-part integer keys, so the hash of a full
+ * key may differ from the one returned by tuple_hash().
+ * @param tuple - a tuple
+ * @param key_def - key_def for field description
+ * @param part_count - number of key parts to hash
+ * @return - hash value
+ */
+uint32_t
+tuple_hash_parts(const struct tuple *tuple, const struct key_def *key_def,
+		 uint32_t part_count);
+
+/**
+ * Calculate a hash value of the first @a part_count parts
+ * of a key, consistent with tuple_hash_parts().
+ * @param key - key (msgpack fields w/o array marker)
+ * @param key_def - key_def for field description
+ * @param part_count - number of key parts to hash
+ * @return - hash value
+ */
+uint32_t
+key_hash_parts(const char *key, const struct key_def *key_def,
+	       uint32_t part_count);
+
 /** These functions are implemented in tuple_convert.cc. */
 
 struct obuf;
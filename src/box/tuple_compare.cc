@@ -283,7 +283,7 @@ mp_compare_scalar(const char *field_a, const char *field_b)
  * @retval <0 if field_a < field_b
  * @retval >0 if field_a > field_b
  */
-static int
+static inline int
 tuple_compare_field(const char *field_a, const char *field_b,
 		    int8_t type)
 {
@@ -453,9 +453,18 @@ tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
 						   part_count, key_def);
 }
 
+/*
+ * Field comparators below are specialized for the field type
+ * at compile time. Types without a hand-written specialization
+ * use tuple_compare_field() with a constant type, so the switch
+ * in it is folded away.
+ */
 template <int TYPE>
 static inline int
-field_compare(const char **field_a, const char **field_b);
+field_compare(const char **field_a, const char **field_b)
+{
+	return tuple_compare_field(*field_a, *field_b, TYPE);
+}
 
 template <>
 inline int
@@ -479,7 +488,13 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 
 template <int TYPE>
 static inline int
-field_compare_and_next(const char **field_a, const char **field_b);
+field_compare_and_next(const char **field_a, const char **field_b)
+{
+	int r = field_compare<TYPE>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
 
 template <>
 inline int
@@ -601,6 +616,55 @@ struct TupleCompare<0, TYPE, MORE_TYPES...> {
 					format_a, format_b, field_a, field_b);
 	}
 };
+
+/**
+ * Comparator of keys of any length and field numbers, which
+ * parts are all of the same type.
+ */
+template <int TYPE, bool IS_SEQUENTIAL>
+struct TupleCompareSameType
+{
+	static int compare(const struct tuple *tuple_a,
+			   const struct tuple *tuple_b,
+			   const struct key_def *key_def)
+	{
+		assert(key_def->part_count > 0);
+		const struct key_part *part = key_def->parts;
+		const struct key_part *end = part + key_def->part_count;
+		const char *tuple_data_a = tuple_data(tuple_a);
+		const char *tuple_data_b = tuple_data(tuple_b);
+		int r;
+		/* static if */
+		if (IS_SEQUENTIAL) {
+			const char *field_a = tuple_data_a;
+			const char *field_b = tuple_data_b;
+			mp_decode_array(&field_a);
+			mp_decode_array(&field_b);
+			for (; part + 1 < end; part++) {
+				r = field_compare_and_next<TYPE>(&field_a,
+								 &field_b);
+				if (r != 0)
+					return r;
+			}
+			return field_compare<TYPE>(&field_a, &field_b);
+		}
+		struct tuple_format *format_a = tuple_format(tuple_a);
+		struct tuple_format *format_b = tuple_format(tuple_b);
+		const uint32_t *field_map_a = tuple_field_map(tuple_a);
+		const uint32_t *field_map_b = tuple_field_map(tuple_b);
+		for (; part < end; part++) {
+			const char *field_a, *field_b;
+			field_a = tuple_field_raw(format_a, tuple_data_a,
+						  field_map_a, part->fieldno);
+			field_b = tuple_field_raw(format_b, tuple_data_b,
+						  field_map_b, part->fieldno);
+			r = field_compare<TYPE>(&field_a, &field_b);
+			if (r != 0)
+				return r;
+		}
+		return 0;
+	}
+};
 } /* end of anonymous namespace */
 
 struct comparator_signature {
@@ -632,6 +696,43 @@ static const comparator_signature cmp_arr[] = {
 
 #undef COMPARATOR
 
+#define SAME_TYPE_COMPARATOR(TYPE) \
+	{ TupleCompareSameType<TYPE, false>::compare, \
+	  TupleCompareSameType<TYPE, true>::compare }
+
+/**
+ * Comparators of keys with parts of the same type, indexed by
+ * the type and by whether the key is sequential.
+ */
+static const tuple_compare_t cmp_same_type_arr[][2] = {
+	/* .FIELD_TYPE_ANY      = */ { NULL, NULL },
+	/* .FIELD_TYPE_UNSIGNED = */ SAME_TYPE_COMPARATOR(FIELD_TYPE_UNSIGNED),
+	/* .FIELD_TYPE_STRING   = */ SAME_TYPE_COMPARATOR(FIELD_TYPE_STRING),
+	/* .FIELD_TYPE_ARRAY    = */ { NULL, NULL },
+	/* .FIELD_TYPE_NUMBER   = */ SAME_TYPE_COMPARATOR(FIELD_TYPE_NUMBER),
+	/* .FIELD_TYPE_INTEGER  = */ SAME_TYPE_COMPARATOR(FIELD_TYPE_INTEGER),
+	/* .FIELD_TYPE_SCALAR   = */ SAME_TYPE_COMPARATOR(FIELD_TYPE_SCALAR),
+};
+
+#undef SAME_TYPE_COMPARATOR
+
+/**
+ * Return the type of all parts of a key definition or
+ * field_type_MAX if the parts have different types.
+ */
+static enum field_type
+key_def_same_type(const struct key_def *def)
+{
+	if (def->part_count == 0)
+		return field_type_MAX;
+	enum field_type type = def->parts[0].type;
+	for (uint32_t i = 1; i < def->part_count; i++) {
+		if (def->parts[i].type != type)
+			return field_type_MAX;
+	}
+	return type;
+}
+
 tuple_compare_t
 tuple_compare_create(const struct key_def *def) {
 	for (uint32_t k = 0; k < sizeof(cmp_arr) / sizeof(cmp_arr[0]); k++) {
@@ -643,6 +744,10 @@ tuple_compare_create(const struct key_def *def) {
 		if (i == def->part_count && cmp_arr[k].p[i * 2] == UINT32_MAX)
 			return cmp_arr[k].f;
 	}
+	enum field_type type = key_def_same_type(def);
+	if (type != field_type_MAX &&
+	    cmp_same_type_arr[type][key_def_is_sequential(def)] != NULL)
+		return cmp_same_type_arr[type][key_def_is_sequential(def)];
 	if (key_def_is_sequential(def))
 		return tuple_compare_sequential;
 	return tuple_compare_slowpath;
@@ -653,7 +758,11 @@ tuple_compare_create(const struct key_def *def) {
 /* {{{ tuple_compare_with_key */
 
 template <int TYPE>
-static inline int field_compare_with_key(const char **field, const char **key);
+static inline int
+field_compare_with_key(const char **field, const char **key)
+{
+	return tuple_compare_field(*field, *key, TYPE);
+}
 
 template <>
 inline int
@@ -677,7 +786,13 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 
 template <int TYPE>
 static inline int
-field_compare_with_key_and_next(const char **field_a, const char **field_b);
+field_compare_with_key_and_next(const char **field_a, const char **field_b)
+{
+	int r = field_compare_with_key<TYPE>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
 
 template <>
 inline int
@@ -798,6 +913,54 @@ struct TupleCompareWithKey<0, 0, TYPE, MORE_TYPES...>
 	}
 };
 
+/**
+ * Tuple with key comparator for keys of any length and field
+ * numbers, which parts are all of the same type.
+ */
+template <int TYPE, bool IS_SEQUENTIAL>
+struct TupleCompareWithKeySameType
+{
+	static int compare(const struct tuple *tuple,
+			   const char *key,
+			   uint32_t part_count,
+			   const struct key_def *key_def)
+	{
+		assert(key != NULL || part_count == 0);
+		assert(part_count <= key_def->part_count);
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		const struct key_part *part = key_def->parts;
+		const struct key_part *end = part + part_count;
+		const char *data = tuple_data(tuple);
+		int r;
+		/* static if */
+		if (IS_SEQUENTIAL) {
+			const char *field = data;
+			mp_decode_array(&field);
+			for (; part + 1 < end; part++) {
+				r = field_compare_with_key_and_next<TYPE>(
+					&field, &key);
+				if (r != 0)
+					return r;
+			}
+			return field_compare_with_key<TYPE>(&field, &key);
+		}
+		struct tuple_format *format = tuple_format(tuple);
+		const uint32_t *field_map = tuple_field_map(tuple);
+		for (; part < end; part++) {
+			const char *field = tuple_field_raw(format, data,
+							    field_map,
+							    part->fieldno);
+			r = field_compare_with_key<TYPE>(&field, &key);
+			if (r != 0)
+				return r;
+			mp_next(&key);
+		}
+		return 0;
+	}
+};
+
 } /* end of anonymous namespace */
 
 struct comparator_with_key_signature
@@ -827,6 +990,23 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 
 #undef KEY_COMPARATOR
 
+#define SAME_TYPE_KEY_COMPARATOR(TYPE) \
+	{ TupleCompareWithKeySameType<TYPE, false>::compare, \
+	  TupleCompareWithKeySameType<TYPE, true>::compare }
+
+/** Same as cmp_same_type_arr, but for tuple with key comparators. */
+static const tuple_compare_with_key_t cmp_wk_same_type_arr[][2] = {
+	/* .FIELD_TYPE_ANY      = */ { NULL, NULL },
+	/* .FIELD_TYPE_UNSIGNED = */ SAME_TYPE_KEY_COMPARATOR(FIELD_TYPE_UNSIGNED),
+	/* .FIELD_TYPE_STRING   = */ SAME_TYPE_KEY_COMPARATOR(FIELD_TYPE_STRING),
+	/* .FIELD_TYPE_ARRAY    = */ { NULL, NULL },
+	/* .FIELD_TYPE_NUMBER   = */ SAME_TYPE_KEY_COMPARATOR(FIELD_TYPE_NUMBER),
+	/* .FIELD_TYPE_INTEGER  = */ SAME_TYPE_KEY_COMPARATOR(FIELD_TYPE_INTEGER),
+	/* .FIELD_TYPE_SCALAR   = */ SAME_TYPE_KEY_COMPARATOR(FIELD_TYPE_SCALAR),
+};
+
+#undef SAME_TYPE_KEY_COMPARATOR
+
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *def)
 {
@@ -844,6 +1024,10 @@ tuple_compare_with_key_create(const struct key_def *def)
 		if (i == def->part_count)
 			return cmp_wk_arr[k].f;
 	}
+	enum field_type type = key_def_same_type(def);
+	if (type != field_type_MAX &&
+	    cmp_wk_same_type_arr[type][key_def_is_sequential(def)] != NULL)
+		return cmp_wk_same_type_arr[type][key_def_is_sequential(def)];
 	if (key_def_is_sequential(def))
 		return tuple_compare_with_key_sequential;
 	return tuple_compare_with_key_slowpath;
@@ -34,6 +34,9 @@
 #include "journal.h"
 #include <fiber.h>
 #include "xrow.h"
+#include "box.h"
+#include "schema.h"
+#include "replication.h"
 
 enum {
 	/**
@@ -223,6 +226,28 @@ txn_write_to_wal(struct txn *txn)
 	return res;
 }
 
+/**
+ * Return LSN of the last row of a committed transaction a
+ * quorum of replicas must acknowledge, or 0 if the
+ * transaction doesn't wait for a quorum: it is replicated
+ * from another instance, only changes system spaces, or
+ * replication_sync_quorum is not set.
+ */
+static int64_t
+txn_sync_lsn(struct txn *txn)
+{
+	if (replication_sync_quorum == 0 || !box_is_configured())
+		return 0;
+	int64_t lsn = 0;
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->row != NULL && stmt->row->replica_id == instance_id &&
+		    !space_is_system(stmt->space))
+			lsn = MAX(lsn, stmt->row->lsn);
+	}
+	return lsn;
+}
+
 void
 txn_commit(struct txn *txn)
 {
@@ -230,13 +255,16 @@ txn_commit(struct txn *txn)
 
 	assert(stailq_empty(&txn->stmts) || txn->engine);
 
+	int64_t sync_lsn = 0;
 	/* Do transaction conflict resolving */
 	if (txn->engine) {
 		int64_t signature = -1;
 		txn->engine->prepare(txn);
 
-		if (txn->n_rows > 0)
+		if (txn->n_rows > 0) {
 			signature = txn_write_to_wal(txn);
+			sync_lsn = txn_sync_lsn(txn);
+		}
 		/*
 		 * The transaction is in the binary log. No action below
 		 * may throw. In case an error has happened, there is
@@ -251,6 +279,13 @@ txn_commit(struct txn *txn)
 	/** Free volatile txn memory. */
 	fiber_gc();
 	fiber_set_txn(fiber(), NULL);
+	/*
+	 * The transaction is committed locally, but is not
+	 * reported committed until a quorum of replicas have
+	 * it, so that it isn't lost if this instance fails.
+	 */
+	if (sync_lsn > 0 && replicaset_sync_wait(sync_lsn) != 0)
+		diag_raise();
 }
 
 /**
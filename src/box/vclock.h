@@ -135,6 +135,19 @@ vclock_inc(struct vclock *vclock, uint32_t replica_id)
 	return ++vclock->lsn[replica_id];
 }
 
+/**
+ * Undo vclock_follow(): move the LSN of @a replica_id back to
+ * @a prev_lsn, the value returned by vclock_follow().
+ */
+static inline void
+vclock_unfollow(struct vclock *vclock, uint32_t replica_id, int64_t prev_lsn)
+{
+	assert(replica_id < VCLOCK_MAX);
+	assert(prev_lsn <= vclock->lsn[replica_id]);
+	vclock->signature -= vclock->lsn[replica_id] - prev_lsn;
+	vclock->lsn[replica_id] = prev_lsn;
+}
+
 static inline void
 vclock_copy(struct vclock *dst, const struct vclock *src)
 {
@@ -53,6 +53,7 @@
 #include "assoc.h"
 #include "crc32.h"
 #include "clock.h"
+#include <pmatomic.h>
 #include "trivia/config.h"
 #include "tt_pthread.h"
 #include "cfg.h"
@@ -118,6 +119,8 @@ struct vy_conf {
 	uint64_t memory_limit;
 	/* read cache quota */
 	uint64_t cache;
+	/* page cache quota */
+	uint64_t page_cache;
 	/* bloom filter false positive rate */
 	double bloom_fpr;
 };
@@ -1827,6 +1830,110 @@ vy_page_index_encode(const uint32_t *page_index, uint32_t count,
 	return 0;
 }
 
+/**
+ * Bloom filters of key prefixes built while writing a run.
+ */
+struct vy_prefix_bloom_builder {
+	/** Number of prefixes, i.e. bloom_prefix_parts. */
+	uint32_t count;
+	/** Filters of prefixes of 1, 2, ..., count parts. */
+	struct bloom_spectrum *spectrums;
+	/**
+	 * Hashes of prefixes of the last added statement.
+	 * Statements are written in key order, so statements
+	 * with the same prefix go one after another and we
+	 * add each prefix only once, so as not to inflate
+	 * the number of values the filter is chosen for.
+	 */
+	uint32_t *last_hashes;
+	/** True if no statements have been added yet. */
+	bool is_empty;
+};
+
+static int
+vy_prefix_bloom_builder_create(struct vy_prefix_bloom_builder *bb,
+			       uint32_t count, size_t max_output_count,
+			       double bloom_fpr)
+{
+	bb->count = 0;
+	bb->is_empty = true;
+	bb->spectrums = NULL;
+	bb->last_hashes = NULL;
+	if (count == 0)
+		return 0;
+	bb->spectrums = calloc(count, sizeof(*bb->spectrums));
+	bb->last_hashes = calloc(count, sizeof(*bb->last_hashes));
+	if (bb->spectrums == NULL || bb->last_hashes == NULL) {
+		diag_set(OutOfMemory, count * sizeof(*bb->spectrums),
+			 "calloc", "struct bloom_spectrum");
+		goto fail;
+	}
+	for (; bb->count < count; bb->count++) {
+		if (bloom_spectrum_create(&bb->spectrums[bb->count],
+					  max_output_count, bloom_fpr,
+					  runtime.quota) != 0) {
+			diag_set(OutOfMemory, 0,
+				 "bloom_spectrum_create", "bloom_spectrum");
+			goto fail;
+		}
+	}
+	return 0;
+fail:
+	for (uint32_t i = 0; i < bb->count; i++)
+		bloom_spectrum_destroy(&bb->spectrums[i], runtime.quota);
+	free(bb->spectrums);
+	free(bb->last_hashes);
+	return -1;
+}
+
+static void
+vy_prefix_bloom_builder_destroy(struct vy_prefix_bloom_builder *bb)
+{
+	for (uint32_t i = 0; i < bb->count; i++)
+		bloom_spectrum_destroy(&bb->spectrums[i], runtime.quota);
+	free(bb->spectrums);
+	free(bb->last_hashes);
+}
+
+static void
+vy_prefix_bloom_builder_add(struct vy_prefix_bloom_builder *bb,
+			    const struct tuple *stmt,
+			    const struct key_def *user_key_def)
+{
+	for (uint32_t i = 0; i < bb->count; i++) {
+		uint32_t hash = tuple_hash_parts(stmt, user_key_def, i + 1);
+		if (!bb->is_empty && hash == bb->last_hashes[i])
+			continue;
+		bloom_spectrum_add(&bb->spectrums[i], hash);
+		bb->last_hashes[i] = hash;
+	}
+	bb->is_empty = false;
+}
+
+/**
+ * Move the chosen prefix filters to the run info.
+ * Must be called only once.
+ */
+static int
+vy_prefix_bloom_builder_choose(struct vy_prefix_bloom_builder *bb,
+			       struct vy_run_info *run_info)
+{
+	assert(run_info->prefix_blooms == NULL);
+	if (bb->count == 0)
+		return 0;
+	run_info->prefix_blooms = calloc(bb->count, sizeof(struct bloom));
+	if (run_info->prefix_blooms == NULL) {
+		diag_set(OutOfMemory, bb->count * sizeof(struct bloom),
+			 "calloc", "struct bloom");
+		return -1;
+	}
+	for (uint32_t i = 0; i < bb->count; i++)
+		bloom_spectrum_choose(&bb->spectrums[i],
+				      &run_info->prefix_blooms[i]);
+	run_info->prefix_bloom_count = bb->count;
+	return 0;
+}
+
 /**
  * Write statements from the iterator to a new page in the run,
  * update page and run statistics.
@@ -1839,6 +1946,7 @@ static int
 vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 		  struct vy_write_iterator *wi, struct tuple **curr_stmt,
 		  uint64_t page_size, struct bloom_spectrum *bs,
+		  struct vy_prefix_bloom_builder *prefix_bb,
 		  const struct key_def *key_def,
 		  const struct key_def *user_key_def, bool is_primary,
 		  uint32_t *page_info_capacity)
@@ -1902,6 +2010,7 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 				     key_def, is_primary) != 0)
 			goto error_rollback;
 		bloom_spectrum_add(bs, tuple_hash(stmt, user_key_def));
+		vy_prefix_bloom_builder_add(prefix_bb, stmt, user_key_def);
 
 		if (vy_write_iterator_next(wi, curr_stmt))
 			goto error_rollback;
@@ -1977,6 +2086,10 @@ error_page_index:
 
 /**
  * Write statements from the iterator to a new run file.
+ * If @io_rate_limit is not NULL, it points to the limit of
+ * the write rate, in bytes per second, which is re-read
+ * before writing each page and may be changed concurrently.
+ * Zero means no limit.
  *
  *  @retval 0 success
  *  @retval -1 error occurred
@@ -1986,7 +2099,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_write_iterator *wi, uint64_t page_size,
 		  const struct key_def *key_def,
 		  const struct key_def *user_key_def, bool is_primary,
-		  size_t max_output_count, double bloom_fpr)
+		  size_t max_output_count, double bloom_fpr,
+		  uint32_t bloom_prefix_parts, const uint64_t *io_rate_limit)
 {
 	struct tuple *stmt;
 
@@ -2005,6 +2119,10 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 			 "bloom_spectrum_create", "bloom_spectrum");
 		goto err;
 	}
+	struct vy_prefix_bloom_builder prefix_bb;
+	if (vy_prefix_bloom_builder_create(&prefix_bb, bloom_prefix_parts,
+					   max_output_count, bloom_fpr) != 0)
+		goto err_free_bloom;
 
 	struct vy_run_info *run_info = &run->info;
 
@@ -2017,15 +2135,20 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		.instance_uuid = INSTANCE_UUID,
 	};
 	if (xlog_create(&data_xlog, path, &meta) < 0)
-		goto err_free_bloom;
+		goto err_free_prefix_bloom;
 
 	assert(run_info->page_infos == NULL);
 	uint32_t page_infos_capacity = 0;
 	int rc;
 	do {
+		if (io_rate_limit != NULL) {
+			data_xlog.rate_limit = pm_atomic_load_explicit(
+				io_rate_limit, pm_memory_order_relaxed);
+		}
 		rc = vy_run_write_page(run_info, &data_xlog, wi, &stmt,
-				       page_size, &bs, key_def, user_key_def,
-				       is_primary, &page_infos_capacity);
+				       page_size, &bs, &prefix_bb, key_def,
+				       user_key_def, is_primary,
+				       &page_infos_capacity);
 		if (rc < 0)
 			goto err_close_xlog;
 		fiber_gc();
@@ -2040,6 +2163,9 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	xlog_close(&data_xlog, true);
 	fiber_gc();
 
+	if (vy_prefix_bloom_builder_choose(&prefix_bb, &run->info) != 0)
+		goto err_free_prefix_bloom;
+	vy_prefix_bloom_builder_destroy(&prefix_bb);
 	bloom_spectrum_choose(&bs, &run->info.bloom);
 	run->info.has_bloom = true;
 	bloom_spectrum_destroy(&bs, runtime.quota);
@@ -2050,6 +2176,8 @@ done:
 err_close_xlog:
 	xlog_close(&data_xlog, false);
 	fiber_gc();
+err_free_prefix_bloom:
+	vy_prefix_bloom_builder_destroy(&prefix_bb);
 err_free_bloom:
 	bloom_spectrum_destroy(&bs, runtime.quota);
 err:
@@ -2192,13 +2320,23 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	size_t max_key_size = tmp - run_info->max_key;
 
 	assert(run_info->has_bloom);
-	size_t size = mp_sizeof_map(4);
+	uint32_t map_size = 4;
+	if (run_info->prefix_bloom_count > 0)
+		map_size++;
+	size_t size = mp_sizeof_map(map_size);
 	size += mp_sizeof_uint(VY_RUN_INFO_MIN_KEY) + min_key_size;
 	size += mp_sizeof_uint(VY_RUN_INFO_MAX_KEY) + max_key_size;
 	size += mp_sizeof_uint(VY_RUN_INFO_PAGE_COUNT) +
 		mp_sizeof_uint(run_info->count);
 	size += mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
 		vy_run_bloom_encode_size(&run_info->bloom);
+	if (run_info->prefix_bloom_count > 0) {
+		size += mp_sizeof_uint(VY_RUN_INFO_PREFIX_BLOOMS);
+		size += mp_sizeof_array(run_info->prefix_bloom_count);
+		for (uint32_t i = 0; i < run_info->prefix_bloom_count; i++)
+			size += vy_run_bloom_encode_size(
+					&run_info->prefix_blooms[i]);
+	}
 
 	char *pos = region_alloc(&fiber()->gc, size);
 	if (pos == NULL) {
@@ -2208,7 +2346,7 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	memset(xrow, 0, sizeof(*xrow));
 	xrow->body->iov_base = pos;
 	/* encode values */
-	pos = mp_encode_map(pos, 4);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_MIN_KEY);
 	memcpy(pos, run_info->min_key, min_key_size);
 	pos += min_key_size;
@@ -2219,6 +2357,13 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->count);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
 	pos = vy_run_bloom_encode(&run_info->bloom, pos);
+	if (run_info->prefix_bloom_count > 0) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_PREFIX_BLOOMS);
+		pos = mp_encode_array(pos, run_info->prefix_bloom_count);
+		for (uint32_t i = 0; i < run_info->prefix_bloom_count; i++)
+			pos = vy_run_bloom_encode(&run_info->prefix_blooms[i],
+						  pos);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	xrow->bodycnt = 1;
 	xrow->type = VY_INDEX_RUN_INFO;
@@ -2373,6 +2518,7 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 	     const struct key_def *key_def,
 	     const struct key_def *user_key_def, bool is_primary,
 	     size_t max_output_count, double bloom_fpr,
+	     uint32_t bloom_prefix_parts, const uint64_t *io_rate_limit,
 	     size_t *written, uint64_t *dumped_statements)
 {
 	ERROR_INJECT(ERRINJ_VY_RUN_WRITE,
@@ -2381,7 +2527,8 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 
 	if (vy_run_write_data(run, dirpath, wi, page_size,
 			      key_def, user_key_def, is_primary,
-			      max_output_count, bloom_fpr) != 0)
+			      max_output_count, bloom_fpr, bloom_prefix_parts,
+			      io_rate_limit) != 0)
 		return -1;
 
 	if (vy_run_is_empty(run))
@@ -3535,6 +3682,12 @@ struct vy_task_ops {
 	 * engine destructor.
 	 */
 	void (*abort)(struct vy_task *task, bool in_shutdown);
+	/**
+	 * Set for dump tasks. Dump tasks are taken by workers
+	 * before compaction tasks and may run on workers reserved
+	 * for dumps, see vy_schedule().
+	 */
+	bool is_dump;
 };
 
 struct vy_task {
@@ -3545,8 +3698,12 @@ struct vy_task {
 	struct diag diag;
 	/** Index this task is for. */
 	struct vy_index *index;
-	/** How long ->execute took, in nanoseconds. */
-	ev_tstamp exec_time;
+	/** Time when the task was queued for a worker. */
+	double queue_time;
+	/** How long the task waited for a worker, in seconds. */
+	double wait_time;
+	/** How long ->execute took, in seconds. */
+	double exec_time;
 	/** Number of bytes written to disk by this task. */
 	size_t dump_size;
 	/** Number of statements dumped to the disk. */
@@ -3636,6 +3793,8 @@ vy_task_dump_execute(struct vy_task *task)
 			    &index->user_index_def->key_def,
 			    index->index_def->iid == 0,
 			    task->max_output_count, task->bloom_fpr,
+			    index->user_index_def->opts.bloom_prefix_parts,
+			    NULL,
 			    &task->dump_size, &task->dumped_statements);
 }
 
@@ -3798,6 +3957,7 @@ vy_task_dump_new(struct mempool *pool, struct vy_index *index,
 		.execute = vy_task_dump_execute,
 		.complete = vy_task_dump_complete,
 		.abort = vy_task_dump_abort,
+		.is_dump = true,
 	};
 
 	struct tx_manager *xm = index->env->xm;
@@ -3888,6 +4048,9 @@ err_task:
 	return -1;
 }
 
+static const uint64_t *
+vy_scheduler_compact_io_rate_limit(struct vy_scheduler *scheduler);
+
 static int
 vy_task_compact_execute(struct vy_task *task)
 {
@@ -3902,6 +4065,9 @@ vy_task_compact_execute(struct vy_task *task)
 			    &index->user_index_def->key_def,
 			    index->index_def->iid == 0,
 			    task->max_output_count, task->bloom_fpr,
+			    index->user_index_def->opts.bloom_prefix_parts,
+			    vy_scheduler_compact_io_rate_limit(
+					index->env->scheduler),
 			    &task->dump_size, &task->dumped_statements);
 }
 
@@ -4015,6 +4181,7 @@ vy_task_compact_new(struct mempool *pool, struct vy_range *range,
 		.execute = vy_task_compact_execute,
 		.complete = vy_task_compact_complete,
 		.abort = vy_task_compact_abort,
+		.is_dump = false,
 	};
 
 	struct vy_index *index = range->index;
@@ -4159,6 +4326,37 @@ struct vy_scheduler {
 	/** Number worker threads that are currently idle. */
 	int workers_available;
 	bool is_worker_pool_running;
+	/**
+	 * Number of worker threads reserved for dumps: compaction
+	 * never occupies more than worker_pool_size - dump_threads
+	 * workers, so that a dump can start as soon as it's needed.
+	 * Set by box.cfg.vinyl_dump_threads.
+	 */
+	int dump_threads;
+	/** Number of dump tasks queued or being executed. */
+	int dump_task_count;
+	/** Number of compaction tasks queued or being executed. */
+	int compact_task_count;
+	/**
+	 * Limit of the disk write rate of compaction while a dump
+	 * is in progress, in bytes per second, 0 if unlimited.
+	 * Set by box.cfg.vinyl_compact_io_rate_limit.
+	 */
+	uint64_t compact_rate_limit;
+	/**
+	 * The write rate limit in effect for compaction tasks:
+	 * compact_rate_limit if a dump is in progress, 0 otherwise.
+	 * Read by worker threads.
+	 */
+	uint64_t compact_io_rate_limit;
+	/** Time dump tasks waited for a worker. */
+	struct vy_latency dump_wait;
+	/** Time dump tasks took to execute. */
+	struct vy_latency dump_time;
+	/** Time compaction tasks waited for a worker. */
+	struct vy_latency compact_wait;
+	/** Time compaction tasks took to execute. */
+	struct vy_latency compact_time;
 
 	/**
 	 * There is a pending task for workers in the pool,
@@ -4176,10 +4374,12 @@ struct vy_scheduler {
 	/** Used for throttling tx when quota is full. */
 	struct ipc_cond quota_cond;
 	/**
-	 * A queue with all vy_task objects created by the
-	 * scheduler and not yet taken by a worker.
+	 * Queues of dump and compaction tasks created by the
+	 * scheduler and not yet taken by a worker. Workers
+	 * drain the dump queue first.
 	 */
-	struct stailq input_queue;
+	struct stailq dump_queue;
+	struct stailq compact_queue;
 	/**
 	 * A queue of processed vy_tasks objects.
 	 */
@@ -4284,6 +4484,9 @@ vy_scheduler_new(struct vy_env *env)
 	scheduler->checkpoint_lsn = -1;
 	ipc_cond_create(&scheduler->checkpoint_cond);
 	scheduler->env = env;
+	scheduler->dump_threads = cfg_geti("vinyl_dump_threads");
+	scheduler->compact_rate_limit =
+		cfg_getd("vinyl_compact_io_rate_limit") * 1024 * 1024;
 	vy_compact_heap_create(&scheduler->compact_heap);
 	vy_dump_heap_create(&scheduler->dump_heap);
 	tt_pthread_cond_init(&scheduler->worker_cond, NULL);
@@ -4324,6 +4527,25 @@ vy_scheduler_delete(struct vy_scheduler *scheduler)
 	free(scheduler);
 }
 
+static const uint64_t *
+vy_scheduler_compact_io_rate_limit(struct vy_scheduler *scheduler)
+{
+	return &scheduler->compact_io_rate_limit;
+}
+
+/**
+ * Throttle compaction while a dump is in progress, so that
+ * the dump gets the most of the disk bandwidth.
+ */
+static void
+vy_scheduler_update_compact_io_rate_limit(struct vy_scheduler *scheduler)
+{
+	uint64_t limit = scheduler->dump_task_count > 0 ?
+			 scheduler->compact_rate_limit : 0;
+	pm_atomic_store_explicit(&scheduler->compact_io_rate_limit, limit,
+				 pm_memory_order_relaxed);
+}
+
 static void
 vy_scheduler_add_index(struct vy_scheduler *scheduler,
 		       struct vy_index *index)
@@ -4469,14 +4691,15 @@ vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask)
 	if (*ptask != NULL)
 		return 0;
 
-	if (scheduler->workers_available <= 1) {
+	if (scheduler->compact_task_count >=
+	    scheduler->worker_pool_size - scheduler->dump_threads) {
 		/*
 		 * If all worker threads are busy doing compaction
 		 * when we run out of quota, ongoing transactions will
 		 * hang until one of the threads has finished, which
 		 * may take quite a while. To avoid unpredictably long
-		 * stalls, always keep one worker thread reserved for
-		 * dumps.
+		 * stalls, always keep dump_threads worker threads
+		 * reserved for dumps.
 		 */
 		return 0;
 	}
@@ -4586,11 +4809,25 @@ vy_scheduler_f(va_list va)
 				vy_stat_dump(env->stat, task->exec_time,
 					     task->dump_size,
 					     task->dumped_statements);
+			if (task->ops->is_dump) {
+				vy_latency_update(&scheduler->dump_wait,
+						  task->wait_time);
+				vy_latency_update(&scheduler->dump_time,
+						  task->exec_time);
+				scheduler->dump_task_count--;
+			} else {
+				vy_latency_update(&scheduler->compact_wait,
+						  task->wait_time);
+				vy_latency_update(&scheduler->compact_time,
+						  task->exec_time);
+				scheduler->compact_task_count--;
+			}
 			vy_task_delete(&scheduler->task_pool, task);
 			scheduler->workers_available++;
 			assert(scheduler->workers_available <=
 			       scheduler->worker_pool_size);
 		}
+		vy_scheduler_update_compact_io_rate_limit(scheduler);
 		/*
 		 * Reset the timeout if we managed to successfully
 		 * complete at least one task.
@@ -4621,9 +4858,19 @@ vy_scheduler_f(va_list va)
 			goto wait;
 
 		/* Queue the task and notify workers if necessary. */
+		if (task->ops->is_dump) {
+			scheduler->dump_task_count++;
+			vy_scheduler_update_compact_io_rate_limit(scheduler);
+		} else {
+			scheduler->compact_task_count++;
+		}
+		task->queue_time = clock_monotonic();
 		tt_pthread_mutex_lock(&scheduler->mutex);
-		was_empty = stailq_empty(&scheduler->input_queue);
-		stailq_add_tail_entry(&scheduler->input_queue, task, link);
+		was_empty = stailq_empty(&scheduler->dump_queue) &&
+			    stailq_empty(&scheduler->compact_queue);
+		stailq_add_tail_entry(task->ops->is_dump ?
+				      &scheduler->dump_queue :
+				      &scheduler->compact_queue, task, link);
 		if (was_empty)
 			tt_pthread_cond_signal(&scheduler->worker_cond);
 		tt_pthread_mutex_unlock(&scheduler->mutex);
@@ -4673,8 +4920,12 @@ vy_worker_f(va_list va)
 
 	tt_pthread_mutex_lock(&scheduler->mutex);
 	while (scheduler->is_worker_pool_running) {
+		/* Dumps go first, see vy_schedule(). */
+		struct stailq *queue = &scheduler->dump_queue;
+		if (stailq_empty(queue))
+			queue = &scheduler->compact_queue;
 		/* Wait for a task */
-		if (stailq_empty(&scheduler->input_queue)) {
+		if (stailq_empty(queue)) {
 			/* Wake scheduler up if there are no more tasks */
 			ev_async_send(scheduler->loop,
 				      &scheduler->scheduler_async);
@@ -4682,15 +4933,15 @@ vy_worker_f(va_list va)
 					     &scheduler->mutex);
 			continue;
 		}
-		task = stailq_shift_entry(&scheduler->input_queue,
-					  struct vy_task, link);
+		task = stailq_shift_entry(queue, struct vy_task, link);
 		tt_pthread_mutex_unlock(&scheduler->mutex);
 		assert(task != NULL);
 
 		/* Execute task */
-		uint64_t start = ev_now(loop());
+		double start = clock_monotonic();
+		task->wait_time = start - task->queue_time;
 		task->status = task->ops->execute(task);
-		task->exec_time = ev_now(loop()) - start;
+		task->exec_time = clock_monotonic() - start;
 		if (task->status != 0) {
 			struct diag *diag = diag_get();
 			assert(!diag_is_empty(diag));
@@ -4716,7 +4967,8 @@ vy_scheduler_start_workers(struct vy_scheduler *scheduler)
 	/* One thread is reserved for dumps, see vy_schedule(). */
 	assert(scheduler->worker_pool_size >= 2);
 	scheduler->workers_available = scheduler->worker_pool_size;
-	stailq_create(&scheduler->input_queue);
+	stailq_create(&scheduler->dump_queue);
+	stailq_create(&scheduler->compact_queue);
 	stailq_create(&scheduler->output_queue);
 	scheduler->worker_pool = (struct cord *)
 		calloc(scheduler->worker_pool_size, sizeof(struct cord));
@@ -4740,7 +4992,8 @@ vy_scheduler_stop_workers(struct vy_scheduler *scheduler)
 
 	/* Clear the input queue and wake up worker threads. */
 	tt_pthread_mutex_lock(&scheduler->mutex);
-	stailq_concat(&task_queue, &scheduler->input_queue);
+	stailq_concat(&task_queue, &scheduler->dump_queue);
+	stailq_concat(&task_queue, &scheduler->compact_queue);
 	pthread_cond_broadcast(&scheduler->worker_cond);
 	tt_pthread_mutex_unlock(&scheduler->mutex);
 
@@ -4926,6 +5179,7 @@ vy_conf_new()
 	}
 	conf->memory_limit = cfg_getd("vinyl_memory");
 	conf->cache = cfg_getd("vinyl_cache");
+	conf->page_cache = cfg_getd("vinyl_page_cache");
 	conf->bloom_fpr = cfg_getd("vinyl_bloom_fpr");
 
 	conf->path = strdup(cfg_gets("vinyl_dir"));
@@ -5041,6 +5295,14 @@ vy_info_append_performance(struct vy_env *env, struct info_handler *h)
 	info_append_u64(h, "used", ce->quota.used);
 	info_table_end(h);
 
+	struct vy_page_cache *pc = &env->run_env.page_cache;
+	info_table_begin(h, "page_cache");
+	info_append_u64(h, "count", pc->count);
+	info_append_u64(h, "used", pc->quota.used);
+	info_append_u64(h, "hit", pc->hit);
+	info_append_u64(h, "miss", pc->miss);
+	info_table_end(h);
+
 	info_table_begin(h, "iterator");
 	vy_info_append_iterator_stat(h, "txw", &stat->txw_stat);
 	vy_info_append_iterator_stat(h, "cache", &stat->cache_stat);
@@ -5051,12 +5313,44 @@ vy_info_append_performance(struct vy_env *env, struct info_handler *h)
 	info_table_end(h);
 }
 
+static void
+vy_info_append_scheduler(struct vy_env *env, struct info_handler *h)
+{
+	struct vy_scheduler *scheduler = env->scheduler;
+	struct vy_task *task;
+	uint32_t dump_queue = 0, compact_queue = 0;
+	tt_pthread_mutex_lock(&scheduler->mutex);
+	if (scheduler->is_worker_pool_running) {
+		stailq_foreach_entry(task, &scheduler->dump_queue, link)
+			dump_queue++;
+		stailq_foreach_entry(task, &scheduler->compact_queue, link)
+			compact_queue++;
+	}
+	tt_pthread_mutex_unlock(&scheduler->mutex);
+
+	info_table_begin(h, "scheduler");
+	info_append_u32(h, "workers", scheduler->worker_pool_size);
+	info_append_u32(h, "dump_threads", scheduler->dump_threads);
+	info_append_u32(h, "dump_queue", dump_queue);
+	info_append_u32(h, "dump_tasks", scheduler->dump_task_count);
+	vy_info_append_stat_latency(h, "dump_wait", &scheduler->dump_wait);
+	vy_info_append_stat_latency(h, "dump_time", &scheduler->dump_time);
+	info_append_u32(h, "compact_queue", compact_queue);
+	info_append_u32(h, "compact_tasks", scheduler->compact_task_count);
+	vy_info_append_stat_latency(h, "compact_wait",
+				    &scheduler->compact_wait);
+	vy_info_append_stat_latency(h, "compact_time",
+				    &scheduler->compact_time);
+	info_table_end(h);
+}
+
 void
 vy_info(struct vy_env *env, struct info_handler *h)
 {
 	info_begin(h);
 	vy_info_append_memory(env, h);
 	vy_info_append_performance(env, h);
+	vy_info_append_scheduler(env, h);
 	info_append_u64(h, "lsn", env->xm->lsn);
 	info_end(h);
 }
@@ -7153,6 +7447,114 @@ vy_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 }
 
 
+enum {
+	/**
+	 * Max number of fibers looking up keys on behalf
+	 * of a vy_get_many() call, besides the caller.
+	 */
+	VY_GET_MANY_FIBERS = 16,
+};
+
+/** State of a vy_get_many() call shared by its fibers. */
+struct vy_get_many_ctx {
+	struct vy_tx *tx;
+	struct vy_index *index;
+	const char **keys;
+	struct tuple **result;
+	uint32_t count;
+	/** The next key to look up. */
+	uint32_t next;
+	/** Set if a lookup failed, stops the others. */
+	bool is_failed;
+};
+
+/** Look up the keys of a vy_get_many() call until none is left. */
+static int
+vy_get_many_next(struct vy_get_many_ctx *ctx)
+{
+	while (ctx->next < ctx->count && !ctx->is_failed) {
+		/* A conflicting write could abort the tx on yield. */
+		if (ctx->tx != NULL && ctx->tx->state != VINYL_TX_READY) {
+			diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+			goto fail;
+		}
+		uint32_t i = ctx->next++;
+		const char *key = ctx->keys[i];
+		uint32_t part_count = mp_decode_array(&key);
+		struct tuple *tuple = NULL;
+		if (vy_get(ctx->tx, ctx->index, key, part_count, &tuple) != 0)
+			goto fail;
+		ctx->result[i] = tuple;
+	}
+	return 0;
+fail:
+	ctx->is_failed = true;
+	return -1;
+}
+
+static int
+vy_get_many_f(va_list ap)
+{
+	struct vy_get_many_ctx *ctx = va_arg(ap, struct vy_get_many_ctx *);
+	return vy_get_many_next(ctx);
+}
+
+int
+vy_get_many(struct vy_tx *tx, struct vy_index *index, const char **keys,
+	    uint32_t count, struct tuple **result)
+{
+	struct vy_get_many_ctx ctx;
+	ctx.tx = tx;
+	ctx.index = index;
+	ctx.keys = keys;
+	ctx.result = result;
+	ctx.count = count;
+	ctx.next = 0;
+	ctx.is_failed = false;
+	/*
+	 * A fiber takes keys until it has to wait for a disk
+	 * read, then the next fiber is started, so that page
+	 * reads of different keys are done by coeio threads in
+	 * parallel. Keys found in memory or rejected by bloom
+	 * filters never yield and are served by a single fiber.
+	 * Pages needed by several keys are read once, see
+	 * vy_run_iterator_load_page().
+	 */
+	struct fiber *workers[VY_GET_MANY_FIBERS];
+	int worker_count = 0;
+	while (worker_count < VY_GET_MANY_FIBERS &&
+	       ctx.next < ctx.count && !ctx.is_failed) {
+		struct fiber *f = fiber_new("vinyl.get_many", vy_get_many_f);
+		if (f == NULL) {
+			/* Go on with the fibers we have. */
+			diag_clear(diag_get());
+			break;
+		}
+		fiber_set_joinable(f, true);
+		fiber_start(f, &ctx);
+		workers[worker_count++] = f;
+	}
+	int rc = vy_get_many_next(&ctx);
+	/*
+	 * fiber_join() moves the error of a failed fiber to
+	 * the caller's diag, so keep the first error aside.
+	 */
+	struct diag first_error;
+	diag_create(&first_error);
+	if (rc != 0)
+		diag_move(diag_get(), &first_error);
+	for (int i = 0; i < worker_count; i++) {
+		if (fiber_join(workers[i]) != 0 && rc == 0) {
+			rc = -1;
+			diag_move(diag_get(), &first_error);
+		}
+	}
+	if (rc != 0)
+		diag_move(&first_error, diag_get());
+	diag_destroy(&first_error);
+	return rc;
+}
+
 /** {{{ Environment */
 
 static void
@@ -7182,6 +7584,24 @@ vy_squash_queue_new(void);
 static void
 vy_squash_queue_delete(struct vy_squash_queue *q);
 
+void
+vy_set_dump_threads(struct vy_env *env, int dump_threads)
+{
+	struct vy_scheduler *scheduler = env->scheduler;
+	scheduler->dump_threads = dump_threads;
+	/* Let the scheduler start compaction on released workers. */
+	if (scheduler->is_worker_pool_running)
+		ipc_cond_signal(&scheduler->scheduler_cond);
+}
+
+void
+vy_set_compact_io_rate_limit(struct vy_env *env, double limit)
+{
+	struct vy_scheduler *scheduler = env->scheduler;
+	scheduler->compact_rate_limit = limit * 1024 * 1024;
+	vy_scheduler_update_compact_io_rate_limit(scheduler);
+}
+
 struct vy_env *
 vy_env_new(void)
 {
@@ -7225,7 +7645,7 @@ vy_env_new(void)
 	ev_timer_start(loop(), &e->quota_timer);
 	vy_cache_env_create(&e->cache_env, slab_cache,
 			    e->conf->cache);
-	vy_run_env_create(&e->run_env);
+	vy_run_env_create(&e->run_env, e->conf->page_cache);
 	vy_log_init(e->conf->path);
 	return e;
 error_key_format:
@@ -64,6 +64,21 @@ vy_env_new(void);
 void
 vy_env_delete(struct vy_env *e);
 
+/**
+ * Set the number of worker threads reserved for dumps
+ * (box.cfg.vinyl_dump_threads).
+ */
+void
+vy_set_dump_threads(struct vy_env *env, int dump_threads);
+
+/**
+ * Set the limit of the compaction write rate applied while
+ * a dump is in progress, in megabytes per second, 0 for no
+ * limit (box.cfg.vinyl_compact_io_rate_limit).
+ */
+void
+vy_set_compact_io_rate_limit(struct vy_env *env, double limit);
+
 /*
  * Recovery
  */
@@ -136,6 +151,25 @@ int
 vy_get(struct vy_tx *tx, struct vy_index *index,
        const char *key, uint32_t part_count, struct tuple **result);
 
+/**
+ * Get tuples from the vinyl index by several keys. The keys
+ * are looked up concurrently.
+ * @param tx          Current transaction.
+ * @param index       Vinyl index.
+ * @param keys        MessagePack'ed keys, each is an array with
+ *                    a header.
+ * @param count       The number of keys.
+ * @param[out] result result[i] is set to the tuple found by
+ *                    keys[i], left intact if none is found.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or read error. Some of the tuples may be
+ *            found anyway.
+ */
+int
+vy_get_many(struct vy_tx *tx, struct vy_index *index, const char **keys,
+	    uint32_t count, struct tuple **result);
+
 /**
  * Execute REPLACE in a vinyl space.
  * @param tx      Current transaction.
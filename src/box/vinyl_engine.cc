@@ -170,6 +170,13 @@ VinylEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 		          index_def->name,
 		          space_name(space));
 	}
+	if (index_def->opts.bloom_prefix_parts >=
+	    index_def->key_def.part_count) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name, space_name(space),
+			  "bloom_prefix_parts must be less than "
+			  "the number of key parts");
+	}
 }
 
 void
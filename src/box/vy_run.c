@@ -35,6 +35,7 @@
 #include "xlog.h"
 #include "fio.h"
 #include "memory.h"
+#include "ipc.h"
 
 /**
  * coio task for vinyl page read
@@ -52,8 +53,145 @@ struct vy_page_read_task {
 	struct vy_page *page;
 	/** [out] result code */
 	int rc;
+	/** Number of the page to read */
+	uint32_t page_no;
+	/** Set if the task is linked in vy_page_cache::reads */
+	bool is_shared;
+	/** Link in vy_page_cache::reads */
+	struct rlist in_reads;
+	/** Signaled when the read is complete */
+	struct ipc_cond done;
 };
 
+/* {{{ vy_page_cache */
+
+/** Memory accounted to a cached page. */
+static inline size_t
+vy_page_mem_used(struct vy_page *page)
+{
+	return sizeof(*page) + page->unpacked_size +
+	       page->count * sizeof(*page->page_index);
+}
+
+/**
+ * Remove a page from the page cache and drop the reference
+ * of the cache to it.
+ */
+static void
+vy_page_cache_evict(struct vy_page_cache *cache, struct vy_page *page)
+{
+	assert(page->run != NULL);
+	assert(page->run->cached_pages[page->page_no] == page);
+	page->run->cached_pages[page->page_no] = NULL;
+	page->run = NULL;
+	rlist_del_entry(page, in_lru);
+	vy_quota_release(&cache->quota, vy_page_mem_used(page));
+	cache->count--;
+	vy_page_unref(page);
+}
+
+/**
+ * Look up a page of a run in the page cache.
+ * @retval page if found, the caller must reference it
+ * @retval NULL otherwise
+ */
+static struct vy_page *
+vy_page_cache_get(struct vy_page_cache *cache, struct vy_run *run,
+		  uint32_t page_no)
+{
+	struct vy_page *page = run->cached_pages != NULL ?
+			       run->cached_pages[page_no] : NULL;
+	if (page == NULL) {
+		cache->miss++;
+		return NULL;
+	}
+	cache->hit++;
+	rlist_move_entry(&cache->lru, page, in_lru);
+	return page;
+}
+
+/**
+ * Put a page read from a run to the page cache and evict
+ * the least recently used pages if the cache is over quota.
+ */
+static void
+vy_page_cache_put(struct vy_page_cache *cache, struct vy_run *run,
+		  struct vy_page *page)
+{
+	assert(page->run == NULL);
+	if (cache->quota.limit == 0)
+		return;
+	if (run->cached_pages == NULL) {
+		run->cached_pages = calloc(run->info.count,
+					   sizeof(*run->cached_pages));
+		/* The cache is an optimization, ignore errors. */
+		if (run->cached_pages == NULL)
+			return;
+		run->page_cache = cache;
+	}
+	assert(run->page_cache == cache);
+	if (run->cached_pages[page->page_no] != NULL)
+		return;
+	run->cached_pages[page->page_no] = page;
+	page->run = run;
+	page->refs++;
+	rlist_add_entry(&cache->lru, page, in_lru);
+	vy_quota_force_use(&cache->quota, vy_page_mem_used(page));
+	cache->count++;
+	while (vy_quota_is_exceeded(&cache->quota)) {
+		struct vy_page *victim = rlist_last_entry(&cache->lru,
+							  struct vy_page,
+							  in_lru);
+		vy_page_cache_evict(cache, victim);
+	}
+}
+
+/**
+ * Find a read of a page of a run in progress.
+ */
+static struct vy_page_read_task *
+vy_page_cache_find_read(struct vy_page_cache *cache, struct vy_run *run,
+			uint32_t page_no)
+{
+	struct vy_page_read_task *task;
+	rlist_foreach_entry(task, &cache->reads, in_reads) {
+		if (task->slice->run == run && task->page_no == page_no)
+			return task;
+	}
+	return NULL;
+}
+
+/**
+ * Let other fibers wait for the page read by the task
+ * instead of reading it once again.
+ */
+static void
+vy_page_cache_add_read(struct vy_page_cache *cache,
+		       struct vy_page_read_task *task)
+{
+	rlist_add_entry(&cache->reads, task, in_reads);
+	ipc_cond_create(&task->done);
+	task->is_shared = true;
+}
+
+/**
+ * Unlink a complete page read and wake up the fibers waiting
+ * for it. Must be called after the read page is put to the
+ * cache, if it is going to be.
+ */
+static void
+vy_page_cache_end_read(struct vy_page_read_task *task)
+{
+	if (!task->is_shared)
+		return;
+	rlist_del_entry(task, in_reads);
+	ipc_cond_broadcast(&task->done);
+	ipc_cond_destroy(&task->done);
+	task->is_shared = false;
+}
+
+/* }}} vy_page_cache */
+
 /** Destructor for env->zdctx_key thread-local variable */
 static void
 vy_free_zdctx(void *arg)
@@ -66,13 +204,22 @@ vy_free_zdctx(void *arg)
  * Initialize vinyl run environment
  */
 void
-vy_run_env_create(struct vy_run_env *env)
+vy_run_env_create(struct vy_run_env *env, uint64_t page_cache_quota)
 {
 	tt_pthread_key_create(&env->zdctx_key, vy_free_zdctx);
 
 	struct slab_cache *slab_cache = cord_slab_cache();
 	mempool_create(&env->read_task_pool, slab_cache,
 		       sizeof(struct vy_page_read_task));
+
+	struct vy_page_cache *cache = &env->page_cache;
+	rlist_create(&cache->lru);
+	vy_quota_init(&cache->quota, NULL, NULL);
+	vy_quota_set_limit(&cache->quota, page_cache_quota);
+	cache->count = 0;
+	cache->hit = 0;
+	cache->miss = 0;
+	rlist_create(&cache->reads);
 }
 
 /**
@@ -81,6 +228,12 @@ vy_run_env_create(struct vy_run_env *env)
 void
 vy_run_env_destroy(struct vy_run_env *env)
 {
+	struct vy_page_cache *cache = &env->page_cache;
+	while (!rlist_empty(&cache->lru)) {
+		vy_page_cache_evict(cache, rlist_first_entry(&cache->lru,
+							     struct vy_page,
+							     in_lru));
+	}
 	mempool_destroy(&env->read_task_pool);
 	tt_pthread_key_delete(env->zdctx_key);
 }
@@ -133,6 +286,8 @@ vy_run_new(int64_t id)
 	run->fd = -1;
 	run->refs = 1;
 	run->slice_count = 0;
+	run->cached_pages = NULL;
+	run->page_cache = NULL;
 	TRASH(&run->info.bloom);
 	run->info.has_bloom = false;
 	return run;
@@ -145,6 +300,14 @@ vy_run_delete(struct vy_run *run)
 	assert(run->slice_count == 0);
 	if (run->fd >= 0 && close(run->fd) < 0)
 		say_syserror("close failed");
+	if (run->cached_pages != NULL) {
+		for (uint32_t page_no = 0; page_no < run->info.count; ++page_no) {
+			struct vy_page *page = run->cached_pages[page_no];
+			if (page != NULL)
+				vy_page_cache_evict(run->page_cache, page);
+		}
+		free(run->cached_pages);
+	}
 	if (run->info.page_infos != NULL) {
 		uint32_t page_no;
 		for (page_no = 0; page_no < run->info.count; ++page_no)
@@ -153,6 +316,9 @@ vy_run_delete(struct vy_run *run)
 	}
 	if (run->info.has_bloom)
 		bloom_destroy(&run->info.bloom, runtime.quota);
+	for (uint32_t i = 0; i < run->info.prefix_bloom_count; i++)
+		bloom_destroy(&run->info.prefix_blooms[i], runtime.quota);
+	free(run->info.prefix_blooms);
 	free(run->info.min_key);
 	free(run->info.max_key);
 	TRASH(run);
@@ -399,6 +565,37 @@ vy_run_bloom_decode(struct bloom *bloom, const char **buffer,
 	return 0;
 }
 
+/**
+ * Read prefix bloom filters from given buffer.
+ * @param run_info - run info to store the filters in.
+ * @param buffer[in/out] - a buffer to read from.
+ *  The pointer is incremented on the number of bytes read.
+ * @param filename Filename for error reporting.
+ * @return - 0 on success or -1 on format/memory error
+ */
+static int
+vy_run_prefix_blooms_decode(struct vy_run_info *run_info,
+			    const char **buffer, const char *filename)
+{
+	assert(run_info->prefix_blooms == NULL);
+	uint32_t count = mp_decode_array(buffer);
+	if (count == 0)
+		return 0;
+	run_info->prefix_blooms = calloc(count, sizeof(struct bloom));
+	if (run_info->prefix_blooms == NULL) {
+		diag_set(OutOfMemory, count * sizeof(struct bloom),
+			 "calloc", "struct bloom");
+		return -1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (vy_run_bloom_decode(&run_info->prefix_blooms[i],
+					buffer, filename) != 0)
+			return -1;
+		run_info->prefix_bloom_count++;
+	}
+	return 0;
+}
+
 /**
  * Decode the run metadata from xrow.
  *
@@ -451,6 +648,11 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			else
 				return -1;
 			break;
+		case VY_RUN_INFO_PREFIX_BLOOMS:
+			if (vy_run_prefix_blooms_decode(run_info, &pos,
+							filename) != 0)
+				return -1;
+			break;
 		default:
 			diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
 				"Can't decode run info: unknown key %u",
@@ -478,6 +680,8 @@ vy_page_new(const struct vy_page_info *page_info)
 			 "load_page", "page cache");
 		return NULL;
 	}
+	page->refs = 1;
+	page->run = NULL;
 	page->count = page_info->count;
 	page->unpacked_size = page_info->unpacked_size;
 	page->page_index = calloc(page_info->count, sizeof(uint32_t));
@@ -514,6 +718,14 @@ vy_page_delete(struct vy_page *page)
 	free(page);
 }
 
+void
+vy_page_unref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	if (--page->refs == 0)
+		vy_page_delete(page);
+}
+
 int
 vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	     struct xrow_header *xrow)
@@ -597,7 +809,7 @@ vy_run_iterator_cache_put(struct vy_run_iterator *itr, struct vy_page *page,
 			  uint32_t page_no)
 {
 	if (itr->prev_page != NULL)
-		vy_page_delete(itr->prev_page);
+		vy_page_unref(itr->prev_page);
 	itr->prev_page = itr->curr_page;
 	itr->curr_page = page;
 	page->page_no = page_no;
@@ -615,9 +827,9 @@ vy_run_iterator_cache_clean(struct vy_run_iterator *itr)
 		itr->curr_stmt_pos.page_no = UINT32_MAX;
 	}
 	if (itr->curr_page != NULL) {
-		vy_page_delete(itr->curr_page);
+		vy_page_unref(itr->curr_page);
 		if (itr->prev_page != NULL)
-			vy_page_delete(itr->prev_page);
+			vy_page_unref(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
 }
@@ -760,6 +972,7 @@ static int
 vy_page_read_cb_free(struct coio_task *base)
 {
 	struct vy_page_read_task *task = (struct vy_page_read_task *)base;
+	vy_page_cache_end_read(task);
 	vy_page_delete(task->page);
 	vy_slice_unref(task->slice);
 	coio_task_destroy(&task->base);
@@ -785,6 +998,39 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	if (*result != NULL)
 		return 0;
 
+	/*
+	 * Check the page cache. It is shared by iterators of
+	 * the tx thread, which are the ones using coio.
+	 */
+	struct vy_page_cache *page_cache = &itr->run_env->page_cache;
+	if (itr->coio_read) {
+		struct vy_page *page;
+		while ((page = vy_page_cache_get(page_cache, slice->run,
+						 page_no)) == NULL) {
+			/*
+			 * If another fiber is reading the page, wait
+			 * for it to put the page to the cache.
+			 */
+			struct vy_page_read_task *read =
+				vy_page_cache_find_read(page_cache,
+							slice->run, page_no);
+			if (read == NULL)
+				break;
+			vy_slice_ref(slice);
+			ipc_cond_wait(&read->done);
+			if (vy_slice_unref(slice)) {
+				itr->slice = NULL;
+				return -2;
+			}
+		}
+		if (page != NULL) {
+			page->refs++;
+			vy_run_iterator_cache_put(itr, page, page_no);
+			*result = page;
+			return 0;
+		}
+	}
+
 	/* Allocate buffers */
 	struct vy_page_info *page_info = vy_run_page_info(slice->run, page_no);
 	struct vy_page *page = vy_page_new(page_info);
@@ -793,6 +1039,7 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 
 	/* Read page data from the disk */
 	int rc;
+	struct vy_page_read_task *task = NULL;
 	if (itr->coio_read) {
 		/*
 		 * Use coeio for TX thread **after recovery**.
@@ -802,8 +1049,7 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		 */
 
 		/* Allocate a coio task */
-		struct vy_page_read_task *task =
-			(struct vy_page_read_task *)mempool_alloc(&itr->run_env->read_task_pool);
+		task = (struct vy_page_read_task *)mempool_alloc(&itr->run_env->read_task_pool);
 		if (task == NULL) {
 			diag_set(OutOfMemory, sizeof(*task), "malloc",
 				 "vy_page_read_task");
@@ -823,6 +1069,10 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		task->page_info = *page_info;
 		task->run_env = itr->run_env;
 		task->page = page;
+		task->page_no = page_no;
+		task->is_shared = false;
+		if (page_cache->quota.limit != 0)
+			vy_page_cache_add_read(page_cache, task);
 
 		/* Post task to coeio */
 		rc = coio_task_post(&task->base, TIMEOUT_INFINITY);
@@ -836,14 +1086,14 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 			return -1;
 		}
 
-		coio_task_destroy(&task->base);
-		mempool_free(&task->run_env->read_task_pool, task);
-
 		if (vy_slice_unref(slice)) {
 			/*
 			 * The run's gone so the iterator isn't
 			 * valid anymore.
 			 */
+			vy_page_cache_end_read(task);
+			coio_task_destroy(&task->base);
+			mempool_free(&task->run_env->read_task_pool, task);
 			itr->slice = NULL;
 			vy_page_delete(page);
 			return -2;
@@ -869,6 +1119,18 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 
 	/* Update cache */
 	vy_run_iterator_cache_put(itr, page, page_no);
+	if (itr->coio_read)
+		vy_page_cache_put(page_cache, slice->run, page);
+
+	if (task != NULL) {
+		/*
+		 * The page is in the cache now, wake up the
+		 * fibers waiting for it.
+		 */
+		vy_page_cache_end_read(task);
+		coio_task_destroy(&task->base);
+		mempool_free(&task->run_env->read_task_pool, task);
+	}
 
 	*result = page;
 	return 0;
@@ -1165,6 +1427,46 @@ vy_run_iterator_find_lsn(struct vy_run_iterator *itr, struct tuple **ret)
 	return 0;
 }
 
+/**
+ * Check bloom filters of a run to find out if the run may
+ * contain statements equal to a key. A full key is looked up
+ * in the bloom filter of the run, a partial key in the filter
+ * of the key prefix of the same length, if the run has one.
+ * @retval false if the run definitely has no matching statements
+ * @retval true otherwise
+ */
+static bool
+vy_run_bloom_possible_has(const struct vy_run_info *run_info,
+			  const struct tuple *key,
+			  const struct key_def *user_key_def)
+{
+	uint32_t part_count = tuple_field_count(key);
+	bool is_select = vy_stmt_type(key) == IPROTO_SELECT;
+	const char *data = NULL;
+	if (is_select) {
+		data = tuple_data(key);
+		mp_decode_array(&data);
+	}
+	uint32_t hash;
+	const struct bloom *bloom;
+	if (part_count >= user_key_def->part_count) {
+		if (!run_info->has_bloom)
+			return true;
+		bloom = &run_info->bloom;
+		hash = is_select ? key_hash(data, user_key_def) :
+				   tuple_hash(key, user_key_def);
+	} else if (part_count > 0 &&
+		   part_count <= run_info->prefix_bloom_count) {
+		bloom = &run_info->prefix_blooms[part_count - 1];
+		hash = is_select ?
+		       key_hash_parts(data, user_key_def, part_count) :
+		       tuple_hash_parts(key, user_key_def, part_count);
+	} else {
+		return true;
+	}
+	return bloom_possible_has(bloom, hash);
+}
+
 /*
  * FIXME: vy_run_iterator_next_key() calls vy_run_iterator_start() which
  * recursivly calls vy_run_iterator_next_key().
@@ -1188,22 +1490,12 @@ vy_run_iterator_do_start(struct vy_run_iterator *itr, struct tuple **ret)
 	itr->search_started = true;
 	*ret = NULL;
 
-	const struct key_def *user_key_def = itr->user_key_def;
-	if (run->info.has_bloom && itr->iterator_type == ITER_EQ &&
-	    tuple_field_count(itr->key) >= user_key_def->part_count) {
-		uint32_t hash;
-		if (vy_stmt_type(itr->key) == IPROTO_SELECT) {
-			const char *data = tuple_data(itr->key);
-			mp_decode_array(&data);
-			hash = key_hash(data, user_key_def);
-		} else {
-			hash = tuple_hash(itr->key, user_key_def);
-		}
-		if (!bloom_possible_has(&run->info.bloom, hash)) {
-			itr->search_ended = true;
-			itr->stat->bloom_reflections++;
-			return 0;
-		}
+	if (itr->iterator_type == ITER_EQ &&
+	    !vy_run_bloom_possible_has(&run->info, itr->key,
+				       itr->user_key_def)) {
+		itr->search_ended = true;
+		itr->stat->bloom_reflections++;
+		return 0;
 	}
 
 	itr->stat->lookup_count++;
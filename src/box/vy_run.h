@@ -37,8 +37,10 @@
 #include "index.h" /* enum iterator_type */
 #include "vy_stmt.h" /* for comparators */
 #include "vy_stmt_iterator.h" /* struct vy_stmt_iterator */
+#include "vy_quota.h"
 
 #include "small/mempool.h"
+#include "small/rlist.h"
 #include "salad/bloom.h"
 #include "zstd.h"
 
@@ -65,12 +67,38 @@ enum { VY_BLOOM_VERSION = 0 };
 /** xlog meta type for .index files */
 #define XLOG_META_TYPE_INDEX "INDEX"
 
+/**
+ * Cache of decompressed pages shared by all run iterators
+ * of the tx thread. Pages are looked up by run and page
+ * number and evicted in LRU order.
+ */
+struct vy_page_cache {
+	/** Common LRU list of cached pages. The first element is the newest */
+	struct rlist lru;
+	/** Memory used by cached pages */
+	struct vy_quota quota;
+	/** Number of cached pages */
+	size_t count;
+	/** Number of page lookups which found the page in the cache */
+	uint64_t hit;
+	/** Number of page lookups which had to read the page */
+	uint64_t miss;
+	/**
+	 * Page reads in progress, linked by
+	 * vy_page_read_task::in_reads. A fiber which needs a
+	 * page being read waits for the read to complete.
+	 */
+	struct rlist reads;
+};
+
 /** Part of vinyl environment for run read/write */
 struct vy_run_env {
 	/** Mempool for struct vy_page_read_task */
 	struct mempool read_task_pool;
 	/** Key for thread-local ZSTD context */
 	pthread_key_t zdctx_key;
+	/** Pages read by the tx thread */
+	struct vy_page_cache page_cache;
 };
 
 /**
@@ -92,6 +120,12 @@ struct vy_run_info {
 	/** Bloom filter of all tuples in run */
 	bool has_bloom;
 	struct bloom bloom;
+	/**
+	 * Bloom filters of key prefixes: prefix_blooms[i]
+	 * is built over the first i + 1 key parts.
+	 */
+	uint32_t prefix_bloom_count;
+	struct bloom *prefix_blooms;
 	/** Pages meta. */
 	struct vy_page_info *page_infos;
 };
@@ -161,6 +195,13 @@ struct vy_run {
 	int slice_count;
 	/** Unique ID of this run. */
 	int64_t id;
+	/**
+	 * Pages of this run in the page cache, indexed by page
+	 * number. Allocated on the first page put to the cache.
+	 */
+	struct vy_page **cached_pages;
+	/** The page cache the pages are in. */
+	struct vy_page_cache *page_cache;
 };
 
 /**
@@ -283,6 +324,15 @@ struct vy_run_iterator {
  * Page
  */
 struct vy_page {
+	/**
+	 * Reference counter. The page is referenced by run
+	 * iterators and by the page cache.
+	 */
+	int refs;
+	/** The run the page is cached for, NULL if not cached. */
+	struct vy_run *run;
+	/** Link in vy_page_cache::lru */
+	struct rlist in_lru;
 	/** Page position in the run file (used by run_iterator->page_cache */
 	uint32_t page_no;
 	/** The number of statements */
@@ -297,9 +347,10 @@ struct vy_page {
 
 /**
  * Initialize vinyl run environment
+ * @param page_cache_quota - memory limit for the page cache.
  */
 void
-vy_run_env_create(struct vy_run_env *env);
+vy_run_env_create(struct vy_run_env *env, uint64_t page_cache_quota);
 
 /**
  * Destroy vinyl run environment
@@ -495,6 +546,12 @@ vy_page_new(const struct vy_page_info *page_info);
 void
 vy_page_delete(struct vy_page *page);
 
+/**
+ * Drop a reference to a page, delete it if it was the last one.
+ */
+void
+vy_page_unref(struct vy_page *page);
+
 int
 vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	     struct xrow_header *xrow);
@@ -30,6 +30,8 @@
  */
 #include "wal.h"
 
+#include <fcntl.h>
+
 #include "vclock.h"
 #include "fiber.h"
 #include "fio.h"
@@ -40,7 +42,9 @@
 #include "vy_log.h"
 #include "cbus.h"
 #include "coeio.h"
+#include <pmatomic.h>
 #include "replication.h"
+#include "small/ibuf.h"
 
 
 const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
@@ -63,6 +67,33 @@ struct wal_thread {
 	struct cpipe tx_pipe;
 };
 
+/**
+ * A spare file for the next WAL. It is created in a coeio
+ * thread as soon as a new WAL is opened, so that rotation
+ * doesn't have to create a file, and disk space is allocated
+ * for it in advance, so that writes to the next WAL don't have
+ * to allocate disk blocks.
+ *
+ * While @in_progress is set, the members are owned by the
+ * coeio thread, which clears the flag with release semantics
+ * once the file is ready. The WAL thread touches the members
+ * only after it has seen the flag cleared.
+ */
+struct wal_spare {
+	/** Path to the file. */
+	char path[PATH_MAX];
+	/** Descriptor of the file or -1 if it isn't ready. */
+	int fd;
+	/** Whether disk space was preallocated for the file. */
+	bool is_preallocated;
+	/** Set while the file is being created. */
+	bool in_progress;
+	/** How much disk space to preallocate for the file. */
+	off_t size;
+	/** Flags to open the file with, see xdir::open_wflags. */
+	int open_wflags;
+};
+
 /*
  * WAL writer - maintain a Write Ahead Log for every change
  * in the data state.
@@ -82,6 +113,14 @@ struct wal_writer
 	 * the wal-tx bus and are rolled back "on arrival".
 	 */
 	struct stailq rollback;
+	/**
+	 * The vector clock of rows known in tx thread to be
+	 * written to the log. Unlike replicaset_vclock, which
+	 * appliers promote before a row is written, it never
+	 * runs ahead of the disk, so it is what a replica
+	 * acknowledges to the master.
+	 */
+	struct vclock written_vclock;
 	/* ----------------- wal ------------------- */
 	/** A setting from instance configuration - rows_per_wal */
 	int64_t wal_max_rows;
@@ -105,6 +144,8 @@ struct wal_writer
 	struct vclock vclock;
 	/** The current WAL file. */
 	struct xlog current_wal;
+	/** The file to use for the next WAL. */
+	struct wal_spare spare;
 	/**
 	 * Used if there was a WAL I/O error and we need to
 	 * keep adding all incoming requests to the rollback
@@ -121,6 +162,63 @@ struct wal_writer
 	pthread_mutex_t watchers_mutex;
 };
 
+/**
+ * The least disk space to preallocate for a WAL file. More
+ * is preallocated if the previous WAL file was bigger, but
+ * never more than wal_max_size, which is huge by default,
+ * since WAL files are usually rotated by wal_max_rows.
+ */
+static const off_t WAL_SPARE_SIZE_MIN = 64 * 1024 * 1024;
+
+/** Size of the in-memory WAL tail, see struct wal_tail. */
+static const size_t WAL_TAIL_SIZE = 8 * 1024 * 1024;
+
+/**
+ * Max bytes copied by wal_tail_read() at a time, so that
+ * a reader doesn't hold the lock, which the WAL thread
+ * takes on every write, for long.
+ */
+static const size_t WAL_TAIL_READ_MAX = 64 * 1024;
+
+/**
+ * The tail of WAL kept in memory, so that relays which are
+ * caught up don't have to re-read and decode the xlog files
+ * the WAL thread has just written. Rows are appended by the
+ * WAL thread once they are written to disk and read by relay
+ * threads, see wal_tail_read(). The oldest rows are evicted
+ * when the ring buffer is full.
+ *
+ * The buffer is allocated when the first relay attaches
+ * to the tail, so it costs nothing if there are no replicas.
+ */
+struct wal_tail {
+	/** The lock protecting the tail. */
+	pthread_mutex_t mutex;
+	/** Ring buffer of WAL_TAIL_SIZE bytes or NULL. */
+	char *buf;
+	/**
+	 * Offset of the first row in the buffer and the end
+	 * of the last one. Offsets grow monotonically, the
+	 * position in the buffer is offset % WAL_TAIL_SIZE.
+	 */
+	uint64_t begin;
+	uint64_t end;
+	/** Vclock of WAL before the first row in the buffer. */
+	struct vclock begin_vclock;
+	/** Vclock of WAL after the last row written. */
+	struct vclock vclock;
+};
+
+/** A row in struct wal_tail, followed by the encoded row. */
+struct wal_tail_row {
+	/** Size of the encoded row. */
+	uint32_t len;
+	uint32_t replica_id;
+	int64_t lsn;
+};
+
+static struct wal_tail wal_tail;
+
 struct wal_msg: public cmsg {
 	/** Input queue, on output contains all committed requests. */
 	struct stailq commit;
@@ -275,11 +373,20 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid);
 	xlog_clear(&writer->current_wal);
+	/*
+	 * The name doesn't end with the xlog extension,
+	 * so the spare file is ignored by xdir_scan().
+	 */
+	snprintf(writer->spare.path, sizeof(writer->spare.path),
+		 "%s/wal.prealloc", writer->wal_dir.dirname);
+	writer->spare.fd = -1;
+	writer->spare.in_progress = false;
 	if (wal_mode == WAL_FSYNC)
 		writer->wal_dir.open_wflags |= O_SYNC;
 
 	stailq_create(&writer->rollback);
 	cmsg_init(&writer->in_rollback, NULL);
+	vclock_copy(&writer->written_vclock, vclock);
 
 	/* Create and fill writer->vclock. */
 	vclock_create(&writer->vclock);
@@ -287,6 +394,12 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	tt_pthread_mutex_init(&writer->watchers_mutex, NULL);
 	rlist_create(&writer->watchers);
+
+	tt_pthread_mutex_init(&wal_tail.mutex, NULL);
+	wal_tail.buf = NULL;
+	wal_tail.begin = wal_tail.end = 0;
+	vclock_copy(&wal_tail.begin_vclock, vclock);
+	vclock_copy(&wal_tail.vclock, vclock);
 }
 
 /** Destroy a WAL writer structure. */
@@ -295,6 +408,8 @@ wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
 	tt_pthread_mutex_destroy(&writer->watchers_mutex);
+	tt_pthread_mutex_destroy(&wal_tail.mutex);
+	free(wal_tail.buf);
 }
 
 /** WAL thread routine. */
@@ -462,6 +577,98 @@ wal_collect_garbage(int64_t lsn)
 	fiber_set_cancellable(cancellable);
 }
 
+/** Create a spare WAL file, runs in a coeio thread. */
+static void
+wal_spare_create_f(eio_req *req)
+{
+	struct wal_spare *spare = (struct wal_spare *) req->data;
+	spare->is_preallocated = false;
+	int fd = open(spare->path, spare->open_wflags, 0644);
+	if (fd < 0) {
+		say_syserror("failed to create %s", spare->path);
+		goto out;
+	}
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+	/*
+	 * Keep the file size: readers of WAL files (recovery,
+	 * relays, hot standby) detect the end of a file by its
+	 * size. Even if the call fails, it may have allocated
+	 * part of the space, so mark the file as preallocated
+	 * anyway to release the space on close.
+	 */
+	(void) fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, spare->size);
+	spare->is_preallocated = true;
+#endif
+out:
+	/*
+	 * Don't use an eio completion callback to hand the
+	 * file over: it is run by whatever thread happens to
+	 * poll eio, not necessarily the WAL thread.
+	 */
+	spare->fd = fd;
+	pm_atomic_store_explicit(&spare->in_progress, false,
+				 pm_memory_order_release);
+}
+
+/** Check whether the spare file is being created. */
+static inline bool
+wal_spare_is_busy(struct wal_spare *spare)
+{
+	return pm_atomic_load_explicit(&spare->in_progress,
+				       pm_memory_order_acquire);
+}
+
+/**
+ * Start creation of a spare file for the next WAL unless
+ * there's one already. @a last_size is the size of the
+ * previous WAL file, if known, used to estimate how much
+ * disk space to preallocate.
+ */
+static void
+wal_spare_create(struct wal_writer *writer, off_t last_size)
+{
+	struct wal_spare *spare = &writer->spare;
+	if (wal_spare_is_busy(spare) || spare->fd >= 0)
+		return;
+	spare->size = MIN(MAX(last_size, WAL_SPARE_SIZE_MIN),
+			  (off_t) writer->wal_max_size);
+	/*
+	 * Open the file the way WAL files are opened (O_SYNC
+	 * in fsync mode), except that a stale spare file left
+	 * from a previous run is reused.
+	 */
+	spare->open_wflags = (writer->wal_dir.open_wflags & ~O_EXCL) |
+			     O_TRUNC;
+	spare->in_progress = true;
+	if (eio_custom(wal_spare_create_f, EIO_PRI_DEFAULT,
+		       NULL, spare) == NULL)
+		spare->in_progress = false;
+}
+
+/**
+ * Open a new WAL in the spare file, if there's one ready.
+ * On failure, the spare file is removed.
+ */
+static int
+wal_open_spare(struct wal_writer *writer)
+{
+	struct wal_spare *spare = &writer->spare;
+	if (wal_spare_is_busy(spare) || spare->fd < 0)
+		return -1;
+	int rc = xdir_create_xlog_from_spare(&writer->wal_dir,
+					     &writer->current_wal,
+					     &writer->vclock, spare->fd,
+					     spare->path,
+					     spare->is_preallocated);
+	if (rc != 0) {
+		error_log(diag_last_error(diag_get()));
+		close(spare->fd);
+		unlink(spare->path);
+	}
+	spare->fd = -1;
+	return rc;
+}
+
 /**
  * If there is no current WAL, try to open it, and close the
  * previous WAL. We close the previous WAL only after opening
@@ -483,9 +690,16 @@ wal_opt_rotate(struct wal_writer *writer)
 	 * EOF in the old WAL before switching to the new
 	 * one.
 	 */
+	off_t last_size = 0;
 	if (xlog_is_open(&writer->current_wal) &&
 	    (writer->current_wal.rows >= writer->wal_max_rows ||
 	     writer->current_wal.offset >= writer->wal_max_size)) {
+		last_size = writer->current_wal.offset;
+		/*
+		 * Don't stall writes to the next WAL until
+		 * the whole file is synced to disk.
+		 */
+		writer->current_wal.sync_is_async = true;
 		/*
 		 * We can not handle xlog_close()
 		 * failure in any reasonable way.
@@ -506,13 +720,15 @@ wal_opt_rotate(struct wal_writer *writer)
 	}
 	vclock_copy(vclock, &writer->vclock);
 
-	if (xdir_create_xlog(&writer->wal_dir, &writer->current_wal,
+	if (wal_open_spare(writer) != 0 &&
+	    xdir_create_xlog(&writer->wal_dir, &writer->current_wal,
 			     &writer->vclock) != 0) {
 		error_log(diag_last_error(diag_get()));
 		free(vclock);
 		return -1;
 	}
 	xdir_add_vclock(&writer->wal_dir, vclock);
+	wal_spare_create(writer, last_size);
 
 	return 0;
 }
@@ -568,6 +784,9 @@ wal_writer_begin_rollback(struct wal_writer *writer)
 static void
 wal_notify_watchers(struct wal_writer *writer);
 
+static void
+wal_tail_append(struct wal_tail *tail, struct stailq *entries);
+
 static void
 wal_assign_lsn(struct wal_writer *writer, struct xrow_header **row,
 	       struct xrow_header **end)
@@ -579,8 +798,16 @@ wal_assign_lsn(struct wal_writer *writer, struct xrow_header **row,
 			(*row)->replica_id = instance_id;
 		}
 	} else {
-		struct xrow_header *last = end[-1];
-		vclock_follow(&writer->vclock, last->replica_id, last->lsn);
+		/*
+		 * A batch of replicated rows may come from
+		 * several masters, follow each of them.
+		 */
+		for ( ; row < end; row++) {
+			if ((*row)->lsn > vclock_get(&writer->vclock,
+						     (*row)->replica_id))
+				vclock_follow(&writer->vclock,
+					      (*row)->replica_id, (*row)->lsn);
+		}
 	}
 }
 
@@ -679,6 +906,7 @@ done:
 			      &wal_msg->rollback);
 		wal_writer_begin_rollback(writer);
 	}
+	wal_tail_append(&wal_tail, &wal_msg->commit);
 	fiber_gc();
 	wal_notify_watchers(writer);
 }
@@ -708,6 +936,11 @@ wal_thread_f(va_list ap)
 	if (xlog_is_open(&writer->current_wal))
 		xlog_close(&writer->current_wal, false);
 
+	if (!wal_spare_is_busy(&writer->spare) && writer->spare.fd >= 0) {
+		close(writer->spare.fd);
+		unlink(writer->spare.path);
+	}
+
 	if (xlog_is_open(&vy_log_writer.xlog))
 		xlog_close(&vy_log_writer.xlog, false);
 
@@ -770,6 +1003,19 @@ wal_write(struct journal *journal, struct journal_entry *entry)
 	bool cancellable = fiber_set_cancellable(false);
 	fiber_yield(); /* Request was inserted. */
 	fiber_set_cancellable(cancellable);
+	if (entry->res >= 0) {
+		/*
+		 * Requests complete in the order they are written,
+		 * so the rows can be followed one by one.
+		 */
+		for (int i = 0; i < entry->n_rows; i++) {
+			struct xrow_header *row = entry->rows[i];
+			if (row->lsn > vclock_get(&writer->written_vclock,
+						  row->replica_id))
+				vclock_follow(&writer->written_vclock,
+					      row->replica_id, row->lsn);
+		}
+	}
 	/* All rows in request have the same replica id. */
 	struct xrow_header *last = entry->rows[entry->n_rows - 1];
 	/* Promote replica set vclock with local writes. */
@@ -801,9 +1047,16 @@ wal_write_in_wal_mode_none(struct journal *journal,
 		vclock_follow(&writer->vclock, instance_id, new_lsn);
 		vclock_follow(&replicaset_vclock, instance_id, new_lsn);
 	}
+	vclock_copy(&writer->written_vclock, &writer->vclock);
 	return vclock_sum(&writer->vclock);
 }
 
+const struct vclock *
+wal_written_vclock()
+{
+	return &wal_writer_singleton.written_vclock;
+}
+
 void
 wal_init_vy_log()
 {
@@ -907,6 +1160,162 @@ wal_notify_watchers(struct wal_writer *writer)
 }
 
 
+/* {{{ In-memory WAL tail */
+
+static void
+wal_tail_copy_in(struct wal_tail *tail, uint64_t pos,
+		 const void *data, size_t len)
+{
+	size_t offset = pos % WAL_TAIL_SIZE;
+	size_t n = MIN(len, WAL_TAIL_SIZE - offset);
+	memcpy(tail->buf + offset, data, n);
+	memcpy(tail->buf, (const char *) data + n, len - n);
+}
+
+static void
+wal_tail_copy_out(struct wal_tail *tail, uint64_t pos,
+		  void *data, size_t len)
+{
+	size_t offset = pos % WAL_TAIL_SIZE;
+	size_t n = MIN(len, WAL_TAIL_SIZE - offset);
+	memcpy(data, tail->buf + offset, n);
+	memcpy((char *) data + n, tail->buf, len - n);
+}
+
+/** Drop all rows from the tail, e.g. if a row doesn't fit. */
+static void
+wal_tail_reset(struct wal_tail *tail)
+{
+	tail->begin = tail->end;
+	vclock_copy(&tail->begin_vclock, &tail->vclock);
+}
+
+static void
+wal_tail_append_row(struct wal_tail *tail, struct xrow_header *row)
+{
+	if (row->lsn > vclock_get(&tail->vclock, row->replica_id))
+		vclock_follow(&tail->vclock, row->replica_id, row->lsn);
+	if (tail->buf == NULL)
+		return;
+
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(row, iov, 0);
+	if (iovcnt < 0) {
+		diag_clear(diag_get());
+		return wal_tail_reset(tail);
+	}
+	struct wal_tail_row hdr;
+	hdr.len = 0;
+	for (int i = 0; i < iovcnt; i++)
+		hdr.len += iov[i].iov_len;
+	hdr.replica_id = row->replica_id;
+	hdr.lsn = row->lsn;
+	size_t size = sizeof(hdr) + hdr.len;
+	if (size > WAL_TAIL_SIZE)
+		return wal_tail_reset(tail);
+
+	/* Evict the oldest rows to make room for the new one. */
+	while (tail->end + size - tail->begin > WAL_TAIL_SIZE) {
+		struct wal_tail_row old;
+		wal_tail_copy_out(tail, tail->begin, &old, sizeof(old));
+		if (old.lsn > vclock_get(&tail->begin_vclock, old.replica_id))
+			vclock_follow(&tail->begin_vclock, old.replica_id,
+				      old.lsn);
+		tail->begin += sizeof(old) + old.len;
+	}
+	wal_tail_copy_in(tail, tail->end, &hdr, sizeof(hdr));
+	tail->end += sizeof(hdr);
+	for (int i = 0; i < iovcnt; i++) {
+		wal_tail_copy_in(tail, tail->end, iov[i].iov_base,
+				 iov[i].iov_len);
+		tail->end += iov[i].iov_len;
+	}
+}
+
+/** Append the rows of written journal entries to the tail. */
+static void
+wal_tail_append(struct wal_tail *tail, struct stailq *entries)
+{
+	if (stailq_empty(entries))
+		return;
+	tt_pthread_mutex_lock(&tail->mutex);
+	struct journal_entry *entry;
+	stailq_foreach_entry(entry, entries, fifo) {
+		for (int i = 0; i < entry->n_rows; i++)
+			wal_tail_append_row(tail, entry->rows[i]);
+	}
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+int
+wal_tail_attach(struct wal_tail_cursor *cursor, const struct vclock *vclock)
+{
+	struct wal_tail *tail = &wal_tail;
+	if (journal_is_initialized(&wal_writer_singleton.base) == false ||
+	    wal_writer_singleton.wal_mode == WAL_NONE)
+		return -1;
+
+	int rc = -1;
+	tt_pthread_mutex_lock(&tail->mutex);
+	if (tail->buf == NULL) {
+		tail->buf = (char *) malloc(WAL_TAIL_SIZE);
+		if (tail->buf != NULL)
+			wal_tail_reset(tail);
+	}
+	/*
+	 * The tail has all rows written after begin_vclock,
+	 * so a reader can start from the first row as long
+	 * as it has seen everything before begin_vclock.
+	 */
+	int cmp = vclock_compare(&tail->begin_vclock, vclock);
+	if (tail->buf != NULL && (cmp == 0 || cmp == -1)) {
+		cursor->pos = tail->begin;
+		rc = 0;
+	}
+	tt_pthread_mutex_unlock(&tail->mutex);
+	return rc;
+}
+
+ssize_t
+wal_tail_read(struct wal_tail_cursor *cursor, struct ibuf *buf)
+{
+	struct wal_tail *tail = &wal_tail;
+	/* Don't allocate memory under the lock. */
+	char *data = (char *) ibuf_reserve(buf, WAL_TAIL_READ_MAX);
+	if (data == NULL)
+		return -1;
+	ssize_t size = -1;
+	tt_pthread_mutex_lock(&tail->mutex);
+	if (cursor->pos >= tail->begin) {
+		size = MIN(tail->end - cursor->pos, WAL_TAIL_READ_MAX);
+		wal_tail_copy_out(tail, cursor->pos, data, size);
+		cursor->pos += size;
+	} /* else the rows have been evicted */
+	tt_pthread_mutex_unlock(&tail->mutex);
+	if (size > 0)
+		buf->wpos += size;
+	return size;
+}
+
+int
+wal_tail_next(const char **pos, const char *end, struct xrow_header *row)
+{
+	struct wal_tail_row hdr;
+	if (end - *pos < (ptrdiff_t) sizeof(hdr))
+		return 1;
+	memcpy(&hdr, *pos, sizeof(hdr));
+	if (end - *pos - (ptrdiff_t) sizeof(hdr) < (ptrdiff_t) hdr.len)
+		return 1; /* the rest of the row hasn't been read yet */
+	*pos += sizeof(hdr);
+	const char *row_end = *pos + hdr.len;
+	if (xrow_header_decode(row, pos, row_end) != 0)
+		return -1;
+	assert(*pos == row_end);
+	return 0;
+}
+
+/* }}} */
+
 /**
  * After fork, the WAL writer thread disappears.
  * Make sure that atexit() handlers in the child do
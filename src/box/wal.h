@@ -38,6 +38,8 @@
 struct fiber;
 struct vclock;
 struct wal_writer;
+struct ibuf;
+struct xrow_header;
 
 enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 
@@ -80,6 +82,53 @@ wal_set_watcher(struct wal_watcher *, struct ev_async *);
 void
 wal_clear_watcher(struct wal_watcher *);
 
+/** A reader of the in-memory tail of WAL. */
+struct wal_tail_cursor {
+	/** Position of the next row to read. */
+	uint64_t pos;
+};
+
+/**
+ * Start reading the rows written to WAL from memory rather
+ * than from xlog files. The reader gets rows following
+ * @a vclock, possibly preceded by some rows it has already
+ * seen, which must be skipped by LSN.
+ * Fails (-1) if there is no WAL writer or the rows following
+ * @a vclock are no longer in memory.
+ */
+int
+wal_tail_attach(struct wal_tail_cursor *cursor, const struct vclock *vclock);
+
+/**
+ * Copy the rows written to WAL since the previous call to
+ * @a buf, up to a limit. The last row copied may be incomplete.
+ * Decode the rows with wal_tail_next().
+ * @retval >= 0 the number of bytes copied.
+ * @retval -1 the reader has fallen behind: the rows it
+ * hasn't read have been evicted from memory, and must be
+ * read from xlog files.
+ */
+ssize_t
+wal_tail_read(struct wal_tail_cursor *cursor, struct ibuf *buf);
+
+/**
+ * Decode the next row copied by wal_tail_read(). The row
+ * body points into the buffer.
+ * @retval 0 success
+ * @retval 1 no more complete rows, @a pos points to the
+ * beginning of the incomplete one, if any
+ * @retval -1 decode error, see diag
+ */
+int
+wal_tail_next(const char **pos, const char *end, struct xrow_header *row);
+
+/**
+ * The vector clock of rows written to WAL, as known
+ * in tx thread.
+ */
+const struct vclock *
+wal_written_vclock();
+
 void
 wal_atfork();
 
@@ -46,6 +46,7 @@
 #include "xrow.h"
 #include "iproto_constants.h"
 #include "errinj.h"
+#include "tt_pthread.h"
 
 /*
  * marker is MsgPack fixext2
@@ -912,32 +913,95 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+int
+xdir_create_xlog_from_spare(struct xdir *dir, struct xlog *xlog,
+			    const struct vclock *vclock, int spare_fd,
+			    const char *spare_name, bool is_preallocated)
+{
+	char meta_buf[XLOG_META_LEN_MAX];
+	int meta_len;
+	int64_t signature = vclock_sum(vclock);
+	assert(signature >= 0);
+	assert(!tt_uuid_is_nil(dir->instance_uuid));
+
+	char *filename = xdir_format_filename(dir, signature, dir->suffix);
+	/* We don't overwrite existing files. */
+	if (access(xdir_format_filename(dir, signature, NONE), F_OK) == 0) {
+		errno = EEXIST;
+		diag_set(SystemError, "file '%s' already exists", filename);
+		return -1;
+	}
+
+	if (xlog_init(xlog) != 0)
+		return -1;
+
+	/* Setup inherited values */
+	snprintf(xlog->meta.filetype, sizeof(xlog->meta.filetype), "%s",
+		 dir->filetype);
+	xlog->meta.instance_uuid = *dir->instance_uuid;
+	vclock_copy(&xlog->meta.vclock, vclock);
+	snprintf(xlog->filename, PATH_MAX, "%s", filename);
+	xlog->is_inprogress = dir->suffix == INPROGRESS;
+	xlog->is_preallocated = is_preallocated;
+
+	meta_len = xlog_meta_format(&xlog->meta, meta_buf, sizeof(meta_buf));
+	if (meta_len < 0)
+		goto err;
+	assert(meta_len < (int)sizeof(meta_buf));
+	if (fio_writen(spare_fd, meta_buf, meta_len) < 0) {
+		diag_set(SystemError, "%s: failed to write xlog meta",
+			 filename);
+		goto err;
+	}
+	/*
+	 * Rename the file only after the header is written,
+	 * see the comment in xlog_create().
+	 */
+	if (rename(spare_name, xlog->filename) != 0) {
+		say_syserror("can't rename %s to %s", spare_name,
+			     xlog->filename);
+		diag_set(SystemError, "failed to rename '%s' file",
+			 spare_name);
+		goto err;
+	}
+
+	xlog->fd = spare_fd;
+	xlog->offset = meta_len; /* first log starts after meta */
+	/* set sync interval from xdir settings */
+	xlog->sync_interval = dir->sync_interval;
+	/* free file cache if dir should be synced */
+	xlog->free_cache = dir->sync_interval != 0 ? true: false;
+	xlog->rate_limit = 0;
+	return 0;
+err:
+	xlog_destroy(xlog);
+	return -1;
+}
+
 /**
- * Write a sequence of uncompressed xrow objects.
- *
- * @retval -1 error
- * @retval >= 0 the number of bytes written
+ * Populate the fixheader of a sequence of uncompressed
+ * xrow objects, reserved at the start of @a obuf.
  */
-static off_t
-xlog_tx_write_plain(struct xlog *log)
+static void
+xlog_tx_encode_plain(struct obuf *obuf)
 {
 	/**
 	 * We created an obuf savepoint at start of xlog_tx,
 	 * now populate it with data.
 	 */
-	char *fixheader = (char *)log->obuf.iov[0].iov_base;
+	char *fixheader = (char *)obuf->iov[0].iov_base;
 	*(log_magic_t *)fixheader = row_marker;
 	char *data = fixheader + sizeof(log_magic_t);
 
 	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
+			      obuf_size(obuf) - XLOG_FIXHEADER_SIZE);
 	/* Encode crc32 for previous row */
 	data = mp_encode_uint(data, 0);
 	/* Encode crc32 for current row */
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
 		crc32c = crc32_calc(crc32c,
 				    (char *)iov->iov_base + offset,
 				    iov->iov_len - offset);
@@ -956,42 +1020,36 @@ xlog_tx_write_plain(struct xlog *log)
 			data += padding - 1;
 		}
 	}
-
-	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		return -1;
-	});
-
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
-		return -1;
-	}
-	return obuf_size(&log->obuf);
 }
 
 /**
- * Write a compressed block of xrow objects.
+ * Compress a sequence of xrow objects accumulated in @a obuf
+ * into a block with a fixheader in @a zbuf.
  * @retval -1  error
- * @retval >= 0 the number of bytes written
+ * @retval 0   success
  */
-static off_t
-xlog_tx_write_zstd(struct xlog *log)
+static int
+xlog_tx_encode_zstd(struct obuf *obuf, struct obuf *zbuf, ZSTD_CCtx *zctx)
 {
-	char *fixheader = (char *)obuf_alloc(&log->zbuf,
-					     XLOG_FIXHEADER_SIZE);
+	char *fixheader = (char *)obuf_alloc(zbuf, XLOG_FIXHEADER_SIZE);
+	if (fixheader == NULL) {
+		tnt_error(OutOfMemory, XLOG_FIXHEADER_SIZE, "runtime arena",
+			  "compression buffer");
+		goto error;
+	}
 
-	uint32_t crc32c = 0;
+	uint32_t crc32c;
+	crc32c = 0;
 	struct iovec *iov;
 	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
-	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
+	ZSTD_compressBegin(zctx, 3);
+	size_t offset;
+	offset = XLOG_FIXHEADER_SIZE;
+	for (iov = obuf->iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
 		size_t zmax_size = ZSTD_compressBound(iov->iov_len - offset);
 		/* Allocate a destination buffer. */
-		void *zdst = obuf_reserve(&log->zbuf, zmax_size);
+		void *zdst = obuf_reserve(zbuf, zmax_size);
 		if (!zdst) {
 			tnt_error(OutOfMemory, zmax_size, "runtime arena",
 				  "compression buffer");
@@ -1003,13 +1061,13 @@ xlog_tx_write_zstd(struct xlog *log)
 		 * If it's the last iov or the last
 		 * log has 0 bytes, end the stream.
 		 */
-		if (iov == log->obuf.iov + log->obuf.pos ||
+		if (iov == obuf->iov + obuf->pos ||
 		    !(iov + 1)->iov_len) {
 			fcompress = ZSTD_compressEnd;
 		} else {
 			fcompress = ZSTD_compressContinue;
 		}
-		size_t zsize = fcompress(log->zctx, zdst, zmax_size,
+		size_t zsize = fcompress(zctx, zdst, zmax_size,
 					 (char *)iov->iov_base + offset,
 					 iov->iov_len - offset);
 		if (ZSTD_isError(zsize)) {
@@ -1018,7 +1076,7 @@ xlog_tx_write_zstd(struct xlog *log)
 			goto error;
 		}
 		/* Advance output buffer to the end of compressed data. */
-		obuf_alloc(&log->zbuf, zsize);
+		obuf_alloc(zbuf, zsize);
 		/* Update crc32c */
 		crc32c = crc32_calc(crc32c, (char *)zdst, zsize);
 		/* Discount fixheader size for all iovs after first. */
@@ -1029,7 +1087,7 @@ xlog_tx_write_zstd(struct xlog *log)
 	char *data;
 	data = fixheader + sizeof(log_magic_t);
 	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
+			      obuf_size(zbuf) - XLOG_FIXHEADER_SIZE);
 	/* Encode crc32 for previous row */
 	data = mp_encode_uint(data, 0);
 	/* Encode crc32 for current row */
@@ -1044,26 +1102,62 @@ xlog_tx_write_zstd(struct xlog *log)
 			data += padding - 1;
 		}
 	}
+	return 0;
+error:
+	obuf_reset(zbuf);
+	return -1;
+}
 
+/**
+ * Write an encoded block of xrow objects to the log file.
+ * @retval -1  error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_tx_write_iov(struct xlog *log, struct obuf *buf)
+{
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		obuf_reset(&log->zbuf);
-		goto error;
+		return -1;
 	});
 
-	ssize_t written;
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
+	ssize_t written = fio_writevn(log->fd, buf->iov, buf->pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
-		goto error;
+		return -1;
 	}
-	obuf_reset(&log->zbuf);
 	return written;
-error:
+}
+
+/**
+ * Write a sequence of uncompressed xrow objects.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
+ */
+static off_t
+xlog_tx_write_plain(struct xlog *log)
+{
+	xlog_tx_encode_plain(&log->obuf);
+	if (xlog_tx_write_iov(log, &log->obuf) < 0)
+		return -1;
+	return obuf_size(&log->obuf);
+}
+
+/**
+ * Write a compressed block of xrow objects.
+ * @retval -1  error
+ * @retval >= 0 the number of bytes written
+ */
+static off_t
+xlog_tx_write_zstd(struct xlog *log)
+{
+	if (xlog_tx_encode_zstd(&log->obuf, &log->zbuf, log->zctx) != 0)
+		return -1;
+	ssize_t written = xlog_tx_write_iov(log, &log->zbuf);
 	obuf_reset(&log->zbuf);
-	return -1;
+	return written;
 }
 
 /* file syncing and posix_fadvise() should be rounded by a page boundary */
@@ -1072,23 +1166,13 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Account @a rows written to the log file with a block of
+ * @a written bytes: advance the file offset, sync the file
+ * and throttle the writer if necessary.
  */
 static ssize_t
-xlog_tx_write(struct xlog *log)
+xlog_tx_complete(struct xlog *log, ssize_t written, int64_t rows)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
-
-	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
-
-	obuf_reset(&log->obuf);
 	/*
 	 * Simplify recovery after a temporary write failure:
 	 * truncate the file to the best known good write
@@ -1101,8 +1185,7 @@ xlog_tx_write(struct xlog *log)
 		return -1;
 	}
 	log->offset += written;
-	log->rows += log->tx_rows;
-	log->tx_rows = 0;
+	log->rows += rows;
 	if ((log->sync_interval && log->offset >=
 	    (off_t)(log->synced_size + log->sync_interval)) ||
 	    (log->rate_limit && log->offset >=
@@ -1144,54 +1227,92 @@ xlog_tx_write(struct xlog *log)
 	return written;
 }
 
-/*
- * Add a row to a log and possibly flush the log.
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written;
+
+	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+		written = xlog_tx_write_zstd(log);
+	} else {
+		written = xlog_tx_write_plain(log);
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
+
+	obuf_reset(&log->obuf);
+	int64_t rows = log->tx_rows;
+	log->tx_rows = 0;
+	return xlog_tx_complete(log, written, rows);
+}
+
+/**
+ * Encode a row into a buffer of xrow objects, reserving
+ * space for a fixheader before the first row.
  *
  * @retval  -1 error, check diag.
- * @retval >=0 the number of bytes written to buffer.
+ * @retval >=0 the number of bytes added to the buffer.
  */
-ssize_t
-xlog_write_row(struct xlog *log, const struct xrow_header *packet)
+static ssize_t
+xlog_tx_add_row(struct obuf *obuf, const struct xrow_header *packet)
 {
 	/*
 	 * Automatically reserve space for a fixheader when adding
 	 * the first row in * a log. The fixheader is populated
 	 * at write. @sa xlog_tx_write().
 	 */
-	if (obuf_size(&log->obuf) == 0) {
-		if (!obuf_alloc(&log->obuf, XLOG_FIXHEADER_SIZE)) {
+	if (obuf_size(obuf) == 0) {
+		if (!obuf_alloc(obuf, XLOG_FIXHEADER_SIZE)) {
 			tnt_error(OutOfMemory, XLOG_FIXHEADER_SIZE,
 				  "runtime arena", "xlog tx output buffer");
 			return -1;
 		}
 	}
 
-	size_t page_offset = obuf_size(&log->obuf);
+	size_t page_offset = obuf_size(obuf);
 	/** encode row into iovec */
 	struct iovec iov[XROW_IOVMAX];
 	int iovcnt = xrow_header_encode(packet, iov, 0);
-	struct obuf_svp svp = obuf_create_svp(&log->obuf);
+	struct obuf_svp svp = obuf_create_svp(obuf);
 	for (int i = 0; i < iovcnt; ++i) {
 		struct errinj *inj = errinj(ERRINJ_WAL_WRITE_PARTIAL,
 					    ERRINJ_U64);
-		if (inj != NULL && obuf_size(&log->obuf) > inj->u64param) {
+		if (inj != NULL && obuf_size(obuf) > inj->u64param) {
 			diag_set(ClientError, ER_INJECTION,
 				 "xlog write injection");
-			obuf_rollback_to_svp(&log->obuf, &svp);
+			obuf_rollback_to_svp(obuf, &svp);
 			return -1;
 		};
-		if (obuf_dup(&log->obuf, iov[i].iov_base, iov[i].iov_len) <
+		if (obuf_dup(obuf, iov[i].iov_base, iov[i].iov_len) <
 		    iov[i].iov_len) {
 			tnt_error(OutOfMemory, XLOG_FIXHEADER_SIZE,
 				  "runtime arena", "xlog tx output buffer");
-			obuf_rollback_to_svp(&log->obuf, &svp);
+			obuf_rollback_to_svp(obuf, &svp);
 			return -1;
 		}
 	}
 	assert(iovcnt <= XROW_IOVMAX);
+	return obuf_size(obuf) - page_offset;
+}
+
+/*
+ * Add a row to a log and possibly flush the log.
+ *
+ * @retval  -1 error, check diag.
+ * @retval >=0 the number of bytes written to buffer.
+ */
+ssize_t
+xlog_write_row(struct xlog *log, const struct xrow_header *packet)
+{
+	ssize_t row_size = xlog_tx_add_row(&log->obuf, packet);
+	if (row_size < 0)
+		return -1;
 	log->tx_rows++;
 
-	size_t row_size = obuf_size(&log->obuf) - page_offset;
 	if (log->is_autocommit &&
 	    obuf_size(&log->obuf) >= XLOG_TX_AUTOCOMMIT_THRESHOLD &&
 	    xlog_tx_write(log) < 0)
@@ -1200,6 +1321,83 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	return row_size;
 }
 
+int
+xlog_tx_buf_create(struct xlog_tx_buf *buf)
+{
+	obuf_create(&buf->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	obuf_create(&buf->zbuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	buf->rows = 0;
+	buf->data = NULL;
+	buf->zctx = ZSTD_createCCtx();
+	if (buf->zctx == NULL) {
+		obuf_destroy(&buf->obuf);
+		obuf_destroy(&buf->zbuf);
+		diag_set(ClientError, ER_COMPRESSION,
+			 "failed to create context");
+		return -1;
+	}
+	return 0;
+}
+
+void
+xlog_tx_buf_destroy(struct xlog_tx_buf *buf)
+{
+	obuf_destroy(&buf->obuf);
+	obuf_destroy(&buf->zbuf);
+	ZSTD_freeCCtx(buf->zctx);
+	TRASH(buf);
+}
+
+void
+xlog_tx_buf_reset(struct xlog_tx_buf *buf)
+{
+	obuf_reset(&buf->obuf);
+	obuf_reset(&buf->zbuf);
+	buf->rows = 0;
+	buf->data = NULL;
+}
+
+ssize_t
+xlog_tx_buf_add_row(struct xlog_tx_buf *buf, const struct xrow_header *row)
+{
+	assert(buf->data == NULL);
+	ssize_t row_size = xlog_tx_add_row(&buf->obuf, row);
+	if (row_size >= 0)
+		buf->rows++;
+	return row_size;
+}
+
+int
+xlog_tx_buf_encode(struct xlog_tx_buf *buf)
+{
+	assert(buf->data == NULL);
+	if (buf->rows == 0)
+		return 0;
+	if (obuf_size(&buf->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+		if (xlog_tx_encode_zstd(&buf->obuf, &buf->zbuf,
+					buf->zctx) != 0)
+			return -1;
+		buf->data = &buf->zbuf;
+	} else {
+		xlog_tx_encode_plain(&buf->obuf);
+		buf->data = &buf->obuf;
+	}
+	return 0;
+}
+
+ssize_t
+xlog_write_tx_buf(struct xlog *log, struct xlog_tx_buf *buf)
+{
+	/* Rows buffered in the log would go out of order. */
+	assert(obuf_size(&log->obuf) == 0);
+	if (buf->rows == 0)
+		return 0;
+	assert(buf->data != NULL);
+	ssize_t written = xlog_tx_write_iov(log, buf->data);
+	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
+	return xlog_tx_complete(log, written, buf->rows);
+}
+
 /**
  * Begin a multi-statement xlog transaction. All xrow objects
  * of a single transaction share the same header and checksum
@@ -1290,6 +1488,13 @@ xlog_close(struct xlog *l, bool reuse_fd)
 	int rc = fio_writen(l->fd, &eof_marker, sizeof(log_magic_t));
 	if (rc < 0)
 		say_syserror("%s: failed to write EOF marker", l->filename);
+	/*
+	 * Release disk space preallocated past the end of
+	 * the file, if any is left.
+	 */
+	if (rc >= 0 && l->is_preallocated &&
+	    ftruncate(l->fd, l->offset + sizeof(log_magic_t)) != 0)
+		say_syserror("%s: failed to truncate", l->filename);
 
 	/*
 	 * Sync the file before closing, since
@@ -1881,3 +2086,197 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 }
 
 /* }}} */
+
+/* {{{ xlog_prefetch */
+
+/**
+ * Read the next transaction of the file into the cursor
+ * tx buffer, skipping broken transactions in case of
+ * force recovery. Same as the tx part of xlog_cursor_next().
+ */
+static int
+xlog_prefetch_next_tx(struct xlog_cursor *cursor, bool force_recovery)
+{
+	int rc;
+	while ((rc = xlog_cursor_next_tx(cursor)) < 0) {
+		struct error *e = diag_last_error(diag_get());
+		if (!force_recovery || e->type != &type_XlogError)
+			return -1;
+		say_error("can't open tx: %s", e->errmsg);
+		if ((rc = xlog_cursor_find_tx_magic(cursor)) < 0)
+			return -1;
+		if (rc > 0)
+			break;
+	}
+	return rc;
+}
+
+/** Let the consumer know the reader has made progress. */
+static void
+xlog_prefetch_notify(struct xlog_prefetch *prefetch)
+{
+	ev_async_send(prefetch->loop, &prefetch->async);
+}
+
+static void
+xlog_prefetch_async_cb(ev_loop *loop, struct ev_async *watcher, int events)
+{
+	(void) loop;
+	(void) events;
+	struct xlog_prefetch *prefetch =
+		(struct xlog_prefetch *) watcher->data;
+	ipc_cond_broadcast(&prefetch->ready);
+}
+
+static int
+xlog_prefetch_f(va_list ap)
+{
+	struct xlog_prefetch *prefetch = va_arg(ap, struct xlog_prefetch *);
+	struct xlog_cursor cursor;
+	int rc = xlog_cursor_open(&cursor, prefetch->filename);
+	bool eof_read = false;
+	if (rc == 0) {
+		while (true) {
+			/* Wait for a free buffer. */
+			tt_pthread_mutex_lock(&prefetch->mutex);
+			while (prefetch->is_running &&
+			       prefetch->write_pos - prefetch->read_pos >=
+			       XLOG_PREFETCH_TX_MAX)
+				tt_pthread_cond_wait(&prefetch->cond,
+						     &prefetch->mutex);
+			bool is_running = prefetch->is_running;
+			tt_pthread_mutex_unlock(&prefetch->mutex);
+			if (!is_running)
+				break;
+
+			rc = xlog_prefetch_next_tx(&cursor,
+						   prefetch->force_recovery);
+			if (rc != 0)
+				break;
+			int64_t pos = prefetch->write_pos;
+			struct xlog_tx_cursor *tx =
+				&prefetch->tx[pos % XLOG_PREFETCH_TX_MAX];
+			/* The buffer was released by the consumer. */
+			if (pos >= XLOG_PREFETCH_TX_MAX)
+				xlog_tx_cursor_destroy(tx);
+			/* Take the transaction over from the cursor. */
+			*tx = cursor.tx_cursor;
+			cursor.state = XLOG_CURSOR_ACTIVE;
+
+			tt_pthread_mutex_lock(&prefetch->mutex);
+			prefetch->write_pos++;
+			tt_pthread_mutex_unlock(&prefetch->mutex);
+			xlog_prefetch_notify(prefetch);
+		}
+		eof_read = cursor.state == XLOG_CURSOR_EOF;
+		xlog_cursor_close(&cursor, false);
+	}
+	if (rc < 0)
+		diag_move(diag_get(), &prefetch->diag);
+
+	tt_pthread_mutex_lock(&prefetch->mutex);
+	prefetch->rc = rc;
+	prefetch->eof_read = eof_read;
+	prefetch->is_done = true;
+	xlog_prefetch_notify(prefetch);
+	/* The consumer may still read rows from the buffers. */
+	while (prefetch->is_running)
+		tt_pthread_cond_wait(&prefetch->cond, &prefetch->mutex);
+	tt_pthread_mutex_unlock(&prefetch->mutex);
+
+	int64_t begin = prefetch->write_pos - XLOG_PREFETCH_TX_MAX;
+	for (int64_t pos = MAX(begin, 0); pos < prefetch->write_pos; pos++)
+		xlog_tx_cursor_destroy(&prefetch->tx[pos % XLOG_PREFETCH_TX_MAX]);
+	return 0;
+}
+
+int
+xlog_prefetch_start(struct xlog_prefetch *prefetch, const char *filename,
+		    bool force_recovery)
+{
+	memset(prefetch, 0, sizeof(*prefetch));
+	snprintf(prefetch->filename, sizeof(prefetch->filename),
+		 "%s", filename);
+	prefetch->force_recovery = force_recovery;
+	prefetch->is_running = true;
+	diag_create(&prefetch->diag);
+	tt_pthread_mutex_init(&prefetch->mutex, NULL);
+	tt_pthread_cond_init(&prefetch->cond, NULL);
+	ipc_cond_create(&prefetch->ready);
+	prefetch->loop = loop();
+	ev_async_init(&prefetch->async, xlog_prefetch_async_cb);
+	prefetch->async.data = prefetch;
+	ev_async_start(prefetch->loop, &prefetch->async);
+	if (cord_costart(&prefetch->cord, "xlog.prefetch",
+			 xlog_prefetch_f, prefetch) != 0) {
+		ev_async_stop(prefetch->loop, &prefetch->async);
+		ipc_cond_destroy(&prefetch->ready);
+		tt_pthread_cond_destroy(&prefetch->cond);
+		tt_pthread_mutex_destroy(&prefetch->mutex);
+		diag_destroy(&prefetch->diag);
+		return -1;
+	}
+	return 0;
+}
+
+int
+xlog_prefetch_next(struct xlog_prefetch *prefetch, struct xrow_header *xrow)
+{
+	while (true) {
+		if (prefetch->has_tx) {
+			int64_t pos = prefetch->read_pos;
+			struct xlog_tx_cursor *tx =
+				&prefetch->tx[pos % XLOG_PREFETCH_TX_MAX];
+			int rc = xlog_tx_cursor_next_row(tx, xrow);
+			if (rc == 0)
+				return 0;
+			if (rc < 0) {
+				struct error *e = diag_last_error(diag_get());
+				if (!prefetch->force_recovery ||
+				    e->type != &type_XlogError)
+					return -1;
+				say_error("can't decode row: %s", e->errmsg);
+			}
+			/* Give the buffer back to the reader. */
+			tt_pthread_mutex_lock(&prefetch->mutex);
+			prefetch->read_pos++;
+			prefetch->has_tx = false;
+			tt_pthread_cond_broadcast(&prefetch->cond);
+			tt_pthread_mutex_unlock(&prefetch->mutex);
+		}
+		tt_pthread_mutex_lock(&prefetch->mutex);
+		while (prefetch->read_pos == prefetch->write_pos &&
+		       !prefetch->is_done) {
+			/* Don't block the event loop. */
+			tt_pthread_mutex_unlock(&prefetch->mutex);
+			ipc_cond_wait(&prefetch->ready);
+			tt_pthread_mutex_lock(&prefetch->mutex);
+		}
+		if (prefetch->read_pos == prefetch->write_pos) {
+			int rc = prefetch->rc;
+			tt_pthread_mutex_unlock(&prefetch->mutex);
+			if (rc < 0)
+				diag_move(&prefetch->diag, diag_get());
+			return rc;
+		}
+		prefetch->has_tx = true;
+		tt_pthread_mutex_unlock(&prefetch->mutex);
+	}
+}
+
+void
+xlog_prefetch_stop(struct xlog_prefetch *prefetch)
+{
+	tt_pthread_mutex_lock(&prefetch->mutex);
+	prefetch->is_running = false;
+	tt_pthread_cond_broadcast(&prefetch->cond);
+	tt_pthread_mutex_unlock(&prefetch->mutex);
+	cord_cojoin(&prefetch->cord);
+	ev_async_stop(prefetch->loop, &prefetch->async);
+	ipc_cond_destroy(&prefetch->ready);
+	tt_pthread_cond_destroy(&prefetch->cond);
+	tt_pthread_mutex_destroy(&prefetch->mutex);
+	diag_destroy(&prefetch->diag);
+}
+
+/* }}} */
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include "tt_uuid.h"
 #include "vclock.h"
 
@@ -41,6 +42,8 @@
 
 #include "small/ibuf.h"
 #include "small/obuf.h"
+#include "fiber.h"
+#include "ipc.h"
 
 struct iovec;
 struct xrow_header;
@@ -260,6 +263,11 @@ struct xlog {
 	char filename[PATH_MAX + 1];
 	/** Whether this file has .inprogress suffix. */
 	bool is_inprogress;
+	/**
+	 * Whether disk space was preallocated for the file past
+	 * its end. What is left of it is released on close.
+	 */
+	bool is_preallocated;
 	/*
 	 * If true, we can flush the data in this buffer whenever
 	 * we like, and it's usually when the buffer gets
@@ -343,6 +351,31 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * Create a new file like xdir_create_xlog() does, but rather
+ * than creating it, take over a spare file created in advance,
+ * possibly with disk space preallocated for it. The header is
+ * written to the spare file, which is then renamed to the name
+ * of the new xlog.
+ *
+ * @param xdir xdir
+ * @param[out] xlog xlog structure
+ * @param vclock        the global state of replication (vector
+ *			clock) at the moment the file is created.
+ * @param spare_fd      descriptor of the spare file, empty and
+ *			positioned at its beginning
+ * @param spare_name    the name of the spare file
+ * @param is_preallocated whether disk space was preallocated
+ *			for the spare file past its end
+ *
+ * @retval 0 if OK, the descriptor is owned by the xlog
+ * @retval -1 if error, the spare file is left to the caller
+ */
+int
+xdir_create_xlog_from_spare(struct xdir *dir, struct xlog *xlog,
+			    const struct vclock *vclock, int spare_fd,
+			    const char *spare_name, bool is_preallocated);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
@@ -404,6 +437,77 @@ xlog_rename(struct xlog *l);
 ssize_t
 xlog_write_row(struct xlog *log, const struct xrow_header *packet);
 
+/**
+ * A block of rows encoded into an xlog transaction apart
+ * from the xlog file, so that the rows can be encoded and
+ * compressed in another thread and then written to the file
+ * with xlog_write_tx_buf(). The buffer memory comes from the
+ * slab cache of the thread which created the buffer, so only
+ * this thread may add rows to it or reset it.
+ */
+struct xlog_tx_buf {
+	/** Encoded rows, starting with a fixheader. */
+	struct obuf obuf;
+	/** Compressed rows, starting with a fixheader. */
+	struct obuf zbuf;
+	/** The context of zstd compression. */
+	ZSTD_CCtx *zctx;
+	/** Number of rows in the buffer. */
+	int64_t rows;
+	/** The encoded block, obuf or zbuf, set by xlog_tx_buf_encode(). */
+	struct obuf *data;
+};
+
+/**
+ * Create a detached xlog transaction buffer.
+ *
+ * @retval 0 for success
+ * @retval -1 for error
+ */
+int
+xlog_tx_buf_create(struct xlog_tx_buf *buf);
+
+void
+xlog_tx_buf_destroy(struct xlog_tx_buf *buf);
+
+/**
+ * Discard the rows of the buffer to reuse it.
+ */
+void
+xlog_tx_buf_reset(struct xlog_tx_buf *buf);
+
+/**
+ * Add a row to the buffer.
+ *
+ * @retval count of buffered bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_tx_buf_add_row(struct xlog_tx_buf *buf, const struct xrow_header *row);
+
+/**
+ * Compress the rows of the buffer if it is big enough and
+ * populate the fixheader. No rows can be added after that.
+ *
+ * @retval 0 for success
+ * @retval -1 for error
+ */
+int
+xlog_tx_buf_encode(struct xlog_tx_buf *buf);
+
+/**
+ * Append a block encoded with xlog_tx_buf_encode() to the xlog
+ * file, subject to the sync interval and the rate limit of
+ * the xlog. The xlog must have no rows buffered. The buffer
+ * is not modified, so the block can be written by a thread
+ * other than the one which encoded it.
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_tx_buf(struct xlog *log, struct xlog_tx_buf *buf);
+
 /**
  * Prevent xlog row buffer offloading, should be use
  * at transaction start to write transaction in one xlog tx
@@ -626,6 +730,17 @@ int
 xlog_cursor_next(struct xlog_cursor *cursor,
 		 struct xrow_header *xrow, bool force_recovery);
 
+/**
+ * Check if all rows of the current xlog tx have been fetched,
+ * i.e. the next row, if any, starts a new tx.
+ */
+static inline bool
+xlog_cursor_is_eot(struct xlog_cursor *cursor)
+{
+	return cursor->state != XLOG_CURSOR_TX ||
+	       ibuf_used(&cursor->tx_cursor.rows) == 0;
+}
+
 /**
  * Move to the next xlog tx
  *
@@ -638,6 +753,92 @@ xlog_cursor_find_tx_magic(struct xlog_cursor *i);
 
 /* }}} */
 
+/* {{{ xlog_prefetch - read an xlog file in a separate thread */
+
+enum {
+	/** Max number of transactions read ahead of the consumer. */
+	XLOG_PREFETCH_TX_MAX = 8,
+};
+
+/**
+ * A thread reading a log file ahead of its consumer. The
+ * thread reads transactions from the file, validates their
+ * checksums and decompresses them, so that the consumer only
+ * has to decode rows. Decompressed transactions are handed to
+ * the consumer through a ring of XLOG_PREFETCH_TX_MAX buffers.
+ * The buffers are allocated and freed by the reader thread.
+ *
+ * The consumer is a fiber: it waits for the reader on
+ * a fiber cond, which is signaled via an ev_async in the
+ * consumer's event loop, so that other fibers keep running.
+ */
+struct xlog_prefetch {
+	/** The file to read. */
+	char filename[PATH_MAX];
+	/** Skip broken transactions and rows rather than fail. */
+	bool force_recovery;
+	/** The reader thread. */
+	struct cord cord;
+	pthread_mutex_t mutex;
+	/** Signaled when the consumer makes progress. */
+	pthread_cond_t cond;
+	/** Event loop of the consumer. */
+	struct ev_loop *loop;
+	/** Sent by the reader to the consumer loop on progress. */
+	struct ev_async async;
+	/** Signaled when the reader makes progress. */
+	struct ipc_cond ready;
+	/** The ring of decompressed transactions. */
+	struct xlog_tx_cursor tx[XLOG_PREFETCH_TX_MAX];
+	/** The number of transactions read by the reader. */
+	int64_t write_pos;
+	/** The number of transactions released by the consumer. */
+	int64_t read_pos;
+	/** Set if the consumer reads rows of tx[read_pos]. */
+	bool has_tx;
+	/** Cleared to stop the reader thread. */
+	bool is_running;
+	/** Set when the reader has read the whole file or failed. */
+	bool is_done;
+	/** Set if the EOF marker of the file has been read. */
+	bool eof_read;
+	/** 1 if the reader has reached the end of file, -1 on error. */
+	int rc;
+	/** The error which stopped the reader. */
+	struct diag diag;
+};
+
+/**
+ * Start reading a log file in a separate thread. The rows
+ * must be fetched from the calling cord.
+ *
+ * @retval 0 for success
+ * @retval -1 for error, check diag
+ */
+int
+xlog_prefetch_start(struct xlog_prefetch *prefetch, const char *filename,
+		    bool force_recovery);
+
+/**
+ * Fetch the next row of the file, waiting for the reader
+ * thread if necessary. The row is valid until the next call.
+ * Follows the contract of xlog_cursor_next().
+ *
+ * @retval 0 for success
+ * @retval 1 if eof
+ * @retval -1 for error
+ */
+int
+xlog_prefetch_next(struct xlog_prefetch *prefetch, struct xrow_header *xrow);
+
+/**
+ * Stop the reader thread and free all resources.
+ */
+void
+xlog_prefetch_stop(struct xlog_prefetch *prefetch);
+
+/* }}} */
+
 /** {{{ miscellaneous log io functions. */
 
 /**
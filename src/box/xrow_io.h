@@ -30,6 +30,8 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -41,6 +43,16 @@ struct xrow_header;
 void
 coio_read_xrow(struct ev_io *coio, struct ibuf *in, struct xrow_header *row);
 
+/**
+ * Decode a row which is already fully read into the input
+ * buffer, without doing any I/O.
+ *
+ * @retval true  a row was decoded and consumed from @a in
+ * @retval false @a in doesn't contain a complete row yet
+ */
+bool
+ibuf_read_xrow(struct ibuf *in, struct xrow_header *row);
+
 void
 coio_write_xrow(struct ev_io *coio, const struct xrow_header *row);
 
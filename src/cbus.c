@@ -31,8 +31,28 @@
 #include "cbus.h"
 
 #include <limits.h>
+#include <pmatomic.h>
 #include "fiber.h"
 
+enum {
+	/**
+	 * How many times the consumer polls a message which is
+	 * being appended to the endpoint queue by a producer
+	 * before it gives up and reschedules the fetch to the
+	 * next event loop iteration.
+	 */
+	CBUS_FETCH_SPIN_MAX = 1000,
+	/** How often max_input of a pipe is tuned, in seconds. */
+	CPIPE_TUNE_PERIOD = 1,
+	/**
+	 * The desired maximal number of flushes of a pipe per
+	 * second when max_input is set.
+	 */
+	CPIPE_FLUSH_RATE = 10000,
+	/** The lower bound of tuned max_input. */
+	CPIPE_MAX_INPUT_MIN = 4,
+};
+
 /**
  * Cord interconnect.
  */
@@ -45,6 +65,8 @@ struct cbus {
 	pthread_cond_t cond;
 	/** Connected endpoints */
 	struct rlist endpoints;
+	/** All pipes, protected by the mutex. */
+	struct rlist pipes;
 };
 
 /** A singleton for all cords. */
@@ -83,8 +105,13 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 	stailq_create(&pipe->input);
 
 	pipe->n_input = 0;
-	pipe->max_input = INT_MAX;
+	pipe->max_input = pipe->max_input_limit = INT_MAX;
+	pipe->n_flushes = pipe->n_flushed = 0;
+	pipe->tune_flushed = 0;
 	pipe->producer = cord()->loop;
+	pipe->tune_time = ev_now(pipe->producer);
+	snprintf(pipe->producer_name, sizeof(pipe->producer_name), "%s",
+		 cord_name(cord()));
 
 	ev_async_init(&pipe->flush_input, cpipe_flush_cb);
 	pipe->flush_input.data = pipe;
@@ -97,6 +124,7 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 	}
 	pipe->endpoint = endpoint;
 	++pipe->endpoint->n_pipes;
+	rlist_add_tail_entry(&cbus.pipes, pipe, in_cbus);
 	tt_pthread_mutex_unlock(&cbus.mutex);
 }
 
@@ -120,6 +148,14 @@ cpipe_destroy(struct cpipe *pipe)
 	static const struct cmsg_hop route[1] = {
 		{cbus_endpoint_poison_f, NULL}
 	};
+	/*
+	 * Unregister the pipe before the endpoint may be
+	 * destroyed, cbus_foreach_pipe() reads its name.
+	 */
+	tt_pthread_mutex_lock(&cbus.mutex);
+	rlist_del_entry(pipe, in_cbus);
+	tt_pthread_mutex_unlock(&cbus.mutex);
+
 	struct cmsg_poison *poison = malloc(sizeof(struct cmsg_poison));
 	poison->endpoint = pipe->endpoint;
 	cmsg_init(&poison->msg, route);
@@ -132,6 +168,29 @@ cpipe_destroy(struct cpipe *pipe)
 	TRASH(pipe);
 }
 
+int
+cbus_foreach_pipe(cpipe_stat_cb cb, void *cb_ctx)
+{
+	int rc = 0;
+	struct cpipe *pipe;
+	tt_pthread_mutex_lock(&cbus.mutex);
+	rlist_foreach_entry(pipe, &cbus.pipes, in_cbus) {
+		struct cpipe_stat stat;
+		snprintf(stat.producer, sizeof(stat.producer), "%s",
+			 pipe->producer_name);
+		snprintf(stat.consumer, sizeof(stat.consumer), "%s",
+			 pipe->endpoint->name);
+		stat.max_input = pipe->max_input;
+		stat.flushes = pipe->n_flushes;
+		stat.messages = pipe->n_flushed;
+		rc = cb(&stat, cb_ctx);
+		if (rc != 0)
+			break;
+	}
+	tt_pthread_mutex_unlock(&cbus.mutex);
+	return rc;
+}
+
 static void
 cbus_create(struct cbus *bus)
 {
@@ -145,6 +204,7 @@ cbus_create(struct cbus *bus)
 	(void) tt_pthread_cond_init(&bus->cond, NULL);
 
 	rlist_create(&bus->endpoints);
+	rlist_create(&bus->pipes);
 }
 
 static void
@@ -175,8 +235,8 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	endpoint->consumer = loop();
 	endpoint->n_pipes = 0;
 	ipc_cond_create(&endpoint->cond);
-	tt_pthread_mutex_init(&endpoint->mutex, NULL);
-	stailq_create(&endpoint->output);
+	endpoint->stub.next = NULL;
+	endpoint->head = endpoint->tail = &endpoint->stub;
 	ev_async_init(&endpoint->async,
 		      (void (*)(ev_loop *, struct ev_async *, int)) fetch_cb);
 	endpoint->async.data = fetch_data;
@@ -195,6 +255,18 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	return 0;
 }
 
+/**
+ * Check if there are no incoming messages at the endpoint.
+ * Must be called by the consumer.
+ */
+static inline bool
+cbus_endpoint_is_empty(struct cbus_endpoint *endpoint)
+{
+	return endpoint->tail == &endpoint->stub &&
+	       pm_atomic_load_explicit(&endpoint->stub.next,
+				       pm_memory_order_acquire) == NULL;
+}
+
 int
 cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 		      void (*process_cb)(struct cbus_endpoint *endpoint))
@@ -210,16 +282,119 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	do {
 		if (process_cb)
 			process_cb(endpoint);
-	} while ((endpoint->n_pipes > 0 || !stailq_empty(&endpoint->output)) &&
+	} while ((endpoint->n_pipes > 0 ||
+		  !cbus_endpoint_is_empty(endpoint)) &&
 		 ipc_cond_wait(&endpoint->cond));
 
-	tt_pthread_mutex_destroy(&endpoint->mutex);
 	ev_async_stop(endpoint->consumer, &endpoint->async);
 	ipc_cond_destroy(&endpoint->cond);
 	TRASH(endpoint);
 	return 0;
 }
 
+/**
+ * Append a chain of messages linked via cmsg::fifo to the
+ * endpoint queue. May be called by any number of producers
+ * concurrently.
+ *
+ * @retval true if the chain was appended to the stub, i.e.
+ * the consumer may have found the queue empty and needs to
+ * be woken up.
+ */
+static inline bool
+cbus_endpoint_push(struct cbus_endpoint *endpoint,
+		   struct stailq_entry *first, struct stailq_entry *last)
+{
+	pm_atomic_store_explicit(&last->next, NULL,
+				 pm_memory_order_relaxed);
+	struct stailq_entry *prev =
+		pm_atomic_exchange_explicit(&endpoint->head, last,
+					    pm_memory_order_acq_rel);
+	/*
+	 * Until this store is done the consumer can't see the
+	 * chain, see cbus_endpoint_fetch().
+	 */
+	pm_atomic_store_explicit(&prev->next, first,
+				 pm_memory_order_release);
+	return prev == &endpoint->stub;
+}
+
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	int spin_count = 0;
+	struct stailq_entry *tail = endpoint->tail;
+	while (true) {
+		struct stailq_entry *next =
+			pm_atomic_load_explicit(&tail->next,
+						pm_memory_order_acquire);
+		if (tail == &endpoint->stub) {
+			/* Skip the stub. */
+			if (next == NULL)
+				break;
+			tail = next;
+			continue;
+		}
+		if (next != NULL) {
+			/*
+			 * The message is not the last in the
+			 * queue, hence no producer refers to it.
+			 */
+			stailq_add_tail(output, tail);
+			tail = next;
+			continue;
+		}
+		if (pm_atomic_load_explicit(&endpoint->head,
+					    pm_memory_order_acquire) == tail) {
+			/*
+			 * This is the last message. Put the stub
+			 * after it so that it can be taken out.
+			 */
+			cbus_endpoint_push(endpoint, &endpoint->stub,
+					   &endpoint->stub);
+			continue;
+		}
+		/*
+		 * A producer has swapped the head but hasn't
+		 * linked its messages yet. It takes a couple of
+		 * instructions, so spin a bit. If the producer is
+		 * preempted, don't burn CPU: retry on the next
+		 * event loop iteration.
+		 */
+		if (++spin_count > CBUS_FETCH_SPIN_MAX) {
+			ev_async_send(endpoint->consumer, &endpoint->async);
+			break;
+		}
+	}
+	endpoint->tail = tail;
+}
+
+/**
+ * Adjust the cap of the staged input of a pipe to its message
+ * rate: keep the number of flushes per second under
+ * CPIPE_FLUSH_RATE, but flush at least every
+ * CPIPE_MAX_INPUT_MIN messages. Under a light load a consumer
+ * gets messages as soon as a few of them are staged, under a
+ * heavy load it is woken up rarely and gets large batches.
+ */
+static void
+cpipe_tune_max_input(struct cpipe *pipe, double now)
+{
+	double rate = (pipe->n_flushed - pipe->tune_flushed) /
+		      (now - pipe->tune_time);
+	pipe->tune_flushed = pipe->n_flushed;
+	pipe->tune_time = now;
+	/* The pipe is not capped, nothing to tune. */
+	if (pipe->max_input_limit == INT_MAX)
+		return;
+	double max_input = rate / CPIPE_FLUSH_RATE;
+	if (max_input < CPIPE_MAX_INPUT_MIN)
+		max_input = CPIPE_MAX_INPUT_MIN;
+	if (max_input > pipe->max_input_limit)
+		max_input = pipe->max_input_limit;
+	pipe->max_input = max_input;
+}
+
 static void
 cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 {
@@ -230,16 +405,18 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	if (pipe->n_input == 0)
 		return;
 
-	/* Trigger task processing when the queue becomes non-empty. */
-	bool output_was_empty;
-
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	output_was_empty = stailq_empty(&endpoint->output);
 	/** Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
+	bool output_was_empty =
+		cbus_endpoint_push(endpoint, stailq_first(&pipe->input),
+				   stailq_last(&pipe->input));
+	stailq_create(&pipe->input);
 
+	pipe->n_flushes++;
+	pipe->n_flushed += pipe->n_input;
 	pipe->n_input = 0;
+	double now = ev_now(pipe->producer);
+	if (now - pipe->tune_time >= CPIPE_TUNE_PERIOD)
+		cpipe_tune_max_input(pipe, now);
 	if (output_was_empty) {
 		/* Count statistics */
 		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
@@ -121,6 +121,20 @@ struct cpipe {
 	 * latency, while still keeping the bus mutex cold enough).
 	 */
 	int max_input;
+	/**
+	 * The upper bound of max_input set with
+	 * cpipe_set_max_input(). max_input itself is tuned
+	 * within this bound, see cpipe_tune_max_input().
+	 */
+	int max_input_limit;
+	/** The number of times the input was flushed. */
+	int64_t n_flushes;
+	/** The number of flushed messages. */
+	int64_t n_flushed;
+	/** n_flushed as of the last max_input tuning. */
+	int64_t tune_flushed;
+	/** Time of the last max_input tuning. */
+	double tune_time;
 	/**
 	 * Rather than flushing input into the pipe
 	 * whenever a single message or a batch is
@@ -135,6 +149,10 @@ struct cpipe {
 	 * flushed messages.
 	 */
 	struct cbus_endpoint *endpoint;
+	/** Name of the producer cord. */
+	char producer_name[FIBER_NAME_MAX];
+	/** Member of cbus->pipes. */
+	struct rlist in_cbus;
 };
 
 /**
@@ -160,15 +178,16 @@ cpipe_destroy(struct cpipe *pipe);
  * per event loop.
  * Otherwise, the messages flushed once per event loop iteration.
  *
- * @todo: collect bus stats per second and adjust max_input once
- * a second to keep the mutex cold regardless of the message load,
- * while still keeping the latency low if there are few
- * long-to-process messages.
+ * The cap is an upper bound: once a second the actual cap is
+ * adjusted to the message rate of the pipe, so that messages
+ * are delivered with low latency under a light load, and in
+ * large batches, which keep consumer wakeups rare, under a
+ * heavy load.
  */
 static inline void
 cpipe_set_max_input(struct cpipe *pipe, int max_input)
 {
-	pipe->max_input = max_input;
+	pipe->max_input = pipe->max_input_limit = max_input;
 }
 
 /**
@@ -232,6 +251,31 @@ cpipe_push(struct cpipe *pipe, struct cmsg *msg)
 		ev_feed_event(pipe->producer, &pipe->flush_input, EV_CUSTOM);
 }
 
+/** Statistics of a pipe, see cbus_foreach_pipe(). */
+struct cpipe_stat {
+	/** Name of the producer cord. */
+	char producer[FIBER_NAME_MAX];
+	/** Name of the consumer endpoint. */
+	char consumer[FIBER_NAME_MAX];
+	/** Current cap of the staged input. */
+	int max_input;
+	/** The number of flushes of the staged input. */
+	int64_t flushes;
+	/** The number of flushed messages. */
+	int64_t messages;
+};
+
+typedef int (*cpipe_stat_cb)(const struct cpipe_stat *stat, void *cb_ctx);
+
+/**
+ * Invoke a callback for statistics of each pipe on the bus.
+ * The statistics are read without synchronization with the
+ * producers, so the values are approximate. Stops if the
+ * callback returns non-zero and returns the value.
+ */
+int
+cbus_foreach_pipe(cpipe_stat_cb cb, void *cb_ctx);
+
 void
 cbus_init();
 
@@ -246,10 +290,24 @@ struct cbus_endpoint {
 	char name[FIBER_NAME_MAX];
 	/** Member of cbus->endpoints */
 	struct rlist in_cbus;
-	/** The lock around the pipe. */
-	pthread_mutex_t mutex;
-	/** A queue with incoming messages. */
-	struct stailq output;
+	/**
+	 * A lock-free queue with incoming messages: an intrusive
+	 * multi-producer single-consumer queue linked via
+	 * cmsg::fifo. Every pipe connected to the endpoint has a
+	 * single producer, which appends a whole batch of
+	 * flushed messages with one atomic exchange of the head.
+	 * The consumer takes messages from the tail without any
+	 * atomic read-modify-write operations.
+	 */
+	struct stailq_entry *head;
+	/** The oldest message in the queue, used by the consumer. */
+	struct stailq_entry *tail;
+	/**
+	 * A placeholder which is put into the queue by the
+	 * consumer when it becomes empty, so that the last
+	 * message can be taken out of the queue.
+	 */
+	struct stailq_entry stub;
 	/** Consumer cord loop */
 	ev_loop *consumer;
 	/** Async to notify the consumer */
@@ -261,15 +319,11 @@ struct cbus_endpoint {
 };
 
 /**
- * Fetch incomming messages to output
+ * Fetch incomming messages to output. Must be called by the
+ * consumer.
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
 
 /** Initialize the global singleton bus. */
 void
@@ -74,6 +74,7 @@ iobuf_new_mt(struct slab_cache *slabc_out)
 	/* Note: do not allocate memory upfront. */
 	ibuf_create(&iobuf->in, &cord()->slabc, iobuf_readahead);
 	obuf_create(&iobuf->out, slabc_out, iobuf_readahead);
+	stailq_create(&iobuf->out_refs);
 	return iobuf;
 }
 
@@ -93,6 +94,7 @@ iobuf_delete_mt(struct iobuf *iobuf)
 	ibuf_destroy(&iobuf->in);
 	/* Destroyed by the caller. */
 	assert(iobuf->out.pos == 0 && iobuf->out.iov[0].iov_base == NULL);
+	assert(stailq_empty(&iobuf->out_refs));
 	mempool_free(&iobuf_pool, iobuf);
 }
 
@@ -34,6 +34,7 @@
 #include <stdbool.h>
 #include "small/ibuf.h"
 #include "small/obuf.h"
+#include "salad/stailq.h"
 
 struct iobuf
 {
@@ -41,6 +42,13 @@ struct iobuf
 	struct ibuf in;
 	/** Output buffer. */
 	struct obuf out;
+	/**
+	 * Output which is not copied to 'out' but is written
+	 * right from the memory of its owner, ordered by the
+	 * position in 'out' it follows. Maintained by the user
+	 * of the buffer, see iproto.
+	 */
+	struct stailq out_refs;
 };
 
 /**
@@ -83,6 +91,16 @@ iobuf_reset(struct iobuf *iobuf);
 void
 iobuf_reset_mt(struct iobuf *iobuf);
 
+/**
+ * Return true if there is output not written yet, either
+ * in 'out' or referenced from 'out_refs'.
+ */
+static inline bool
+iobuf_has_output(struct iobuf *iobuf)
+{
+	return obuf_used(&iobuf->out) > 0 || !stailq_empty(&iobuf->out_refs);
+}
+
 /** Return true if there is no input and no output and
  * no one has pinned the buffer - i.e. it's safe to
  * destroy it.
@@ -90,7 +108,7 @@ iobuf_reset_mt(struct iobuf *iobuf);
 static inline bool
 iobuf_is_idle(struct iobuf *iobuf)
 {
-	return ibuf_used(&iobuf->in) == 0 && obuf_used(&iobuf->out) == 0;
+	return ibuf_used(&iobuf->in) == 0 && !iobuf_has_output(iobuf);
 }
 
 /**
@@ -51,7 +51,7 @@ bitset_destroy_iter_cb(bitset_pages_t *t, struct bitset_page *page, void *arg)
 {
 	(void) t;
 	struct bitset *bitset = (struct bitset *) arg;
-	bitset_page_destroy(page);
+	bitset_page_destroy(page, bitset->realloc);
 	bitset->realloc(page, 0);
 	return NULL;
 }
@@ -75,8 +75,8 @@ bitset_test(struct bitset *bitset, size_t pos)
 		return false;
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	       BITSET_PAGE_BIT);
+	return bitset_page_test(page, pos - page->first_pos);
 }
 
 int
@@ -89,8 +89,7 @@ bitset_set(struct bitset *bitset, size_t pos)
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
 		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
-		page = bitset->realloc(NULL, size);
+		page = bitset->realloc(NULL, sizeof(*page));
 		if (page == NULL)
 			return -1;
 
@@ -102,15 +101,20 @@ bitset_set(struct bitset *bitset, size_t pos)
 	}
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
-	if (prev) {
-		/* Value has not changed */
-		return 1;
+	       BITSET_PAGE_BIT);
+	int rc = bitset_page_set(page, pos - page->first_pos,
+				 bitset->realloc);
+	if (rc != 0) {
+		/* Value has not changed, drop a page created in vain */
+		if (rc < 0 && page->cardinality == 0) {
+			bitset_pages_remove(&bitset->pages, page);
+			bitset_page_destroy(page, bitset->realloc);
+			bitset->realloc(page, 0);
+		}
+		return rc;
 	}
 
 	bitset->cardinality++;
-	page->cardinality++;
 
 	return 0;
 }
@@ -127,28 +131,41 @@ bitset_clear(struct bitset *bitset, size_t pos)
 		return 0;
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
-		return 0;
+	       BITSET_PAGE_BIT);
+	int rc = bitset_page_clear(page, pos - page->first_pos,
+				   bitset->realloc);
+	if (rc <= 0) {
+		return rc;
 	}
 
 	assert(bitset->cardinality > 0);
-	assert(page->cardinality > 0);
 	bitset->cardinality--;
-	page->cardinality--;
 
 	if (page->cardinality == 0) {
 		/* Remove the page from the pages tree */
 		bitset_pages_remove(&bitset->pages, page);
 		/* Free the page */
-		bitset_page_destroy(page);
+		bitset_page_destroy(page, bitset->realloc);
 		bitset->realloc(page, 0);
 	}
 
 	return 1;
 }
 
+int
+bitset_reserve_clear(struct bitset *bitset, size_t pos)
+{
+	struct bitset_page key;
+	key.first_pos = bitset_page_first_pos(pos);
+
+	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
+	if (page == NULL)
+		return 0;
+
+	return bitset_page_reserve_clear(page, pos - page->first_pos,
+					 bitset->realloc);
+}
+
 extern inline size_t
 bitset_cardinality(const struct bitset *bitset);
 
@@ -157,13 +174,14 @@ bitset_info(struct bitset *bitset, struct bitset_info *info)
 {
 	memset(info, 0, sizeof(*info));
 	info->page_data_size = BITSET_PAGE_DATA_SIZE;
-	info->page_total_size = bitset_page_alloc_size(bitset->realloc);
 	info->page_data_alignment = BITSET_PAGE_DATA_ALIGNMENT;
 
 	size_t cardinality_check = 0;
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		info->pages_by_type[page->type]++;
+		info->mem_size += bitset_page_mem_size(page, bitset->realloc);
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
@@ -182,10 +200,13 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 	fprintf(stream, "Bitset %p\n", bitset);
 	fprintf(stream, "{\n");
-	fprintf(stream, "    " "page_size   = %zu/%zu /* (data / total) */\n",
-		info.page_data_size, info.page_total_size);
+	fprintf(stream, "    " "page_size   = %zu\n", info.page_data_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
-	fprintf(stream, "    " "pages       = %zu\n", info.pages);
+	fprintf(stream, "    " "pages       = %zu "
+		"/* array / bitmap / run = %zu / %zu / %zu */\n", info.pages,
+		info.pages_by_type[BITSET_PAGE_ARRAY],
+		info.pages_by_type[BITSET_PAGE_BITMAP],
+		info.pages_by_type[BITSET_PAGE_RUN]);
 
 
 	size_t cardinality = bitset_cardinality(bitset);
@@ -204,10 +225,8 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "    "
 			"utilization = undefined\n");
 	}
-	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_total = info.mem_size;
 
-	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
 		"/* data + padding + tree */\n", mem_total);
 	if (cardinality > 0) {
@@ -228,8 +247,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 	for (struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	     page != NULL; page = bitset_pages_next(&bitset->pages, page)) {
 
-		size_t page_last_pos = page->first_pos
-				+ BITSET_PAGE_DATA_SIZE * CHAR_BIT;
+		size_t page_last_pos = page->first_pos + BITSET_PAGE_BIT;
 
 		fprintf(stream, "        " "[%zu, %zu) ",
 			page->first_pos, page_last_pos);
@@ -246,12 +264,9 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "vals = {");
 
-		size_t pos = 0;
-		struct bit_iterator it;
-		bit_iterator_init(&it, bitset_page_data(page),
-			      BITSET_PAGE_DATA_SIZE, true);
-		while ( (pos = bit_iterator_next(&it)) != SIZE_MAX) {
-			fprintf(stream, "%zu, ", page->first_pos + pos);
+		for (size_t pos = 0; pos < PAGE_BIT; pos++) {
+			if (bitset_page_test(page, pos))
+				fprintf(stream, "%zu, ", page->first_pos + pos);
 		}
 
 		fprintf(stream, "}\n");
@@ -66,11 +66,32 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 /** @cond false */
+/**
+ * A page stores bits of a fixed range of positions in one of
+ * the container formats, whichever takes less memory.
+ */
+enum bitset_page_type {
+	/** A sorted array of uint16_t offsets of set bits. */
+	BITSET_PAGE_ARRAY,
+	/** An uncompressed bitmap. */
+	BITSET_PAGE_BITMAP,
+	/** A sorted array of runs of consecutive set bits. */
+	BITSET_PAGE_RUN,
+	bitset_page_type_MAX
+};
+
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
 	size_t cardinality;
-	uint8_t data[0];
+	/** Container format, enum bitset_page_type. */
+	uint32_t type;
+	/** The number of entries in an array or a run page. */
+	uint32_t size;
+	/** The number of allocated entries. */
+	uint32_t capacity;
+	/** Container data, see bitset_page_data(). */
+	void *mem;
 };
 
 typedef rb_tree(struct bitset_page) bitset_pages_t;
@@ -134,6 +155,17 @@ bitset_set(struct bitset *bitset, size_t pos);
 int
 bitset_clear(struct bitset *bitset, size_t pos);
 
+/**
+ * @brief Allocate memory needed to clear bit \a pos in \a bitset,
+ * so that the following bitset_clear() of the bit can't fail.
+ * @param bitset bitset
+ * @param pos bit number
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int
+bitset_reserve_clear(struct bitset *bitset, size_t pos);
+
 /**
  * @brief Return the number of bits set to \a true in \a bitset.
  * @param bitset bitset
@@ -151,12 +183,14 @@ bitset_cardinality(const struct bitset *bitset) {
 struct bitset_info {
 	/** Number of allocated pages */
 	size_t pages;
-	/** Data (payload) size of one page (in bytes) */
+	/** Number of pages of each container type */
+	size_t pages_by_type[bitset_page_type_MAX];
+	/** Data (payload) size of one bitmap page (in bytes) */
 	size_t page_data_size;
-	/** Full size of one page (in bytes, including padding and tree data) */
-	size_t page_total_size;
 	/** A multiplier by which an address of page data is aligned **/
 	size_t page_data_alignment;
+	/** Memory used by all pages, including headers (in bytes) */
+	size_t mem_size;
 };
 
 /**
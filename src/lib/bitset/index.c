@@ -198,6 +198,9 @@ bitset_index_insert(struct bitset_index *index, const void *key,
 rollback:
 	/*
 	 * Rollback changes done by Step 2.
+	 *
+	 * bitset_clear can't fail here: a bit that has just been
+	 * set never splits a run when it is cleared back.
 	 */
 	bit_iterator_init(&bit_it, key, size, true);
 	size_t rpos;
@@ -223,22 +226,39 @@ rollback:
 	return -1;
 }
 
-void
+int
 bitset_index_remove_value(struct bitset_index *index, size_t value)
 {
 	assert(index != NULL);
 
 	if (index->capacity == 0)
-		return;
+		return 0;
+
+	/*
+	 * Clearing a bit may split a run of bits, which needs
+	 * memory. Reserve it in all bitsets first, so that the
+	 * value is either removed completely or not at all.
+	 */
+	for (size_t b = 0; b < index->capacity; b++) {
+		if (index->bitsets[b] == NULL)
+			continue;
+
+		if (bitset_reserve_clear(index->bitsets[b], value) != 0)
+			return -1;
+	}
 
 	for (size_t b = 1; b < index->capacity; b++) {
 		if (index->bitsets[b] == NULL)
 			continue;
 
-		/* Ignore all errors here */
-		bitset_clear(index->bitsets[b], value);
+		int rc = bitset_clear(index->bitsets[b], value);
+		assert(rc >= 0);
+		(void) rc;
 	}
-	bitset_clear(index->bitsets[0], value);
+	int rc = bitset_clear(index->bitsets[0], value);
+	assert(rc >= 0);
+	(void) rc;
+	return 0;
 }
 
 bool
@@ -393,7 +413,7 @@ bitset_index_bsize(const struct bitset_index *index)
 			continue;
 		struct bitset_info info;
 		bitset_info(index->bitsets[b], &info);
-		result += info.page_total_size * info.pages;
+		result += info.mem_size;
 	}
 	return result;
 }
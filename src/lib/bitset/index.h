@@ -173,10 +173,14 @@ bitset_index_insert(struct bitset_index *index, const void *key, size_t key_size
 
 /**
  * @brief Remove a pair with \a value (*, \a value) from \a index.
+ * This method is atomic, i.e. \a index is left intact in case
+ * of error.
  * @param index bitset index
  * @param value value
+ * @retval 0 on success
+ * @retval -1 on memory error
  */
-void
+int
 bitset_index_remove_value(struct bitset_index *index, size_t value);
 
 /**
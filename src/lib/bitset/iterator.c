@@ -82,12 +82,12 @@ bitset_iterator_destroy(struct bitset_iterator *it)
 	}
 
 	if (it->page != NULL) {
-		bitset_page_destroy(it->page);
+		bitset_page_destroy(it->page, it->realloc);
 		it->realloc(it->page, 0);
 	}
 
 	if (it->page_tmp != NULL) {
-		bitset_page_destroy(it->page_tmp);
+		bitset_page_destroy(it->page_tmp, it->realloc);
 		it->realloc(it->page_tmp, 0);
 	}
 
@@ -183,25 +183,30 @@ bitset_iterator_init(struct bitset_iterator *it, struct bitset_expr *expr,
 		assert(p_bitsets != NULL);
 	}
 
-	size_t page_alloc_size = bitset_page_alloc_size(it->realloc);
-	if (it->page != NULL) {
-		bitset_page_destroy(it->page);
-	} else {
-		it->page = it->realloc(NULL, page_alloc_size);
+	/* The result pages are bitmaps, they are reused */
+	if (it->page == NULL) {
+		it->page = it->realloc(NULL, sizeof(*it->page));
+		if (it->page == NULL)
+			return -1;
+		if (bitset_page_create_bitmap(it->page, it->realloc) != 0) {
+			it->realloc(it->page, 0);
+			it->page = NULL;
+			return -1;
+		}
 	}
 
-	bitset_page_create(it->page);
-
-	if (it->page_tmp != NULL) {
-		bitset_page_destroy(it->page_tmp);
-	} else {
-		it->page_tmp = it->realloc(NULL, page_alloc_size);
+	if (it->page_tmp == NULL) {
+		it->page_tmp = it->realloc(NULL, sizeof(*it->page_tmp));
 		if (it->page_tmp == NULL)
 			return -1;
+		if (bitset_page_create_bitmap(it->page_tmp,
+					      it->realloc) != 0) {
+			it->realloc(it->page_tmp, 0);
+			it->page_tmp = NULL;
+			return -1;
+		}
 	}
 
-	bitset_page_create(it->page_tmp);
-
 	if (bitset_iterator_reserve(it, expr->size) != 0)
 		return -1;
 
@@ -235,7 +240,7 @@ static void
 bitset_iterator_conj_rewind(struct bitset_iterator_conj *conj, size_t pos)
 {
 	assert(conj != NULL);
-	assert(pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT) == 0);
+	assert(pos % BITSET_PAGE_BIT == 0);
 	assert(conj->page_first_pos <= pos);
 
 	if (conj->size == 0) {
@@ -305,13 +310,26 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 	assert(conj->size > 0);
 	assert(conj->page_first_pos != SIZE_MAX);
 
-	bitset_page_set_ones(dst);
+	/*
+	 * Start with the first non-negated page instead of ones,
+	 * to save a pass over the result.
+	 */
+	bool is_first = true;
 	for (size_t b = 0; b < conj->size; b++) {
-		if (!conj->pre_nots[b]) {
-			/* conj->pages[b] is rewinded to conj->page_first_pos */
-			assert(conj->pages[b]->first_pos == conj->page_first_pos);
+		if (conj->pre_nots[b])
+			continue;
+		/* conj->pages[b] is rewinded to conj->page_first_pos */
+		assert(conj->pages[b]->first_pos == conj->page_first_pos);
+		if (is_first)
+			bitset_page_copy(dst, conj->pages[b]);
+		else
 			bitset_page_and(dst, conj->pages[b]);
-		} else {
+		is_first = false;
+	}
+	if (is_first)
+		bitset_page_set_ones(dst);
+	for (size_t b = 0; b < conj->size; b++) {
+		if (conj->pre_nots[b]) {
 			/*
 			 * If page is NULL or its position is not equal
 			 * to conj->page_first_pos then conj->bitset[b]
@@ -335,7 +353,6 @@ bitset_iterator_prepare_page(struct bitset_iterator *it)
 	qsort(it->conjs, it->size, sizeof(*it->conjs),
 	      bitset_iterator_conj_cmp);
 
-	bitset_page_set_zeros(it->page);
 	if (it->size > 0) {
 		it->page->first_pos = it->conjs[0].page_first_pos;
 	} else {
@@ -346,8 +363,11 @@ bitset_iterator_prepare_page(struct bitset_iterator *it)
 	if (it->page->first_pos == SIZE_MAX)
 		return;
 
-	/* For each conj where conj->page_first_pos == pos */
-	for (size_t c = 0; c < it->size; c++) {
+	/* The first conj is evaluated right into the result page */
+	bitset_iterator_conj_prepare_page(&it->conjs[0], it->page);
+
+	/* For each other conj where conj->page_first_pos == pos */
+	for (size_t c = 1; c < it->size; c++) {
 		if (it->conjs[c].page_first_pos > it->page->first_pos)
 			break;
 
@@ -381,7 +401,7 @@ bitset_iterator_next_page(struct bitset_iterator *it)
 {
 	assert(it != NULL);
 
-	size_t PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT;
+	size_t PAGE_BIT = BITSET_PAGE_BIT;
 	size_t pos = it->page->first_pos;
 
 	/* Rewind all conjunctions that at the current position to the
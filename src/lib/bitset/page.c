@@ -42,7 +42,8 @@ extern inline void
 bitset_page_create(struct bitset_page *page);
 
 extern inline void
-bitset_page_destroy(struct bitset_page *page);
+bitset_page_destroy(struct bitset_page *page,
+		    void *(*realloc_arg)(void *ptr, size_t size));
 
 extern inline size_t
 bitset_page_first_pos(size_t pos);
@@ -54,23 +55,679 @@ extern inline void
 bitset_page_set_ones(struct bitset_page *page);
 
 extern inline void
-bitset_page_and(struct bitset_page *dst, struct bitset_page *src);
+bitset_page_or(struct bitset_page *dst, struct bitset_page *src);
 
-extern inline void
-bitset_page_nand(struct bitset_page *dst, struct bitset_page *src);
+enum { BITMAP_WORDS = BITSET_PAGE_DATA_SIZE / sizeof(uint64_t) };
 
-extern inline void
-bitset_page_or(struct bitset_page *dst, struct bitset_page *src);
+/** Set bits [from, to) of a bitmap */
+static void
+bitmap_set_range(uint64_t *words, uint32_t from, uint32_t to)
+{
+	if (from >= to)
+		return;
+	uint32_t first = from / 64;
+	uint32_t last = (to - 1) / 64;
+	uint64_t first_mask = UINT64_MAX << (from % 64);
+	uint64_t last_mask = UINT64_MAX >> (63 - (to - 1) % 64);
+	if (first == last) {
+		words[first] |= first_mask & last_mask;
+		return;
+	}
+	words[first] |= first_mask;
+	for (uint32_t i = first + 1; i < last; i++)
+		words[i] = UINT64_MAX;
+	words[last] |= last_mask;
+}
+
+/** Clear bits [from, to) of a bitmap */
+static void
+bitmap_clear_range(uint64_t *words, uint32_t from, uint32_t to)
+{
+	if (from >= to)
+		return;
+	uint32_t first = from / 64;
+	uint32_t last = (to - 1) / 64;
+	uint64_t first_mask = UINT64_MAX << (from % 64);
+	uint64_t last_mask = UINT64_MAX >> (63 - (to - 1) % 64);
+	if (first == last) {
+		words[first] &= ~(first_mask & last_mask);
+		return;
+	}
+	words[first] &= ~first_mask;
+	for (uint32_t i = first + 1; i < last; i++)
+		words[i] = 0;
+	words[last] &= ~last_mask;
+}
+
+/** Return the index of the first entry of @a array >= @a pos */
+static uint32_t
+array_lower_bound(const uint16_t *array, uint32_t size, uint32_t pos)
+{
+	uint32_t begin = 0, end = size;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (array[mid] < pos)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+/** Return the number of runs of @a runs starting at or before @a pos */
+static uint32_t
+run_upper_bound(const struct bitset_run *runs, uint32_t size, uint32_t pos)
+{
+	uint32_t begin = 0, end = size;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (runs[mid].start <= pos)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+static inline uint32_t
+run_end(const struct bitset_run *run)
+{
+	return (uint32_t) run->start + run->length;
+}
+
+/**
+ * Make room for at least @a capacity entries of @a entry_size
+ * bytes in an array or a run page.
+ */
+static int
+page_reserve(struct bitset_page *page, uint32_t capacity, size_t entry_size,
+	     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	if (capacity <= page->capacity)
+		return 0;
+	uint32_t new_capacity = page->capacity > 0 ?
+				page->capacity : BITSET_PAGE_MIN_CAPACITY;
+	while (new_capacity < capacity)
+		new_capacity *= 2;
+	void *mem = realloc_arg(page->mem, new_capacity * entry_size);
+	if (mem == NULL)
+		return -1;
+	page->mem = mem;
+	page->capacity = new_capacity;
+	return 0;
+}
+
+/** Return the number of runs of consecutive set bits of a page */
+static uint32_t
+page_count_runs(struct bitset_page *page)
+{
+	switch (page->type) {
+	case BITSET_PAGE_ARRAY: {
+		const uint16_t *array = (const uint16_t *) page->mem;
+		uint32_t runs = page->size > 0 ? 1 : 0;
+		for (uint32_t i = 1; i < page->size; i++) {
+			if (array[i] != array[i - 1] + 1)
+				runs++;
+		}
+		return runs;
+	}
+	case BITSET_PAGE_BITMAP: {
+		/* Count the bits which follow a cleared bit. */
+		const uint64_t *words =
+			(const uint64_t *) bitset_page_data(page);
+		uint32_t runs = 0;
+		uint64_t carry = 0;
+		for (uint32_t i = 0; i < BITMAP_WORDS; i++) {
+			uint64_t w = words[i];
+			runs += bit_count_u64(w & ~((w << 1) | carry));
+			carry = w >> 63;
+		}
+		return runs;
+	}
+	case BITSET_PAGE_RUN:
+		return page->size;
+	default:
+		unreachable();
+	}
+	return 0;
+}
+
+/**
+ * Append a position to a run page being built, its capacity
+ * must suffice.
+ */
+static inline void
+runs_append(struct bitset_page *page, uint32_t pos)
+{
+	struct bitset_run *runs = (struct bitset_run *) page->mem;
+	if (page->size > 0 && run_end(&runs[page->size - 1]) + 1 == pos) {
+		runs[page->size - 1].length++;
+		return;
+	}
+	assert(page->size < page->capacity);
+	runs[page->size].start = pos;
+	runs[page->size].length = 0;
+	page->size++;
+}
+
+/**
+ * Rebuild a page in the container format @a type. The new data
+ * is built aside, so the page is left intact on memory error.
+ */
+static int
+page_convert(struct bitset_page *page, enum bitset_page_type type,
+	     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(page->type != type);
+	struct bitset_page dst;
+	bitset_page_create(&dst);
+	switch (type) {
+	case BITSET_PAGE_BITMAP:
+		if (bitset_page_create_bitmap(&dst, realloc_arg) != 0)
+			return -1;
+		bitset_page_copy(&dst, page);
+		break;
+	case BITSET_PAGE_ARRAY: {
+		assert(page->cardinality <= BITSET_PAGE_ARRAY_MAX);
+		if (page_reserve(&dst, page->cardinality, sizeof(uint16_t),
+				 realloc_arg) != 0)
+			return -1;
+		uint16_t *array = (uint16_t *) dst.mem;
+		if (page->type == BITSET_PAGE_BITMAP) {
+			struct bit_iterator it;
+			bit_iterator_init(&it, bitset_page_data(page),
+					  BITSET_PAGE_DATA_SIZE, true);
+			size_t pos;
+			while ((pos = bit_iterator_next(&it)) != SIZE_MAX)
+				array[dst.size++] = pos;
+		} else {
+			assert(page->type == BITSET_PAGE_RUN);
+			const struct bitset_run *runs =
+				(const struct bitset_run *) page->mem;
+			for (uint32_t i = 0; i < page->size; i++) {
+				for (uint32_t pos = runs[i].start;
+				     pos <= run_end(&runs[i]); pos++)
+					array[dst.size++] = pos;
+			}
+		}
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		dst.type = BITSET_PAGE_RUN;
+		/*
+		 * Reserve a spare run, so that the bit whose setting
+		 * triggered the conversion can be cleared back even
+		 * if it glued two runs together.
+		 */
+		if (page_reserve(&dst, page_count_runs(page) + 1,
+				 sizeof(struct bitset_run), realloc_arg) != 0)
+			return -1;
+		if (page->type == BITSET_PAGE_BITMAP) {
+			struct bit_iterator it;
+			bit_iterator_init(&it, bitset_page_data(page),
+					  BITSET_PAGE_DATA_SIZE, true);
+			size_t pos;
+			while ((pos = bit_iterator_next(&it)) != SIZE_MAX)
+				runs_append(&dst, pos);
+		} else {
+			assert(page->type == BITSET_PAGE_ARRAY);
+			const uint16_t *array = (const uint16_t *) page->mem;
+			for (uint32_t i = 0; i < page->size; i++)
+				runs_append(&dst, array[i]);
+		}
+		break;
+	}
+	default:
+		unreachable();
+	}
+	assert(dst.type == type);
+	bitset_page_destroy(page, realloc_arg);
+	page->type = dst.type;
+	page->size = dst.size;
+	page->capacity = dst.capacity;
+	page->mem = dst.mem;
+	return 0;
+}
+
+/** Data size of a page in each of the container formats */
+static size_t
+page_data_size(struct bitset_page *page, enum bitset_page_type type,
+	       uint32_t runs)
+{
+	switch (type) {
+	case BITSET_PAGE_ARRAY:
+		if (page->cardinality > BITSET_PAGE_ARRAY_MAX)
+			return SIZE_MAX;
+		return page->cardinality * sizeof(uint16_t);
+	case BITSET_PAGE_BITMAP:
+		return BITSET_PAGE_DATA_SIZE;
+	case BITSET_PAGE_RUN:
+		return runs * sizeof(struct bitset_run);
+	default:
+		unreachable();
+	}
+	return SIZE_MAX;
+}
+
+/**
+ * Convert a page to the most compact container format. Is
+ * called when the page grows or shrinks considerably, so that
+ * the cost of counting runs is amortized.
+ */
+static int
+page_optimize(struct bitset_page *page,
+	      void *(*realloc_arg)(void *ptr, size_t size))
+{
+	uint32_t runs = page_count_runs(page);
+	enum bitset_page_type best = (enum bitset_page_type) page->type;
+	size_t best_size = page_data_size(page, best, runs);
+	for (int type = 0; type < bitset_page_type_MAX; type++) {
+		size_t size = page_data_size(page,
+				(enum bitset_page_type) type, runs);
+		if (size < best_size) {
+			best = (enum bitset_page_type) type;
+			best_size = size;
+		}
+	}
+	if (best == page->type)
+		return 0;
+	return page_convert(page, best, realloc_arg);
+}
+
+/**
+ * Return true if the cardinality of a page has just dropped
+ * to a power of two, which is when a page is checked for a
+ * more compact format on clear.
+ */
+static inline bool
+page_is_shrunk(struct bitset_page *page)
+{
+	size_t cardinality = page->cardinality;
+	return cardinality > 0 && cardinality <= BITSET_PAGE_ARRAY_MAX &&
+	       (cardinality & (cardinality - 1)) == 0;
+}
+
+int
+bitset_page_create_bitmap(struct bitset_page *page,
+			  void *(*realloc_arg)(void *ptr, size_t size))
+{
+	bitset_page_create(page);
+	page->mem = realloc_arg(NULL, bitset_page_alloc_size(realloc_arg));
+	if (page->mem == NULL)
+		return -1;
+	page->type = BITSET_PAGE_BITMAP;
+	bitset_page_set_zeros(page);
+	return 0;
+}
+
+bool
+bitset_page_test(struct bitset_page *page, size_t pos)
+{
+	assert(pos < BITSET_PAGE_BIT);
+	switch (page->type) {
+	case BITSET_PAGE_ARRAY: {
+		const uint16_t *array = (const uint16_t *) page->mem;
+		uint32_t i = array_lower_bound(array, page->size, pos);
+		return i < page->size && array[i] == pos;
+	}
+	case BITSET_PAGE_BITMAP:
+		return bit_test(bitset_page_data(page), pos);
+	case BITSET_PAGE_RUN: {
+		const struct bitset_run *runs =
+			(const struct bitset_run *) page->mem;
+		uint32_t i = run_upper_bound(runs, page->size, pos);
+		return i > 0 && pos <= run_end(&runs[i - 1]);
+	}
+	default:
+		unreachable();
+	}
+	return false;
+}
+
+int
+bitset_page_set(struct bitset_page *page, size_t pos,
+		void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(pos < BITSET_PAGE_BIT);
+	switch (page->type) {
+	case BITSET_PAGE_ARRAY: {
+		uint16_t *array = (uint16_t *) page->mem;
+		uint32_t i = array_lower_bound(array, page->size, pos);
+		if (i < page->size && array[i] == pos)
+			return 1;
+		if (page->size == BITSET_PAGE_ARRAY_MAX) {
+			/* The array can't grow any more. */
+			if (page_convert(page, BITSET_PAGE_BITMAP,
+					 realloc_arg) != 0)
+				return -1;
+			return bitset_page_set(page, pos, realloc_arg);
+		}
+		uint32_t capacity = page->capacity;
+		if (page_reserve(page, page->size + 1, sizeof(uint16_t),
+				 realloc_arg) != 0)
+			return -1;
+		array = (uint16_t *) page->mem;
+		memmove(array + i + 1, array + i,
+			(page->size - i) * sizeof(*array));
+		array[i] = pos;
+		page->size++;
+		page->cardinality++;
+		if (page->capacity != capacity)
+			page_optimize(page, realloc_arg);
+		return 0;
+	}
+	case BITSET_PAGE_BITMAP:
+		if (bit_set(bitset_page_data(page), pos))
+			return 1;
+		page->cardinality++;
+		if (page->cardinality % BITSET_PAGE_ARRAY_MAX == 0)
+			page_optimize(page, realloc_arg);
+		return 0;
+	case BITSET_PAGE_RUN: {
+		struct bitset_run *runs = (struct bitset_run *) page->mem;
+		uint32_t i = run_upper_bound(runs, page->size, pos);
+		if (i > 0 && pos <= run_end(&runs[i - 1]))
+			return 1;
+		bool join_prev = i > 0 && run_end(&runs[i - 1]) + 1 == pos;
+		bool join_next = i < page->size && runs[i].start == pos + 1;
+		if (join_prev && join_next) {
+			/* The bit glues two runs together. */
+			runs[i - 1].length += runs[i].length + 2;
+			memmove(runs + i, runs + i + 1,
+				(page->size - i - 1) * sizeof(*runs));
+			page->size--;
+		} else if (join_prev) {
+			runs[i - 1].length++;
+		} else if (join_next) {
+			runs[i].start--;
+			runs[i].length++;
+		} else {
+			uint32_t capacity = page->capacity;
+			if (page_reserve(page, page->size + 1,
+					 sizeof(*runs), realloc_arg) != 0)
+				return -1;
+			runs = (struct bitset_run *) page->mem;
+			memmove(runs + i + 1, runs + i,
+				(page->size - i) * sizeof(*runs));
+			runs[i].start = pos;
+			runs[i].length = 0;
+			page->size++;
+			page->cardinality++;
+			if (page->capacity != capacity)
+				page_optimize(page, realloc_arg);
+			return 0;
+		}
+		page->cardinality++;
+		return 0;
+	}
+	default:
+		unreachable();
+	}
+	return -1;
+}
+
+int
+bitset_page_clear(struct bitset_page *page, size_t pos,
+		  void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(pos < BITSET_PAGE_BIT);
+	switch (page->type) {
+	case BITSET_PAGE_ARRAY: {
+		uint16_t *array = (uint16_t *) page->mem;
+		uint32_t i = array_lower_bound(array, page->size, pos);
+		if (i == page->size || array[i] != pos)
+			return 0;
+		memmove(array + i, array + i + 1,
+			(page->size - i - 1) * sizeof(*array));
+		page->size--;
+		page->cardinality--;
+		if (page->size > 0 &&
+		    page->size * 4 <= page->capacity &&
+		    page->capacity > BITSET_PAGE_MIN_CAPACITY) {
+			/* Shrink the array, ignore failures. */
+			void *mem = realloc_arg(page->mem, page->capacity / 2 *
+						sizeof(*array));
+			if (mem != NULL) {
+				page->mem = mem;
+				page->capacity /= 2;
+			}
+		}
+		return 1;
+	}
+	case BITSET_PAGE_BITMAP:
+		if (!bit_clear(bitset_page_data(page), pos))
+			return 0;
+		page->cardinality--;
+		if (page_is_shrunk(page))
+			page_optimize(page, realloc_arg);
+		return 1;
+	case BITSET_PAGE_RUN: {
+		struct bitset_run *runs = (struct bitset_run *) page->mem;
+		uint32_t i = run_upper_bound(runs, page->size, pos);
+		if (i == 0 || pos > run_end(&runs[i - 1]))
+			return 0;
+		struct bitset_run *run = &runs[i - 1];
+		uint32_t end = run_end(run);
+		if (run->length == 0) {
+			memmove(runs + i - 1, runs + i,
+				(page->size - i) * sizeof(*runs));
+			page->size--;
+		} else if (pos == run->start) {
+			run->start++;
+			run->length--;
+		} else if (pos == end) {
+			run->length--;
+		} else {
+			/* The bit splits the run in two. */
+			uint32_t capacity = page->capacity;
+			if (page_reserve(page, page->size + 1,
+					 sizeof(*runs), realloc_arg) != 0)
+				return -1;
+			runs = (struct bitset_run *) page->mem;
+			run = &runs[i - 1];
+			memmove(runs + i + 1, runs + i,
+				(page->size - i) * sizeof(*runs));
+			runs[i].start = pos + 1;
+			runs[i].length = end - pos - 1;
+			run->length = pos - run->start - 1;
+			page->size++;
+			page->cardinality--;
+			if (page->capacity != capacity)
+				page_optimize(page, realloc_arg);
+			return 1;
+		}
+		page->cardinality--;
+		if (page_is_shrunk(page))
+			page_optimize(page, realloc_arg);
+		return 1;
+	}
+	default:
+		unreachable();
+	}
+	return -1;
+}
+
+int
+bitset_page_reserve_clear(struct bitset_page *page, size_t pos,
+			  void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(pos < BITSET_PAGE_BIT);
+	/* Only splitting a run needs memory. */
+	if (page->type != BITSET_PAGE_RUN)
+		return 0;
+	const struct bitset_run *runs = (const struct bitset_run *) page->mem;
+	uint32_t i = run_upper_bound(runs, page->size, pos);
+	if (i == 0 || pos <= runs[i - 1].start || pos >= run_end(&runs[i - 1]))
+		return 0;
+	return page_reserve(page, page->size + 1, sizeof(*runs), realloc_arg);
+}
+
+size_t
+bitset_page_mem_size(struct bitset_page *page,
+		     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	size_t size = sizeof(*page);
+	switch (page->type) {
+	case BITSET_PAGE_ARRAY:
+		return size + page->capacity * sizeof(uint16_t);
+	case BITSET_PAGE_BITMAP:
+		return size + bitset_page_alloc_size(realloc_arg);
+	case BITSET_PAGE_RUN:
+		return size + page->capacity * sizeof(struct bitset_run);
+	default:
+		unreachable();
+	}
+	return size;
+}
+
+void
+bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
+{
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	switch (src->type) {
+	case BITSET_PAGE_BITMAP: {
+		bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+		bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+
+		assert(BITSET_PAGE_DATA_SIZE % (4 * sizeof(bitset_word_t)) == 0);
+		int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
+		for (int i = 0; i < cnt; i += 4) {
+			d[i] &= s[i];
+			d[i + 1] &= s[i + 1];
+			d[i + 2] &= s[i + 2];
+			d[i + 3] &= s[i + 3];
+		}
+		break;
+	}
+	case BITSET_PAGE_ARRAY: {
+		/*
+		 * Mask each word with the bits of the array which
+		 * fall into it, words without any are cleared.
+		 */
+		uint64_t *d = (uint64_t *) bitset_page_data(dst);
+		const uint16_t *array = (const uint16_t *) src->mem;
+		uint32_t i = 0;
+		for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+			uint64_t mask = 0;
+			for (; i < src->size && array[i] / 64 == w; i++)
+				mask |= (uint64_t) 1 << (array[i] % 64);
+			d[w] &= mask;
+		}
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		/* Clear the gaps between the runs. */
+		uint64_t *d = (uint64_t *) bitset_page_data(dst);
+		const struct bitset_run *runs =
+			(const struct bitset_run *) src->mem;
+		uint32_t gap_start = 0;
+		for (uint32_t i = 0; i < src->size; i++) {
+			bitmap_clear_range(d, gap_start, runs[i].start);
+			gap_start = run_end(&runs[i]) + 1;
+		}
+		bitmap_clear_range(d, gap_start, BITSET_PAGE_BIT);
+		break;
+	}
+	default:
+		unreachable();
+	}
+}
+
+void
+bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
+{
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	switch (src->type) {
+	case BITSET_PAGE_BITMAP: {
+		bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+		bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+
+		assert(BITSET_PAGE_DATA_SIZE % (4 * sizeof(bitset_word_t)) == 0);
+		int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
+		for (int i = 0; i < cnt; i += 4) {
+			d[i] &= ~s[i];
+			d[i + 1] &= ~s[i + 1];
+			d[i + 2] &= ~s[i + 2];
+			d[i + 3] &= ~s[i + 3];
+		}
+		break;
+	}
+	case BITSET_PAGE_ARRAY: {
+		void *d = bitset_page_data(dst);
+		const uint16_t *array = (const uint16_t *) src->mem;
+		for (uint32_t i = 0; i < src->size; i++)
+			bit_clear(d, array[i]);
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		uint64_t *d = (uint64_t *) bitset_page_data(dst);
+		const struct bitset_run *runs =
+			(const struct bitset_run *) src->mem;
+		for (uint32_t i = 0; i < src->size; i++)
+			bitmap_clear_range(d, runs[i].start,
+					   run_end(&runs[i]) + 1);
+		break;
+	}
+	default:
+		unreachable();
+	}
+}
+
+void
+bitset_page_copy(struct bitset_page *dst, struct bitset_page *src)
+{
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	switch (src->type) {
+	case BITSET_PAGE_BITMAP:
+		memcpy(bitset_page_data(dst), bitset_page_data(src),
+		       BITSET_PAGE_DATA_SIZE);
+		break;
+	case BITSET_PAGE_ARRAY: {
+		bitset_page_set_zeros(dst);
+		void *d = bitset_page_data(dst);
+		const uint16_t *array = (const uint16_t *) src->mem;
+		for (uint32_t i = 0; i < src->size; i++)
+			bit_set(d, array[i]);
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		bitset_page_set_zeros(dst);
+		uint64_t *d = (uint64_t *) bitset_page_data(dst);
+		const struct bitset_run *runs =
+			(const struct bitset_run *) src->mem;
+		for (uint32_t i = 0; i < src->size; i++)
+			bitmap_set_range(d, runs[i].start,
+					 run_end(&runs[i]) + 1);
+		break;
+	}
+	default:
+		unreachable();
+	}
+}
 
 #if defined(DEBUG)
 void
 bitset_page_dump(struct bitset_page *page, FILE *stream)
 {
-	fprintf(stream, "Page %zu:\n", page->first_pos);
-	char *d = bitset_page_data(page);
-	for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
-		fprintf(stream, "%x ", *d);
-		d++;
+	static const char *type_strs[] = { "array", "bitmap", "run" };
+	fprintf(stream, "Page %zu (%s):\n", page->first_pos,
+		type_strs[page->type]);
+	if (page->type == BITSET_PAGE_BITMAP) {
+		char *d = bitset_page_data(page);
+		for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
+			fprintf(stream, "%x ", *d);
+			d++;
+		}
+	} else if (page->type == BITSET_PAGE_ARRAY) {
+		const uint16_t *array = (const uint16_t *) page->mem;
+		for (uint32_t i = 0; i < page->size; i++)
+			fprintf(stream, "%u ", (unsigned) array[i]);
+	} else {
+		const struct bitset_run *runs =
+			(const struct bitset_run *) page->mem;
+		for (uint32_t i = 0; i < page->size; i++)
+			fprintf(stream, "[%u, %u] ", (unsigned) runs[i].start,
+				(unsigned) run_end(&runs[i]));
 	}
 	fprintf(stream, "\n--\n");
 }
@@ -54,8 +54,26 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 enum {
-	/** How many bytes to store in one page */
-	BITSET_PAGE_DATA_SIZE = 160
+	/** How many bytes to store in one bitmap page */
+	BITSET_PAGE_DATA_SIZE = 8192,
+	/** How many positions one page covers */
+	BITSET_PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT,
+	/**
+	 * The max number of positions in an array page. A bigger
+	 * array would take more memory than a bitmap.
+	 */
+	BITSET_PAGE_ARRAY_MAX = BITSET_PAGE_DATA_SIZE / sizeof(uint16_t),
+	/** The initial number of entries in an array or a run page */
+	BITSET_PAGE_MIN_CAPACITY = 4,
+};
+
+/**
+ * A run of consecutive set bits [start, start + length] of a
+ * run page.
+ */
+struct bitset_run {
+	uint16_t start;
+	uint16_t length;
 };
 
 #if defined(ENABLE_AVX)
@@ -88,54 +106,121 @@ typedef uint32_t bitset_word_t;
 #define MALLOC_ALIGNMENT 8
 #endif /* aligned malloc */
 
+/** Size of memory to allocate for data of a bitmap page */
 inline size_t
 bitset_page_alloc_size(void *(*realloc_arg)(void *ptr, size_t size))
 {
 	if (BITSET_PAGE_DATA_ALIGNMENT <= 1 || (
 		(MALLOC_ALIGNMENT % BITSET_PAGE_DATA_ALIGNMENT == 0) &&
-		(sizeof(struct bitset_page) % BITSET_PAGE_DATA_ALIGNMENT == 0) &&
 		(realloc_arg == realloc))) {
 
 		/* Alignment is not needed */
-		return sizeof(struct bitset_page) + BITSET_PAGE_DATA_SIZE;
+		return BITSET_PAGE_DATA_SIZE;
 	}
 
-	return sizeof(struct bitset_page) + BITSET_PAGE_DATA_SIZE +
-			BITSET_PAGE_DATA_ALIGNMENT;
+	return BITSET_PAGE_DATA_SIZE + BITSET_PAGE_DATA_ALIGNMENT;
 }
 
 #undef MALLOC_ALIGNMENT
 
+/**
+ * Return the data of a page: the bitmap of a bitmap page,
+ * an array of uint16_t of an array page or an array of
+ * struct bitset_run of a run page.
+ */
 inline void *
 bitset_page_data(struct bitset_page *page)
 {
-	uintptr_t r = (uintptr_t) (page->data + BITSET_PAGE_DATA_ALIGNMENT - 1);
+	if (page->type != BITSET_PAGE_BITMAP)
+		return page->mem;
+	uintptr_t r = (uintptr_t) ((char *) page->mem +
+				   BITSET_PAGE_DATA_ALIGNMENT - 1);
 	return (void *) (r & ~((uintptr_t) BITSET_PAGE_DATA_ALIGNMENT - 1));
 }
 
+/** Create an empty array page */
 inline void
 bitset_page_create(struct bitset_page *page)
 {
-	size_t size = ((char *) bitset_page_data(page) - (char *) page)
-			+ BITSET_PAGE_DATA_SIZE;
-	memset(page, 0, size);
+	memset(page, 0, sizeof(*page));
+	page->type = BITSET_PAGE_ARRAY;
 }
 
 inline void
-bitset_page_destroy(struct bitset_page *page)
+bitset_page_destroy(struct bitset_page *page,
+		    void *(*realloc_arg)(void *ptr, size_t size))
 {
-	(void) page;
-	/* nothing */
+	if (page->mem != NULL)
+		realloc_arg(page->mem, 0);
+	page->mem = NULL;
 }
 
 inline size_t
 bitset_page_first_pos(size_t pos) {
-	return pos - (pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT));
+	return pos - (pos % BITSET_PAGE_BIT);
 }
 
+/**
+ * Create a bitmap page with all bits cleared.
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int
+bitset_page_create_bitmap(struct bitset_page *page,
+			  void *(*realloc_arg)(void *ptr, size_t size));
+
+/** Test bit @a pos of @a page, counting from page->first_pos */
+bool
+bitset_page_test(struct bitset_page *page, size_t pos);
+
+/**
+ * Set bit @a pos of @a page, counting from page->first_pos.
+ * The page may change its type.
+ * @retval 1 if the bit was already set
+ * @retval 0 if the bit was not set
+ * @retval -1 on memory error
+ */
+int
+bitset_page_set(struct bitset_page *page, size_t pos,
+		void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Clear bit @a pos of @a page, counting from page->first_pos.
+ * The page may change its type.
+ * @retval 1 if the bit was set
+ * @retval 0 if the bit was not set
+ * @retval -1 on memory error, which is only possible when the
+ *         bit splits a run, see bitset_page_reserve_clear()
+ */
+int
+bitset_page_clear(struct bitset_page *page, size_t pos,
+		  void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Allocate memory needed to clear bit @a pos of @a page, so
+ * that the following bitset_page_clear() can't fail.
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int
+bitset_page_reserve_clear(struct bitset_page *page, size_t pos,
+			  void *(*realloc_arg)(void *ptr, size_t size));
+
+/** Memory used by a page, including the header */
+size_t
+bitset_page_mem_size(struct bitset_page *page,
+		     void *(*realloc_arg)(void *ptr, size_t size));
+
+/*
+ * Operations on the data of bitmap pages, which are used by
+ * the iterator to evaluate expressions. @a src of bitset_page_and(),
+ * bitset_page_nand() and bitset_page_copy() may be of any type.
+ */
+
 inline void
 bitset_page_set_zeros(struct bitset_page *page)
 {
+	assert(page->type == BITSET_PAGE_BITMAP);
 	void *data = bitset_page_data(page);
 	memset(data, 0, BITSET_PAGE_DATA_SIZE);
 }
@@ -143,48 +228,41 @@ bitset_page_set_zeros(struct bitset_page *page)
 inline void
 bitset_page_set_ones(struct bitset_page *page)
 {
+	assert(page->type == BITSET_PAGE_BITMAP);
 	void *data = bitset_page_data(page);
 	memset(data, -1, BITSET_PAGE_DATA_SIZE);
 }
 
+/** dst |= src, both pages are bitmaps */
 inline void
-bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
+bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(dst->type == BITSET_PAGE_BITMAP);
+	assert(src->type == BITSET_PAGE_BITMAP);
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
-	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
+	assert(BITSET_PAGE_DATA_SIZE % (4 * sizeof(bitset_word_t)) == 0);
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
-	for (int i = 0; i < cnt; i++) {
-		*d++ &= *s++;
+	for (int i = 0; i < cnt; i += 4) {
+		d[i] |= s[i];
+		d[i + 1] |= s[i + 1];
+		d[i + 2] |= s[i + 2];
+		d[i + 3] |= s[i + 3];
 	}
 }
 
-inline void
-bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
-{
-	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
-
-	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
-	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
-	for (int i = 0; i < cnt; i++) {
-		*d++ &= ~*s++;
-	}
-}
+/** dst &= src */
+void
+bitset_page_and(struct bitset_page *dst, struct bitset_page *src);
 
-inline void
-bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
-{
-	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+/** dst &= ~src */
+void
+bitset_page_nand(struct bitset_page *dst, struct bitset_page *src);
 
-	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
-	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
-	for (int i = 0; i < cnt; i++) {
-		*d++ |= *s++;
-	}
-}
+/** dst = src */
+void
+bitset_page_copy(struct bitset_page *dst, struct bitset_page *src);
 
 #if defined(DEBUG)
 void
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "rtree.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
@@ -65,6 +66,18 @@ struct rtree_page {
 	struct rtree_page_branch data[];
 };
 
+/* A record or a page being packed by rtree_build_end() */
+struct rtree_build_item {
+	/* Sort key, doubled center of the rectangle along an axis */
+	coord_t key;
+	union {
+		/* Branch in build_buf to pack */
+		struct rtree_page_branch *branch;
+		/* Packed page */
+		struct rtree_page *page;
+	} data;
+};
+
 struct rtree_neighbor_page {
 	struct rtree_neighbor_page* next;
 	struct rtree_neighbor buf[];
@@ -716,6 +729,219 @@ rtree_page_purge(struct rtree *tree, struct rtree_page *page, int level)
 	rtree_page_free(tree, page);
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load */
+/*------------------------------------------------------------------------- */
+
+static struct rtree_page_branch *
+rtree_build_branch(const struct rtree *tree, size_t i)
+{
+	return (struct rtree_page_branch *)
+		(tree->build_buf + i * tree->page_branch_size);
+}
+
+static void
+rtree_build_free(struct rtree *tree)
+{
+	free(tree->build_buf);
+	free(tree->build_items);
+	tree->build_buf = NULL;
+	tree->build_items = NULL;
+	tree->build_count = 0;
+	tree->build_alloc = 0;
+}
+
+int
+rtree_build_reserve(struct rtree *tree, size_t count)
+{
+	if (count <= tree->build_alloc)
+		return 0;
+	char *buf = (char *)realloc(tree->build_buf,
+				    count * tree->page_branch_size);
+	if (buf == NULL)
+		return -1;
+	tree->build_buf = buf;
+	struct rtree_build_item *items = (struct rtree_build_item *)
+		realloc(tree->build_items, count * sizeof(*items));
+	if (items == NULL)
+		return -1;
+	tree->build_items = items;
+	tree->build_alloc = count;
+	return 0;
+}
+
+int
+rtree_build_add(struct rtree *tree, const struct rtree_rect *rect,
+		record_t obj)
+{
+	assert(tree->root == NULL);
+	if (tree->build_count == tree->build_alloc &&
+	    rtree_build_reserve(tree, tree->build_alloc < 1024 ? 1024 :
+				tree->build_alloc + tree->build_alloc / 2) != 0)
+		return -1;
+	struct rtree_page_branch *b =
+		rtree_build_branch(tree, tree->build_count++);
+	b->data.record = obj;
+	rtree_rect_copy(&b->rect, rect, tree->dimension);
+	return 0;
+}
+
+/* Number of pages needed to pack count branches */
+static size_t
+rtree_build_page_count(const struct rtree *tree, size_t count)
+{
+	return (count + tree->page_max_fill - 1) / tree->page_max_fill;
+}
+
+/*
+ * Make sure that all pages of the tree being built can be
+ * taken from the free list, so that a failure of the extent
+ * allocator can't happen in the middle of the build. New pages
+ * are put to the free list right away and are not lost if the
+ * allocator throws.
+ */
+static void
+rtree_build_reserve_pages(struct rtree *tree, size_t count)
+{
+	size_t need = 0;
+	do {
+		count = rtree_build_page_count(tree, count);
+		need += count;
+	} while (count > 1);
+	for (void *p = tree->free_pages; p != NULL && need > 0;
+	     p = *(void **)p)
+		need--;
+	for (; need > 0; need--) {
+		uint32_t unused_id;
+		rtree_page_free(tree, (struct rtree_page *)
+				matras_alloc(&tree->mtab, &unused_id));
+	}
+}
+
+static int
+rtree_build_item_cmp(const void *a, const void *b)
+{
+	coord_t ka = ((const struct rtree_build_item *)a)->key;
+	coord_t kb = ((const struct rtree_build_item *)b)->key;
+	return ka < kb ? -1 : ka > kb;
+}
+
+/* The least s such that s ^ power >= count */
+static size_t
+rtree_build_root(size_t count, unsigned power)
+{
+	if (power == 1)
+		return count;
+	size_t s = 1;
+	while (true) {
+		size_t p = 1;
+		for (unsigned i = 0; i < power && p < count; i++)
+			p *= s;
+		if (p >= count)
+			return s;
+		s++;
+	}
+}
+
+/*
+ * Order items so that consecutive runs of page_max_fill of them
+ * make pages that tile the space: sort by the axis, cut into
+ * slices and order every slice by the remaining axes.
+ */
+static void
+rtree_build_tile(const struct rtree *tree, struct rtree_build_item *items,
+		 size_t count, unsigned axis)
+{
+	for (size_t i = 0; i < count; i++) {
+		const struct rtree_rect *rect = &items[i].data.branch->rect;
+		items[i].key = rect->coords[axis * 2] +
+			       rect->coords[axis * 2 + 1];
+	}
+	qsort(items, count, sizeof(*items), rtree_build_item_cmp);
+	if (axis + 1 == tree->dimension)
+		return;
+	size_t pages = rtree_build_page_count(tree, count);
+	size_t slices = rtree_build_root(pages, tree->dimension - axis);
+	size_t slice_size = (pages + slices - 1) / slices *
+			    tree->page_max_fill;
+	for (size_t i = 0; i < count; i += slice_size) {
+		size_t n = count - i < slice_size ? count - i : slice_size;
+		rtree_build_tile(tree, items + i, n, axis + 1);
+	}
+}
+
+/*
+ * Pack branches of items into full pages in order. The last
+ * two pages share the rest evenly if it would leave the last
+ * one less than min filled. Items are replaced with the pages.
+ * Returns the number of pages.
+ */
+static size_t
+rtree_build_pack(struct rtree *tree, struct rtree_build_item *items,
+		 size_t count)
+{
+	size_t n_pages = 0;
+	for (size_t i = 0; i < count; ) {
+		size_t n = count - i;
+		if (n > tree->page_max_fill) {
+			n = n - tree->page_max_fill < tree->page_min_fill ?
+			    n / 2 : tree->page_max_fill;
+		}
+		struct rtree_page *page = rtree_page_alloc(tree);
+		page->n = n;
+		for (unsigned j = 0; j < n; j++) {
+			rtree_branch_copy(rtree_branch_get(tree, page, j),
+					  items[i + j].data.branch,
+					  tree->dimension);
+		}
+		/* n_pages <= i, the item has been copied already */
+		items[n_pages++].data.page = page;
+		tree->n_pages++;
+		i += n;
+	}
+	return n_pages;
+}
+
+void
+rtree_build_end(struct rtree *tree)
+{
+	assert(tree->root == NULL);
+	size_t count = tree->build_count;
+	if (count == 0) {
+		rtree_build_free(tree);
+		return;
+	}
+	rtree_build_reserve_pages(tree, count);
+	struct rtree_build_item *items = tree->build_items;
+	for (size_t i = 0; i < count; i++)
+		items[i].data.branch = rtree_build_branch(tree, i);
+	unsigned height = 0;
+	while (true) {
+		rtree_build_tile(tree, items, count, 0);
+		count = rtree_build_pack(tree, items, count);
+		height++;
+		if (count == 1)
+			break;
+		/*
+		 * All branches of the level are copied, reuse
+		 * build_buf for the branches of the next one.
+		 */
+		for (size_t i = 0; i < count; i++) {
+			struct rtree_page_branch *b =
+				rtree_build_branch(tree, i);
+			b->data.page = items[i].data.page;
+			rtree_page_cover(tree, b->data.page, &b->rect);
+			items[i].data.branch = b;
+		}
+	}
+	assert(height <= RTREE_MAX_HEIGHT);
+	tree->root = items[0].data.page;
+	tree->height = height;
+	tree->n_records = tree->build_count;
+	tree->version++;
+	rtree_build_free(tree);
+}
+
 /*------------------------------------------------------------------------- */
 /* R-tree iterator methods */
 /*------------------------------------------------------------------------- */
@@ -951,6 +1177,10 @@ rtree_init(struct rtree *tree, unsigned dimension, uint32_t extent_size,
 	tree->version = 0;
 	tree->n_pages = 0;
 	tree->free_pages = 0;
+	tree->build_buf = NULL;
+	tree->build_items = NULL;
+	tree->build_count = 0;
+	tree->build_alloc = 0;
 
 	tree->dimension = dimension;
 	tree->distance_type = distance_type;
@@ -1136,6 +1366,7 @@ rtree_purge(struct rtree *tree)
 		tree->n_pages = 0;
 		tree->height = 0;
 	}
+	rtree_build_free(tree);
 }
 
 size_t
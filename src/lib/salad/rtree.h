@@ -152,6 +152,14 @@ struct rtree
 	void *free_pages;
 	/* Distance type */
 	enum rtree_distance_type distance_type;
+	/* Records added by rtree_build_add(), stored as leaf branches */
+	char *build_buf;
+	/* Sort keys of the records in build_buf, see rtree_build_end() */
+	struct rtree_build_item *build_items;
+	/* Number of records in build_buf */
+	size_t build_count;
+	/* Number of records build_buf can hold */
+	size_t build_alloc;
 };
 
 /* Struct for iteration and retrieving rtree values */
@@ -275,6 +283,37 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Reserve memory for records added with rtree_build_add()
+ * @param tree - pointer to a tree
+ * @param count - expected number of records
+ * @return 0 on success, -1 on memory error
+ */
+int
+rtree_build_reserve(struct rtree *tree, size_t count);
+
+/**
+ * @brief Add a record to the bulk load of an empty tree. The
+ * record is not searchable until rtree_build_end() is called.
+ * @param tree - pointer to a tree
+ * @param rect - rectangle of the record
+ * @param obj - record to add
+ * @return 0 on success, -1 on memory error
+ */
+int
+rtree_build_add(struct rtree *tree, const struct rtree_rect *rect,
+		record_t obj);
+
+/**
+ * @brief Build the tree of records added with rtree_build_add().
+ * The records are packed into full pages level by level with
+ * Sort-Tile-Recursive algorithm, which is much faster than
+ * inserting them one by one and gives pages with less overlap.
+ * @param tree - pointer to an empty tree
+ */
+void
+rtree_build_end(struct rtree *tree);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
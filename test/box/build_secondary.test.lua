@@ -0,0 +1,29 @@
+test_run = require('test_run').new()
+
+--
+-- Secondary indexes of a big space are built at recovery
+-- with TREE indexes sorted in coeio threads.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk1', {parts = {2, 'unsigned'}})
+_ = s:create_index('sk2', {type = 'hash', parts = {3, 'string'}})
+_ = s:create_index('sk3', {parts = {4, 'unsigned'}, unique = false})
+for i = 1, 20000 do s:insert{i, 20001 - i, tostring(i), i % 7} end
+box.snapshot()
+for i = 20001, 20100 do s:insert{i, i, tostring(i), i % 7} end
+
+test_run:cmd('restart server default')
+s = box.space.test
+s.index.sk1:count()
+s.index.sk2:count()
+s.index.sk3:count()
+s.index.sk1:min()
+s.index.sk1:max()
+s.index.sk2:get{'12345'}
+s.index.sk3:count(3)
+prev = 0
+ordered = true
+for _, t in s.index.sk1:pairs() do if t[2] <= prev then ordered = false end prev = t[2] end
+ordered
+s:drop()
@@ -0,0 +1,31 @@
+test_run = require('test_run').new()
+
+--
+-- Connections are distributed among several network threads.
+--
+test_run:cmd("create server iproto_threads with script='box/iproto_threads.lua'")
+test_run:cmd("start server iproto_threads")
+test_run:cmd("switch iproto_threads")
+box.cfg.iproto_threads
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+test_run:cmd("switch default")
+
+net_box = require('net.box')
+uri = test_run:eval('iproto_threads', 'return box.cfg.listen')[1]
+conns = {}
+for i = 1, 10 do conns[i] = net_box.connect(uri) end
+for i = 1, 10 do conns[i].space.test:replace{i} end
+for i = 1, 10 do assert(conns[i].space.test:get(i)[1] == i) end
+conns[1].space.test:count()
+for i = 1, 10 do conns[i]:close() end
+
+-- Statistics are summed up over all threads.
+test_run:cmd("switch iproto_threads")
+box.stat.net.SENT.total > 0
+box.stat.net.RECEIVED.total > 0
+s:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server iproto_threads")
+test_run:cmd("cleanup server iproto_threads")
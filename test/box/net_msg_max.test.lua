@@ -0,0 +1,79 @@
+test_run = require('test_run').new()
+
+--
+-- The limit of requests in flight is configurable.
+--
+box.cfg.net_msg_max
+old_net_msg_max = box.cfg.net_msg_max
+box.cfg{net_msg_max = 1}
+box.cfg.net_msg_max
+box.cfg{net_msg_max = 64}
+box.cfg.net_msg_max
+
+--
+-- A connection which exceeds its share of the limit is
+-- throttled, but is served until the end.
+--
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+function slow_replace(i) fiber.sleep(0.01) return s:replace{i} end
+box.schema.func.create('slow_replace')
+box.schema.user.grant('guest', 'execute', 'function', 'slow_replace')
+net_box = require('net.box')
+conn = net_box.connect(box.cfg.listen)
+throttles = box.stat.net.INPUT_THROTTLES.total
+finished = 0
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 200 do
+    fiber.create(function()
+        conn:call('slow_replace', {i})
+        finished = finished + 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+while finished < 200 do fiber.sleep(0.01) end
+s:count()
+box.stat.net.INPUT_THROTTLES.total > throttles
+box.stat.net.INPUT_STOPS ~= nil
+box.stat.net.INPUT_STOP_MS ~= nil
+box.stat.net.INPUT_THROTTLE_MS ~= nil
+conn:close()
+s:drop()
+box.schema.func.drop('slow_replace')
+box.cfg{net_msg_max = old_net_msg_max}
+
+--
+-- The limit set at startup is in effect at once.
+--
+test_run:cmd("create server net_msg_max with script='box/net_msg_max.lua'")
+test_run:cmd("start server net_msg_max")
+test_run:cmd("switch net_msg_max")
+box.cfg.net_msg_max
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+function slow_replace(i) fiber.sleep(0.01) return s:replace{i} end
+box.schema.func.create('slow_replace')
+box.schema.user.grant('guest', 'execute', 'function', 'slow_replace')
+test_run:cmd("switch default")
+uri = test_run:eval('net_msg_max', 'return box.cfg.listen')[1]
+conn = net_box.connect(uri)
+finished = 0
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 20 do
+    fiber.create(function()
+        conn:call('slow_replace', {i})
+        finished = finished + 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+while finished < 20 do fiber.sleep(0.01) end
+conn:close()
+test_run:cmd("switch net_msg_max")
+s:count()
+-- A connection's quota is half of the limit.
+box.stat.net.INPUT_THROTTLES.total > 0
+test_run:cmd("switch default")
+test_run:cmd("stop server net_msg_max")
+test_run:cmd("cleanup server net_msg_max")
@@ -0,0 +1,58 @@
+net_box = require('net.box')
+digest = require('digest')
+
+--
+-- Large tuples of a SELECT reply are written to the socket
+-- right from the tuple memory rather than copied to the output
+-- buffer. Check that such replies are not garbled.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.schema.user.grant('guest', 'read', 'space', 'test')
+-- small and large tuples interleaved
+for i = 1, 300 do s:insert{i, string.rep(digest.base64_encode(tostring(i)), i % 3 == 0 and 10 or i * 10)} end
+conn = net_box.connect(box.cfg.listen)
+
+function check(res, from, to) if #res ~= to - from + 1 then return false end for i = from, to do if res[i - from + 1][2] ~= s:get{i}[2] then return false end end return true end
+check(conn.space.test:select(), 1, 300)
+check(conn.space.test:select({100}, {iterator = 'GE', limit = 50}), 100, 149)
+check(conn.space.test:select({300}), 300, 300)
+
+-- pipelined replies share the output buffer
+fiber = require('fiber')
+ch = fiber.channel(10)
+for i = 1, 10 do fiber.create(function() ch:put(check(conn.space.test:select(), 1, 300)) end) end
+ok = true
+for i = 1, 10 do ok = ok and ch:get() end
+ok
+
+--
+-- A reply which ends with a tuple larger than the socket buffer
+-- is written in parts: the rest of the tuple must be sent once
+-- the socket is writable, without waiting for another reply.
+-- The client shrinks its receive buffer and doesn't read the
+-- reply for a while to make sure the write is partial.
+--
+msgpack = require('msgpack')
+socket = require('socket')
+big = string.rep('x', 900 * 1024)
+_ = s:replace{301, big}
+LISTEN = require('uri').parse(box.cfg.listen)
+sock = socket.tcp_connect(LISTEN.host, LISTEN.service)
+greeting = sock:read(128)
+_ = sock:setsockopt('SOL_SOCKET', 'SO_RCVBUF', 4096)
+header = msgpack.encode({[0x00] = 1, [0x01] = 1})
+body = msgpack.encode({[0x10] = s.id, [0x11] = 0, [0x12] = 2, [0x13] = 0, [0x14] = 5, [0x20] = {300}})
+_ = sock:write(msgpack.encode(#header + #body) .. header .. body)
+fiber.sleep(0.1)
+len = msgpack.decode(sock:read(5, 10))
+reply = sock:read(len, 10)
+#reply == len
+_, pos = msgpack.decode(reply)
+data = msgpack.decode(reply, pos)[0x30]
+#data == 2 and data[1][1] == 300 and data[2][1] == 301 and data[2][2] == big
+sock:close()
+
+box.schema.user.revoke('guest', 'read', 'space', 'test')
+conn:close()
+s:drop()
@@ -0,0 +1,149 @@
+fiber = require('fiber')
+
+--
+-- A secondary index of a big memtx space is built online:
+-- the build yields, so the space can be changed meanwhile.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 20000 do s:insert{i, i} end
+box.info.memtx()
+
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+stop = false
+done = false
+changes = 0
+progress = nil
+function dml()
+    while not stop do
+        local build = box.info.memtx().build['test.sk']
+        if build ~= nil then
+            progress = build
+            changes = changes + 1
+        end
+        local k = math.random(22000)
+        if k % 3 == 0 then
+            s:delete{k}
+        else
+            s:replace{k, -k}
+        end
+        fiber.sleep(0)
+    end
+    done = true
+end;
+test_run:cmd("setopt delimiter ''");
+
+_ = fiber.create(dml)
+_ = s:create_index('sk', {parts = {2, 'integer'}})
+stop = true
+while not done do fiber.sleep(0.01) end
+
+changes > 0
+progress.total == 20000
+progress.done > 0
+box.info.memtx()
+
+-- The new index is consistent with the primary key.
+s.index.sk:count() == s:count()
+bad = 0
+for _, t in s.index.sk:pairs() do local o = s:get(t[1]) if o == nil or o[2] ~= t[2] then bad = bad + 1 end end
+bad
+
+s:drop()
+
+--
+-- A transaction which changes the space during the build and is
+-- rolled back leaves no trace in the new index, even if it
+-- changes the same key several times.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 20000 do s:insert{i, i} end
+test_run:cmd("setopt delimiter ';'")
+stop = false
+done = false
+rolled_back = 0
+function rollback_dml()
+    while not stop do
+        if box.info.memtx().build['test.sk'] ~= nil then
+            box.begin()
+            for k = 1, 20000, 997 do
+                s:replace{k, -k}
+                s:replace{k, -k - 100000}
+                s:delete{k}
+            end
+            box.rollback()
+            rolled_back = rolled_back + 1
+        end
+        fiber.sleep(0)
+    end
+    done = true
+end;
+test_run:cmd("setopt delimiter ''");
+
+_ = fiber.create(rollback_dml)
+_ = s:create_index('sk', {parts = {2, 'integer'}})
+stop = true
+while not done do fiber.sleep(0.01) end
+
+rolled_back > 0
+s.index.sk:count() == 20000
+bad = 0
+for _, t in s.index.sk:pairs() do if t[1] ~= t[2] then bad = bad + 1 end end
+bad
+
+s:drop()
+
+--
+-- A statement which fails after the build has applied its change
+-- to the new index, or fails to apply it, is rolled back in the
+-- new index too, while the rest of the transaction commits.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 20000 do s:insert{i, i} end
+function fail_trigger(old, new) if new ~= nil and new[3] == 'fail' then error('fail') end end
+_ = s:on_replace(fail_trigger)
+test_run:cmd("setopt delimiter ';'")
+stop = false
+done = false
+failed = 0
+function fail_dml()
+    while not stop do
+        local build = box.info.memtx().build['test.sk']
+        if build ~= nil and build.done > 10 then
+            box.begin()
+            s:replace{3, -3}
+            if not pcall(s.replace, s, {4, -4, 'fail'}) then
+                failed = failed + 1
+            end
+            if not pcall(s.replace, s, {5, -3}) then
+                failed = failed + 1
+            end
+            box.commit()
+            if not pcall(s.replace, s, {6, -3}) then
+                failed = failed + 1
+            end
+        end
+        fiber.sleep(0)
+    end
+    done = true
+end;
+test_run:cmd("setopt delimiter ''");
+
+_ = fiber.create(fail_dml)
+_ = s:create_index('sk', {parts = {2, 'integer'}})
+stop = true
+while not done do fiber.sleep(0.01) end
+
+failed > 0
+s:get{4}
+s:get{5}
+s:get{6}
+s.index.sk:count() == s:count()
+bad = 0
+for _, t in s.index.sk:pairs() do local o = s:get(t[1]) if o == nil or o[2] ~= t[2] then bad = bad + 1 end end
+bad
+
+s:drop()
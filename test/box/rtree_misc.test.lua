@@ -245,3 +245,15 @@ i:select({0, 0, 0}, {iterator = 'neighbor'})
 i:select({1, 2, 3, 4, 5, 6}, {iterator = 'BITS_ALL_SET' } )
 
 s:drop()
+
+-- an index built in one go, e.g. over a HASH primary key, is bulk loaded
+s = box.schema.space.create('bulk')
+_ = s:create_index('pk', {type = 'hash'})
+for i = 1, 1000 do s:insert{i, {i % 100, math.floor(i / 100)}} end
+i = s:create_index('s', {type = 'rtree', unique = false, parts = {2, 'array'}})
+i:count()
+#i:select({0, 0, 9, 9}, {iterator = 'le'})
+s:delete{1}
+s:insert{1001, {5, 5}}
+#i:select({0, 0, 9, 9}, {iterator = 'le'})
+s:drop()
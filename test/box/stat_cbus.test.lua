@@ -0,0 +1,31 @@
+--
+-- box.stat.cbus() reports pipes between threads, their current
+-- cap of staged messages and flush counters.
+--
+test_run = require('test_run').new()
+test_run:cmd("setopt delimiter ';'")
+function find_pipe(producer, consumer)
+    for _, pipe in ipairs(box.stat.cbus()) do
+        if pipe.producer == producer and pipe.consumer == consumer then
+            return pipe
+        end
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- tx -> wal
+old = find_pipe('main', 'wal')
+old ~= nil
+old.max_input >= 4
+old.messages >= old.flushes
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 10 do s:replace{i} end
+new = find_pipe('main', 'wal')
+new.flushes > old.flushes
+new.messages > old.messages
+s:drop()
+
+-- net -> tx
+find_pipe('iproto', 'tx') ~= nil
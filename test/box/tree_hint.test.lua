@@ -0,0 +1,54 @@
+--
+-- TREE index elements store hints of the first key part. Check
+-- that they do not affect the order of tuples.
+--
+function keys(index, key, opts) local r = {} for _, t in index:pairs(key, opts) do table.insert(r, t[1]) end return r end
+
+-- integer keys
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'integer'}})
+_ = s:create_index('nohint', {parts = {1, 'integer'}, hint = false})
+_ = s:insert{tonumber64('18446744073709551615')}
+_ = s:insert{tonumber64('9223372036854775807')}
+_ = s:insert{tonumber64('9223372036854775806')}
+_ = s:insert{tonumber64('-9223372036854775808')}
+_ = s:insert{-100}
+_ = s:insert{-1}
+_ = s:insert{0}
+_ = s:insert{1}
+keys(s.index.pk)
+keys(s.index.pk) == keys(s.index.nohint)
+keys(s.index.pk, -1, {iterator = 'GE'})
+keys(s.index.pk, tonumber64('9223372036854775807'), {iterator = 'LT'})
+keys(s.index.pk, tonumber64('9223372036854775807'), {iterator = 'GE'})
+s.index.pk:get{tonumber64('18446744073709551615')} ~= nil
+s.index.pk:get{tonumber64('9223372036854775807')} ~= nil
+s.index.pk:get{tonumber64('-9223372036854775808')} ~= nil
+s.index.pk:get{-2}
+s:drop()
+
+-- string keys
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'string'}})
+_ = s:create_index('sk', {parts = {2, 'string'}, unique = false})
+_ = s:insert{'abcdefgh', 'b'}
+_ = s:insert{'abcdefghij', 'a'}
+_ = s:insert{'abcdefgha', 'b'}
+_ = s:insert{'abcdefg', 'a'}
+_ = s:insert{'abd', 'b'}
+_ = s:insert{'', 'a'}
+_ = s:insert{'b', 'b'}
+keys(s.index.pk)
+keys(s.index.pk, 'abcdefgh', {iterator = 'GT'})
+keys(s.index.pk, 'abcdefgh', {iterator = 'LE'})
+#keys(s.index.sk, 'a')
+#keys(s.index.sk, 'b', {iterator = 'REQ'})
+
+-- hints can be turned off and on with alter
+s.index.pk:alter{hint = false}
+box.space._index:get{s.id, 0}[5].hint
+keys(s.index.pk)
+s.index.pk:alter{hint = true}
+box.space._index:get{s.id, 0}[5].hint
+keys(s.index.pk, 'abcdefgh', {iterator = 'GT'})
+s:drop()
@@ -0,0 +1,80 @@
+fiber = require('fiber')
+
+--
+-- Truncation of memtx spaces is written to _truncate and
+-- replaces the space with an empty copy.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {type = 'hash'})
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 10000 do s:insert{i, i % 10} end
+t = s:get{1}
+triggered = 0
+_ = s:on_replace(function() triggered = triggered + 1 end)
+
+s:truncate()
+s:len()
+s.index.sk:count()
+box.space._truncate:get{s.id}[2]
+
+-- the space is still usable, triggers are kept
+s:insert{1, 1}
+s.index.sk:select{1}
+triggered
+
+-- tuples referenced from Lua survive freeing of the old data
+for i = 1, 100 do fiber.sleep(0) end
+t
+
+s:truncate()
+s:len()
+box.space._truncate:get{s.id}[2]
+
+-- truncation is DDL and can't be a part of a transaction
+box.begin() s:insert{2, 2} s:truncate()
+box.rollback()
+s:len()
+
+-- spaces without indexes are not truncated
+s2 = box.schema.space.create('test2')
+s2:truncate()
+box.space._truncate:get{s2.id}
+s2:drop()
+
+-- drop removes the record from _truncate
+id = s.id
+s:drop()
+box.space._truncate:get{id}
+
+-- vinyl spaces are truncated by re-creating indexes
+v = box.schema.space.create('test_vinyl', {engine = 'vinyl'})
+_ = v:create_index('pk')
+v:insert{1}
+v:truncate()
+v:select()
+box.space._truncate:get{v.id}
+v:drop()
+
+-- memtx spaces are truncated the old way until the schema
+-- is upgraded to 1.7.5
+version = box.space._schema:get{'version'}
+_ = box.space._schema:replace{'version', 1, 7, 4}
+s = box.schema.space.create('test_old')
+_ = s:create_index('pk')
+s:insert{1}
+s:truncate()
+s:select()
+box.space._truncate:get{s.id}
+_ = box.space._schema:replace(version)
+s:drop()
+
+-- the patch field of the schema version is optional
+_ = box.space._schema:replace{'version', 1, 7}
+s = box.schema.space.create('test_old')
+_ = s:create_index('pk')
+s:insert{1}
+s:truncate()
+s:select()
+box.space._truncate:get{s.id}
+_ = box.space._schema:replace(version)
+s:drop()
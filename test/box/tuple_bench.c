@@ -1,5 +1,6 @@
 #include "module.h"
 
+#include <stdlib.h>
 #include <sys/time.h>
 
 #include <msgpuck.h>
@@ -76,3 +77,105 @@ tuple_bench(box_function_ctx_t *ctx, const char *args, const char *args_end)
 	say_info("%lf\n", t);
 	return 0;
 }
+
+/**
+ * Compare pairs of tuples of a small set with box_tuple_compare()
+ * and log the time. The argument is a list of key parts in the
+ * same format as in index parts: {1, 'integer', 3, 'integer'}.
+ * All fields of the tuples are small unsigned numbers, so a key
+ * with parts of the same type and a key where one of the parts is
+ * 'number' compare the same data with a specialized and with the
+ * generic comparator respectively.
+ */
+int
+tuple_compare_bench(box_function_ctx_t *ctx, const char *args,
+		    const char *args_end)
+{
+	(void) ctx;
+	(void) args_end;
+	enum { TUPLE_COUNT = 1024, FIELD_COUNT = 8, MAX_PARTS = 8 };
+	static const char *type_names[] = {
+		"unsigned", "integer", "number", "scalar"
+	};
+	static const uint32_t types_by_name[] = {
+		FIELD_TYPE_UNSIGNED, FIELD_TYPE_INTEGER,
+		FIELD_TYPE_NUMBER, FIELD_TYPE_SCALAR
+	};
+	const uint32_t type_count = sizeof(type_names) / sizeof(type_names[0]);
+
+	uint32_t arg_count = mp_decode_array(&args);
+	if (arg_count < 1) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"invalid argument count");
+	}
+	uint32_t n = mp_decode_array(&args);
+	if (n % 2 != 0 || n / 2 == 0 || n / 2 > MAX_PARTS) {
+		return box_error_set(__FILE__, __LINE__, ER_PROC_C, "%s",
+			"invalid key parts");
+	}
+	uint32_t part_count = n / 2;
+	uint32_t fields[MAX_PARTS], types[MAX_PARTS];
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (mp_typeof(*args) != MP_UINT) {
+			return box_error_set(__FILE__, __LINE__, ER_PROC_C,
+				"%s", "invalid key parts");
+		}
+		uint64_t fieldno = mp_decode_uint(&args);
+		if (fieldno < 1 || fieldno > FIELD_COUNT ||
+		    mp_typeof(*args) != MP_STR) {
+			return box_error_set(__FILE__, __LINE__, ER_PROC_C,
+				"%s", "invalid key parts");
+		}
+		fields[i] = fieldno - 1;
+		uint32_t len;
+		const char *name = mp_decode_str(&args, &len);
+		uint32_t k = 0;
+		for (; k < type_count; k++) {
+			if (strlen(type_names[k]) == len &&
+			    memcmp(type_names[k], name, len) == 0)
+				break;
+		}
+		if (k == type_count) {
+			return box_error_set(__FILE__, __LINE__, ER_PROC_C,
+				"%s", "only numeric key parts are supported");
+		}
+		types[i] = types_by_name[k];
+	}
+
+	box_key_def_t *key_def = box_key_def_new(fields, types, part_count);
+	if (key_def == NULL)
+		return -1;
+	box_tuple_t *tuples[TUPLE_COUNT];
+	char buf[64];
+	unsigned seed = 1;
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		char *end = mp_encode_array(buf, FIELD_COUNT);
+		/* Few distinct values to make comparisons go deep. */
+		for (int j = 0; j < FIELD_COUNT; j++)
+			end = mp_encode_uint(end, rand_r(&seed) % 2);
+		tuples[i] = box_tuple_new(box_tuple_format_default(),
+					  buf, end);
+		if (tuples[i] == NULL) {
+			while (--i >= 0)
+				box_tuple_unref(tuples[i]);
+			box_key_def_delete(key_def);
+			return -1;
+		}
+		box_tuple_ref(tuples[i]);
+	}
+
+	double t = proctime();
+	int sum = 0;
+	for (int i = 0; i < 50000000; i++) {
+		int a = i % TUPLE_COUNT;
+		int b = (i * 7 + (i >> 10)) % TUPLE_COUNT;
+		sum += box_tuple_compare(tuples[a], tuples[b], key_def);
+	}
+	t = proctime() - t;
+	say_info("tuple_compare_bench: %lf (%d)", t, sum);
+
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		box_tuple_unref(tuples[i]);
+	box_key_def_delete(key_def);
+	return 0;
+}
@@ -29,4 +29,14 @@ prof.stop()
 
 box.schema.func.drop("tuple_bench")
 
+-- Specialized comparators vs the generic one on the same data:
+-- a 'number' part makes the key use the generic comparator.
+box.schema.func.create('tuple_bench.tuple_compare_bench', {language = "C"})
+box.schema.user.grant('guest', 'execute', 'function', 'tuple_bench.tuple_compare_bench')
+c:call('tuple_bench.tuple_compare_bench', {1, 'integer', 2, 'integer', 3, 'integer'})
+c:call('tuple_bench.tuple_compare_bench', {1, 'integer', 2, 'number', 3, 'integer'})
+c:call('tuple_bench.tuple_compare_bench', {2, 'integer', 4, 'integer', 6, 'integer'})
+c:call('tuple_bench.tuple_compare_bench', {2, 'integer', 4, 'number', 6, 'integer'})
+box.schema.func.drop("tuple_bench.tuple_compare_bench")
+
 box.space.tester:drop()
@@ -0,0 +1,44 @@
+test_run = require('test_run')
+inspector = test_run.new()
+engine = inspector:get_cfg('engine')
+
+--
+-- index:get_many() looks up several keys at once.
+--
+space = box.schema.space.create('test', { engine = engine })
+pk = space:create_index('primary', { type = 'tree', parts = {1, 'unsigned'} })
+sk = space:create_index('secondary', { type = 'tree', parts = {2, 'string'} })
+for key = 1, 100 do space:replace({key, tostring(key)}) end
+-- dump the space to disk in vinyl
+box.snapshot()
+for key = 101, 110 do space:replace({key, tostring(key)}) end
+
+-- the result is aligned with keys, missing keys give nil
+t = pk:get_many({5, 1000, 3, 105, 0, 3, {50}})
+t[1]
+t[2] == nil
+t[3]
+t[4]
+t[5] == nil
+t[6]
+t[7]
+space:get_many({1, 2})
+sk:get_many({'7', '107', 'x'})
+pk:get_many({})
+keys = {}
+for key = 1, 200 do keys[key] = 201 - key end
+t = pk:get_many(keys)
+count = 0
+for key = 1, 200 do if t[key] ~= nil then assert(t[key][1] == keys[key]) count = count + 1 end end
+count
+
+-- errors
+pk:get_many(1)
+pk:get_many({'abc'})
+pk:get_many({{1, 2}})
+space:drop()
+space = box.schema.space.create('test')
+pk = space:create_index('primary')
+sk = space:create_index('secondary', { parts = {2, 'unsigned'}, unique = false })
+sk:get_many({1})
+space:drop()
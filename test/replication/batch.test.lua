@@ -0,0 +1,41 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.cfg{replication_batch_size = 0}
+box.cfg{replication_batch_size = 100000}
+box.cfg{replication_batch_size = 100}
+box.cfg.replication_batch_size
+
+test_run:cmd("switch default")
+s = box.schema.space.create('test', {engine = engine})
+index = s:create_index('primary')
+for i = 1, 1000 do s:insert{i, 'batch'} end
+-- DDL can't be applied in a multi-statement transaction,
+-- a batch containing it is applied row by row
+s2 = box.schema.space.create('test2', {engine = engine})
+index2 = s2:create_index('primary')
+for i = 1, 100 do s2:insert{i} end
+for i = 1, 1000, 2 do s:delete{i} end
+
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while box.space.test2 == nil or box.space.test2:count() < 100 do fiber.sleep(0.01) end
+while box.space.test:count() > 500 do fiber.sleep(0.01) end
+master_id = test_run:get_server_id('default')
+box.space.test:count()
+box.space.test:select{10}
+box.space.test:select{11}
+box.space.test2:count()
+box.info.replication[master_id].upstream.status
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+s2:drop()
+box.schema.user.revoke('guest', 'replication')
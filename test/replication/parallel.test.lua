@@ -0,0 +1,87 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.cfg{replication_apply_fibers = 0}
+box.cfg{replication_apply_fibers = 1000}
+box.cfg{replication_batch_size = 100, replication_apply_fibers = 8}
+box.cfg.replication_apply_fibers
+
+test_run:cmd("switch default")
+s = box.schema.space.create('test', {engine = engine})
+index = s:create_index('primary')
+index2 = s:create_index('secondary', {parts = {2, 'unsigned'}})
+for i = 1, 1000 do s:insert{i, i, 0} end
+-- rows of the same key must be applied in order
+for j = 1, 5 do for i = 1, 1000 do s:update(i, {{'=', 3, j}}) end end
+for i = 1, 1000, 2 do s:delete{i} end
+-- secondary keys move between primary keys
+for i = 2, 1000, 2 do s:replace{i, i - 1, 6} end
+
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while box.space.test == nil or box.space.test.index.secondary == nil or box.space.test:get{1000} == nil do fiber.sleep(0.01) end
+while box.space.test:get{1000}[3] ~= 6 do fiber.sleep(0.01) end
+master_id = test_run:get_server_id('default')
+box.space.test:count()
+box.space.test:select{10}
+box.space.test:select{11}
+box.space.test.index.secondary:select{9}
+cnt = 0
+for _, t in box.space.test:pairs() do if t[2] == t[1] - 1 and t[3] == 6 then cnt = cnt + 1 end end
+cnt
+box.info.replication[master_id].upstream.status
+
+-- switch back to serial apply on the fly
+box.cfg{replication_apply_fibers = 1}
+test_run:cmd("switch default")
+for i = 1001, 1100 do s:insert{i, i, 0} end
+test_run:cmd("switch replica")
+while box.space.test:count() < 600 do fiber.sleep(0.01) end
+box.space.test:count()
+box.info.replication[master_id].upstream.status
+
+-- parallel apply commits a batch in a single transaction, like
+-- serial apply does, so it takes as few WAL writes: a commit per
+-- row would take 1000 of them
+test_run:cmd("setopt delimiter ';'")
+function wal_writes()
+    for _, pipe in ipairs(box.stat.cbus()) do
+        if pipe.producer == 'main' and pipe.consumer == 'wal' then
+            return pipe.messages
+        end
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+source = box.cfg.replication
+box.cfg{replication = ''}
+test_run:cmd("switch default")
+for i = 2001, 3000 do s:replace{i, i, 0} end
+test_run:cmd("switch replica")
+writes = wal_writes()
+box.cfg{replication = source}
+while box.space.test:get{3000} == nil do fiber.sleep(0.01) end
+serial_writes = wal_writes() - writes
+box.cfg{replication = ''}
+box.cfg{replication_apply_fibers = 8}
+test_run:cmd("switch default")
+for i = 3001, 4000 do s:replace{i, i, 0} end
+test_run:cmd("switch replica")
+writes = wal_writes()
+box.cfg{replication = source}
+while box.space.test:get{4000} == nil do fiber.sleep(0.01) end
+parallel_writes = wal_writes() - writes
+serial_writes < 200
+parallel_writes < 200
+box.space.test:count()
+box.info.replication[master_id].upstream.status
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -66,6 +66,8 @@ replica.lsn == 0
 replica.upstream == nil
 replica.downstream.vclock[master_id] == box.info.vclock[master_id]
 replica.downstream.vclock[replica_id] == box.info.vclock[replica_id]
+replica.downstream.rows >= replica.downstream.batches
+replica.downstream.flush_latency <= replica.downstream.flush_latency_max
 
 --
 -- Replica
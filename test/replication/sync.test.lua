@@ -0,0 +1,56 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+fiber = require('fiber')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+index = s:create_index('primary')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+replica_id = test_run:get_server_id('replica')
+
+box.cfg{replication_sync_quorum = -1}
+box.cfg{replication_sync_quorum = 32}
+box.cfg{replication_sync_timeout = 0}
+box.info.sync.quorum
+
+-- a transaction returns once the replica has written it
+box.cfg{replication_sync_quorum = 1}
+box.info.sync.quorum
+s:insert{1}
+box.info.replication[replica_id].downstream.ack_lsn >= box.info.lsn
+box.info.sync.confirmed_lsn >= box.info.lsn
+for i = 2, 10 do s:insert{i} end
+box.info.sync.latency[1].count
+box.info.sync.latency[1].max >= box.info.sync.latency[1].p50
+
+-- concurrent transactions wait for the quorum together
+ch = fiber.channel(10)
+for i = 11, 20 do fiber.create(function() s:insert{i} ch:put(true) end) end
+for i = 11, 20 do ch:get() end
+box.info.sync.latency[1].count
+box.info.sync.waiting
+
+test_run:cmd("switch replica")
+box.space.test:count()
+test_run:cmd("switch default")
+
+-- the transaction stays committed if the quorum is not reached
+box.cfg{replication_sync_quorum = 2, replication_sync_timeout = 0.1}
+s:insert{21}
+s:get{21}
+box.info.sync.timeouts
+box.info.sync.waiting
+box.cfg{replication_sync_quorum = 0, replication_sync_timeout = 10}
+s:insert{22}
+
+test_run:cmd("switch replica")
+while box.space.test:count() < 22 do fiber.sleep(0.01) end
+box.space.test:count()
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
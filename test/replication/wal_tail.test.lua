@@ -0,0 +1,34 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+index = s:create_index('primary')
+for i = 1, 100 do s:insert{i} end
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.space.test:count()
+
+test_run:cmd("switch default")
+fiber = require('fiber')
+-- the relay reads the rows written from now on from memory
+while test_run:grep_log('default', 'following the in.memory tail of WAL') == nil do fiber.sleep(0.01) end
+for i = 101, 200 do s:insert{i} end
+s:delete{1}
+s:update({2}, {{'=', 2, 'tail'}})
+
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while box.space.test:count() < 199 or box.space.test:get{2}[2] == nil do fiber.sleep(0.01) end
+box.space.test:count()
+box.space.test:get{1}
+box.space.test:get{2}
+box.space.test:get{200}
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -195,12 +195,147 @@ void test_get_set()
 	footer();
 }
 
+/** Check that bits of [0, size) match @a ref */
+static void
+check_bits(struct bitset *bm, const bool *ref, size_t size)
+{
+	size_t cardinality = 0;
+	for (size_t i = 0; i < size; i++) {
+		fail_unless(bitset_test(bm, i) == ref[i]);
+		cardinality += ref[i];
+	}
+	fail_unless(bitset_cardinality(bm) == cardinality);
+}
+
+static
+void test_containers()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+	struct bitset_info info;
+	bitset_info(&bm, &info);
+	const size_t PAGE_BIT = info.page_data_size * CHAR_BIT;
+	const size_t SIZE = 4 * PAGE_BIT;
+	bool *ref = calloc(SIZE, sizeof(bool));
+	fail_if(ref == NULL);
+
+	printf("Sparse bits are stored in arrays... ");
+	for (size_t i = 0; i < SIZE; i += 97) {
+		fail_if(bitset_set(&bm, i) < 0);
+		ref[i] = true;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 4);
+	fail_unless(info.pages_by_type[BITSET_PAGE_ARRAY] == 4);
+	printf("ok\n");
+
+	printf("Dense random bits are stored in bitmaps... ");
+	for (size_t i = 0; i < SIZE; i++) {
+		ref[i] = rand() % 2;
+		int rc = ref[i] ? bitset_set(&bm, i) : bitset_clear(&bm, i);
+		fail_if(rc < 0);
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_by_type[BITSET_PAGE_BITMAP] == 4);
+	printf("ok\n");
+
+	printf("Ranges of bits are stored in runs... ");
+	for (size_t i = 0; i < SIZE; i++) {
+		ref[i] = i % PAGE_BIT < PAGE_BIT / 3 ||
+			 i % PAGE_BIT > PAGE_BIT / 2;
+		int rc = ref[i] ? bitset_set(&bm, i) : bitset_clear(&bm, i);
+		fail_if(rc < 0);
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_by_type[BITSET_PAGE_RUN] == 4);
+	printf("ok\n");
+
+	printf("Splitting runs... ");
+	for (size_t i = 0; i < SIZE; i += 1000) {
+		fail_if(bitset_clear(&bm, i) < 0);
+		ref[i] = false;
+	}
+	check_bits(&bm, ref, SIZE);
+	printf("ok\n");
+
+	printf("Clearing bits shrinks pages back to arrays... ");
+	for (size_t i = 0; i < SIZE; i++) {
+		if (!ref[i] || i % 500 == 0)
+			continue;
+		fail_if(bitset_clear(&bm, i) < 0);
+		ref[i] = false;
+	}
+	check_bits(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_by_type[BITSET_PAGE_ARRAY] == 4);
+	printf("ok\n");
+
+	free(ref);
+	bitset_destroy(&bm);
+
+	footer();
+}
+
+static bool realloc_fail = false;
+
+static void *
+test_realloc(void *ptr, size_t size)
+{
+	if (realloc_fail && size > 0)
+		return NULL;
+	return realloc(ptr, size);
+}
+
+static
+void test_clear_oom()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, test_realloc);
+	for (size_t i = 0; i < 1000; i++)
+		fail_if(bitset_set(&bm, i) < 0);
+	struct bitset_info info;
+	bitset_info(&bm, &info);
+	fail_unless(info.pages_by_type[BITSET_PAGE_RUN] == 1);
+
+	printf("Splitting runs on memory error... ");
+	size_t pos;
+	realloc_fail = true;
+	for (pos = 1; pos < 1000; pos += 2) {
+		if (bitset_reserve_clear(&bm, pos) != 0)
+			break;
+		fail_unless(bitset_clear(&bm, pos) == 1);
+	}
+	fail_unless(pos < 1000);
+	fail_unless(bitset_test(&bm, pos));
+	realloc_fail = false;
+	fail_if(bitset_reserve_clear(&bm, pos) != 0);
+	realloc_fail = true;
+	fail_unless(bitset_clear(&bm, pos) == 1);
+	realloc_fail = false;
+	for (size_t i = 0; i < 1000; i++)
+		fail_unless(bitset_test(&bm, i) == (i % 2 == 0 || i > pos));
+	printf("ok\n");
+
+	bitset_destroy(&bm);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	srand(time(NULL));
 	test_cardinality();
 	test_get_set();
+	test_containers();
+	test_clear_oom();
 
 	return 0;
 }
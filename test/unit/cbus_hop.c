@@ -0,0 +1,304 @@
+/*
+ * A microbenchmark of message passing between two cords.
+ * It measures throughput (messages per second with many
+ * messages in flight) and hop latency (a single message
+ * bouncing back and forth) of cbus and, for comparison, of a
+ * queue protected by a mutex, which is how cbus used to hand
+ * messages over. Timings are printed to stderr, so that the
+ * test output stays stable.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+#include "clock.h"
+#include "unit.h"
+
+enum {
+	/** Messages sent in the throughput test. */
+	THROUGHPUT_MESSAGES = 1000000,
+	/** Messages in flight in the throughput test. */
+	THROUGHPUT_WINDOW = 256,
+	/** Round trips in the latency test. */
+	LATENCY_ROUND_TRIPS = 100000,
+};
+
+/** Messages bouncing between the main cord and the worker. */
+static struct cmsg messages[THROUGHPUT_WINDOW];
+/** Messages to send in the current test. */
+static int send_count;
+/** Messages sent and received back in the current test. */
+static int sent, received;
+/** The fiber waiting for the current test to end. */
+static struct fiber *bench_fiber;
+
+/** A way to deliver messages to the worker and back. */
+struct transport {
+	const char *name;
+	/** Send a message to the worker. */
+	void (*send)(struct cmsg *msg);
+	/** Deliver sent messages. */
+	void (*flush)(void);
+};
+
+/* {{{ cbus */
+
+/** A pipe from the main cord to the worker, used in main. */
+static struct cpipe worker_pipe;
+/** A pipe from the worker to the main cord, used in worker. */
+static struct cpipe main_pipe;
+
+static void
+worker_hop_f(struct cmsg *msg)
+{
+	(void) msg;
+}
+
+static void
+main_hop_f(struct cmsg *msg);
+
+static const struct cmsg_hop bounce_route[] = {
+	{ worker_hop_f, &main_pipe },
+	{ main_hop_f, NULL },
+};
+
+static void
+cbus_send(struct cmsg *msg)
+{
+	cmsg_init(msg, bounce_route);
+	cpipe_push(&worker_pipe, msg);
+	sent++;
+}
+
+static void
+cbus_flush(void)
+{
+	cpipe_flush_input(&worker_pipe);
+}
+
+static void
+main_hop_f(struct cmsg *msg)
+{
+	received++;
+	if (sent < send_count)
+		cbus_send(msg);
+	else if (received == send_count)
+		fiber_wakeup(bench_fiber);
+}
+
+static void
+main_endpoint_cb(ev_loop *loop, struct ev_watcher *watcher, int events)
+{
+	(void) loop;
+	(void) events;
+	cbus_process((struct cbus_endpoint *) watcher->data);
+}
+
+static const struct transport cbus_transport = {
+	"cbus", cbus_send, cbus_flush
+};
+
+/* }}} cbus */
+
+/* {{{ locked queue */
+
+/**
+ * A queue protected by a mutex. The consumer is woken up
+ * with ev_async when the queue becomes non-empty.
+ */
+struct locked_queue {
+	pthread_mutex_t mutex;
+	struct stailq queue;
+	struct ev_loop *consumer;
+	struct ev_async async;
+};
+
+/** A queue to the worker. */
+static struct locked_queue worker_queue;
+/** A queue to the main cord. */
+static struct locked_queue main_queue;
+/** Messages to push to the worker queue, used in main. */
+static struct stailq main_staged;
+
+static void
+locked_queue_create(struct locked_queue *q,
+		    void (*cb)(ev_loop *, struct ev_async *, int))
+{
+	tt_pthread_mutex_init(&q->mutex, NULL);
+	stailq_create(&q->queue);
+	q->consumer = loop();
+	ev_async_init(&q->async, cb);
+	ev_async_start(q->consumer, &q->async);
+}
+
+static void
+locked_queue_destroy(struct locked_queue *q)
+{
+	ev_async_stop(q->consumer, &q->async);
+	tt_pthread_mutex_destroy(&q->mutex);
+}
+
+static void
+locked_queue_push(struct locked_queue *q, struct stailq *batch)
+{
+	if (stailq_empty(batch))
+		return;
+	tt_pthread_mutex_lock(&q->mutex);
+	bool was_empty = stailq_empty(&q->queue);
+	stailq_concat(&q->queue, batch);
+	tt_pthread_mutex_unlock(&q->mutex);
+	if (was_empty)
+		ev_async_send(q->consumer, &q->async);
+}
+
+static void
+locked_queue_fetch(struct locked_queue *q, struct stailq *output)
+{
+	tt_pthread_mutex_lock(&q->mutex);
+	stailq_concat(output, &q->queue);
+	tt_pthread_mutex_unlock(&q->mutex);
+}
+
+static void
+locked_send(struct cmsg *msg)
+{
+	stailq_add_tail_entry(&main_staged, msg, fifo);
+	sent++;
+}
+
+static void
+locked_flush(void)
+{
+	locked_queue_push(&worker_queue, &main_staged);
+}
+
+static void
+main_queue_cb(ev_loop *loop, struct ev_async *watcher, int events)
+{
+	(void) loop;
+	(void) watcher;
+	(void) events;
+	struct stailq input;
+	stailq_create(&input);
+	locked_queue_fetch(&main_queue, &input);
+	struct cmsg *msg, *next;
+	stailq_foreach_entry_safe(msg, next, &input, fifo) {
+		received++;
+		if (sent < send_count)
+			locked_send(msg);
+	}
+	locked_flush();
+	if (received == send_count)
+		fiber_wakeup(bench_fiber);
+}
+
+static void
+worker_queue_cb(ev_loop *loop, struct ev_async *watcher, int events)
+{
+	(void) loop;
+	(void) watcher;
+	(void) events;
+	struct stailq input;
+	stailq_create(&input);
+	locked_queue_fetch(&worker_queue, &input);
+	locked_queue_push(&main_queue, &input);
+}
+
+static const struct transport locked_transport = {
+	"locked queue", locked_send, locked_flush
+};
+
+/* }}} locked queue */
+
+static int
+worker_f(va_list ap)
+{
+	(void) ap;
+	/*
+	 * Set up the queue before the endpoint: once the main
+	 * cord has connected to the endpoint, both are ready.
+	 */
+	locked_queue_create(&worker_queue, worker_queue_cb);
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "worker", fiber_schedule_cb, fiber());
+	cpipe_create(&main_pipe, "main");
+	cbus_loop(&endpoint);
+	cpipe_destroy(&main_pipe);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	locked_queue_destroy(&worker_queue);
+	return 0;
+}
+
+/** Bounce @a count messages, @a window at a time. */
+static double
+bench_run(const struct transport *t, int count, int window)
+{
+	send_count = count;
+	sent = received = 0;
+	bench_fiber = fiber();
+	double start = clock_monotonic();
+	for (int i = 0; i < window; i++)
+		t->send(&messages[i]);
+	t->flush();
+	while (received < send_count)
+		fiber_yield();
+	return clock_monotonic() - start;
+}
+
+static void
+bench(const struct transport *t)
+{
+	double throughput_time = bench_run(t, THROUGHPUT_MESSAGES,
+					   THROUGHPUT_WINDOW);
+	printf("%s: %d messages delivered\n", t->name, received);
+	double latency_time = bench_run(t, LATENCY_ROUND_TRIPS, 1);
+	printf("%s: %d round trips done\n", t->name, received);
+	fprintf(stderr, "%s: %.0f messages/sec, hop latency %.2f usec\n",
+		t->name, THROUGHPUT_MESSAGES / throughput_time,
+		latency_time / LATENCY_ROUND_TRIPS / 2 * 1e6);
+}
+
+static int
+main_f(va_list ap)
+{
+	(void) ap;
+	header();
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "main", main_endpoint_cb, &endpoint);
+	locked_queue_create(&main_queue, main_queue_cb);
+	stailq_create(&main_staged);
+
+	struct cord worker;
+	fail_if(cord_costart(&worker, "worker", worker_f, NULL) != 0);
+	cpipe_create(&worker_pipe, "worker");
+
+	bench(&cbus_transport);
+	bench(&locked_transport);
+
+	cbus_stop_loop(&worker_pipe);
+	cpipe_destroy(&worker_pipe);
+	fail_if(cord_join(&worker) != 0);
+	locked_queue_destroy(&main_queue);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	footer();
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+int
+main()
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	cbus_init();
+	struct fiber *main = fiber_new("main", main_f);
+	fail_if(main == NULL);
+	fiber_wakeup(main);
+	ev_run(loop(), 0);
+	cbus_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
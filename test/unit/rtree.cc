@@ -277,11 +277,108 @@ neighbor_test()
 }
 
 
+static void
+bulk_load_check()
+{
+	header();
+
+	const size_t counts[] = {0, 1, 7, 100, 1000, 12345};
+	const size_t max_count = 12345;
+	struct rtree_rect *arr = (struct rtree_rect *)
+		malloc(max_count * sizeof(*arr));
+	srand(1);
+	for (size_t i = 0; i < max_count; i++) {
+		coord_t x = rand() % 1000, y = rand() % 1000;
+		rtree_set2d(&arr[i], x, y, x + rand() % 10, y + rand() % 10);
+	}
+
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+		size_t count = counts[k];
+		printf("Bulk load %zu records\n", count);
+
+		struct rtree tree;
+		rtree_init(&tree, 2, extent_size,
+			   extent_alloc, extent_free, &page_count,
+			   RTREE_EUCLID);
+		if (rtree_build_reserve(&tree, count / 2) != 0)
+			fail("reserve failed", "true");
+		for (size_t i = 0; i < count; i++) {
+			if (rtree_build_add(&tree, &arr[i],
+					    (record_t)(i + 1)) != 0)
+				fail("add failed", "true");
+		}
+		rtree_build_end(&tree);
+		if (rtree_number_of_records(&tree) != count)
+			fail("Tree count mismatch", "true");
+		/* Pages are full, upper levels add few of them */
+		size_t leaves = (count + tree.page_max_fill - 1) /
+				tree.page_max_fill;
+		if (count > 0 && tree.n_pages > leaves + leaves / 8 + 2)
+			fail("pages are packed", "false");
+
+		/* Every record is found and found once */
+		for (size_t i = 0; i < count; i++) {
+			if (!rtree_search(&tree, &arr[i], SOP_EQUALS,
+					  &iterator))
+				fail("element in tree", "false");
+			bool found = false;
+			record_t rec;
+			while ((rec = rtree_iterator_next(&iterator)) != NULL) {
+				if (rec == (record_t)(i + 1)) {
+					if (found)
+						fail("element found twice",
+						     "true");
+					found = true;
+				}
+			}
+			if (!found)
+				fail("right search result", "false");
+		}
+		struct rtree_rect query;
+		rtree_set2d(&query, 100, 200, 300, 400);
+		size_t expected = 0, actual = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (arr[i].coords[0] <= 300 &&
+			    arr[i].coords[1] >= 100 &&
+			    arr[i].coords[2] <= 400 &&
+			    arr[i].coords[3] >= 200)
+				expected++;
+		}
+		rtree_search(&tree, &query, SOP_OVERLAPS, &iterator);
+		while (rtree_iterator_next(&iterator) != NULL)
+			actual++;
+		if (actual != expected)
+			fail("overlaps search result", "wrong");
+
+		/* The tree can be modified after the build */
+		for (size_t i = 0; i < count; i += 2) {
+			if (!rtree_remove(&tree, &arr[i], (record_t)(i + 1)))
+				fail("delete element in tree", "false");
+		}
+		for (size_t i = 0; i < count; i += 2)
+			rtree_insert(&tree, &arr[i], (record_t)(i + 1));
+		for (size_t i = 0; i < count; i++) {
+			if (!rtree_remove(&tree, &arr[i], (record_t)(i + 1)))
+				fail("delete element in tree", "false");
+		}
+		if (rtree_number_of_records(&tree) != 0)
+			fail("Tree count mismatch", "true");
+		rtree_destroy(&tree);
+	}
+	rtree_iterator_destroy(&iterator);
+	free(arr);
+
+	footer();
+}
+
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_load_check();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
@@ -47,3 +47,54 @@ new_reflects() > 980
 new_seeks() < 20
 
 s:drop()
+
+--
+-- Prefix bloom filters let EQ lookups by a partial key skip runs.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}, bloom_prefix_parts = 1})
+for i = 1,100 do for j = 1,10 do s:replace{i, j} end end
+box.snapshot()
+_ = new_reflects()
+_ = new_seeks()
+
+for i = 1,100 do s:select{i} end
+new_reflects() == 0
+new_seeks() == 100
+
+for i = 101,1100 do s:select{i} end
+new_reflects() > 980
+new_seeks() < 20
+
+-- full keys are still looked up in the full key filter
+for i = 1,100 do s:select{i, 11} end
+new_reflects() > 80
+
+test_run:cmd('restart server default')
+
+s = box.space.test
+reflects = 0
+function cur_reflects() return box.info.vinyl().performance["iterator"].run.bloom_reflect_count end
+function new_reflects() local o = reflects reflects = cur_reflects() return reflects - o end
+seeks = 0
+function cur_seeks() return box.info.vinyl().performance["iterator"].run.lookup_count end
+function new_seeks() local o = seeks seeks = cur_seeks() return seeks - o end
+
+_ = new_reflects()
+_ = new_seeks()
+
+for i = 1,100 do s:select{i} end
+new_reflects() == 0
+new_seeks() == 100
+
+for i = 101,1100 do s:select{i} end
+new_reflects() > 980
+new_seeks() < 20
+
+s:drop()
+
+-- a prefix must be shorter than the key
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {bloom_prefix_parts = 1})
+s:create_index('pk', {bloom_prefix_parts = -1})
+s:drop()
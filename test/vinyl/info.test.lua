@@ -60,5 +60,15 @@ box.info.vinyl().memory.min_lsn == box.info.vclock[1]
 space:drop()
 box.info.vinyl().memory.min_lsn
 
+-- workers reserved for dumps can be changed at runtime
+box.cfg{vinyl_dump_threads = 0}
+box.cfg{vinyl_dump_threads = 3}
+box.cfg{vinyl_dump_threads = 2}
+box.info.vinyl().scheduler.dump_threads
+box.cfg{vinyl_dump_threads = 1}
+box.info.vinyl().scheduler.dump_threads
+box.cfg{vinyl_compact_io_rate_limit = 16}
+box.cfg.vinyl_compact_io_rate_limit
+
 test_run:cmd('switch default')
 test_run:cmd("stop server vinyl_info")
@@ -0,0 +1,30 @@
+test_run = require('test_run').new()
+
+--
+-- Pages read from runs are shared by all iterators via
+-- the page cache.
+--
+box.cfg.vinyl_page_cache
+function page_cache() return box.info.vinyl().performance.page_cache end
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+for i = 1, 100 do s:replace{i, string.rep('x', 10)} end
+box.snapshot()
+
+-- The first lookup reads the page from disk.
+old = page_cache()
+s:get(1)
+new = page_cache()
+new.miss > old.miss
+new.count > old.count
+new.used > old.used
+
+-- A lookup of another key of the same page hits the cache.
+old = new
+s:get(2)
+new = page_cache()
+new.hit > old.hit
+new.miss == old.miss
+
+s:drop()
@@ -0,0 +1,30 @@
+test_run = require('test_run').new()
+test_run:cmd('restart server default with cleanup=1')
+
+fio = require('fio')
+fiber = require('fiber')
+
+--
+-- A spare file for the next WAL is created and preallocated
+-- in advance, so that rotation only writes the header to it
+-- and renames it.
+--
+spare = fio.pathjoin(box.cfg.wal_dir, 'wal.prealloc')
+function wait_spare() while fio.stat(spare) == nil do fiber.sleep(0.001) end return true end
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+wait_spare()
+-- rows_per_wal is 10, so WAL is rotated several times
+for i = 1, 50 do s:insert{i} end
+wait_spare()
+-- disk space is preallocated past the end of the file
+fio.stat(spare).size
+#fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog')) > 1
+
+-- WAL files created from spare files are recovered
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:get{50}
+s:drop()
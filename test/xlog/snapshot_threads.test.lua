@@ -0,0 +1,39 @@
+env = require('test_run')
+test_run = env.new()
+fio = require('fio')
+xlog = require('xlog').pairs
+
+box.cfg{snapshot_threads = 0}
+box.cfg{snapshot_threads = 100}
+box.cfg{snapshot_threads = 4}
+
+_ = box.schema.space.create('test'):create_index('pk')
+for i = 1, 50000 do box.space.test:insert{i, string.rep('x', i % 100)} end
+box.snapshot()
+
+--
+-- Rows compressed by different threads are written in order
+-- and numbered as if the snapshot was written by one thread.
+--
+snap = fio.pathjoin(box.cfg.memtx_dir, string.format('%020d.snap', box.info.signature))
+lsn = 0
+ordered = true
+count = 0
+test_run:cmd("setopt delimiter ';'")
+for _, row in xlog(snap) do
+    if (row.HEADER.lsn or 0) ~= lsn then ordered = false end
+    lsn = lsn + 1
+    if row.BODY.space_id == box.space.test.id then
+        if row.BODY.tuple[1] ~= count + 1 then ordered = false end
+        count = count + 1
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+ordered
+count
+
+test_run:cmd('restart server default')
+box.cfg.snapshot_threads
+box.space.test:count()
+box.space.test:get(50000)[2] == string.rep('x', 0)
+box.space.test:drop()